@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <new>
+
+#include "benchmark/benchmark.h"
+#include "roo_scheduler.h"
+#include "roo_wifi/controller.h"
+#include "roo_wifi/hal/simulated/in_memory_store.h"
+#include "roo_wifi/hal/simulated/simulated_interface.h"
+
+// Counts heap allocations, so that benchmarks can report allocations per
+// iteration alongside the timings.
+static size_t allocation_count = 0;
+
+void* operator new(size_t size) {
+  ++allocation_count;
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+namespace roo_wifi {
+
+namespace {
+
+class NopListener : public Controller::Listener {};
+
+// Controller wired to a simulated environment with `ap_count` access points.
+// Roughly every third AP shares its SSID with another one, like in typical
+// multi-AP deployments.
+class Fixture {
+ public:
+  Fixture(int ap_count)
+      : scheduler(), interface(scheduler), store(),
+        controller(store, interface, scheduler) {
+    controller.begin();
+    for (int i = 0; i < ap_count; ++i) {
+      char ssid[33];
+      snprintf(ssid, sizeof(ssid), "network-%d", i - i / 3);
+      interface.addAccessPoint(ssid, -30 - (i * 37) % 60, WIFI_AUTH_WPA2_PSK,
+                               "password", 1 + i % 13);
+    }
+  }
+
+  // Delivers fresh scan results to the controller, and lets it process them.
+  void scan() {
+    interface.completeScan();
+    runPending();
+  }
+
+  // Makes the controller re-read the current network, the way the interface
+  // triggers it (so including the event delivery).
+  void refresh() {
+    interface.emitEvent(Interface::EV_RSSI_CHANGED);
+    runPending();
+  }
+
+  void runPending() {
+    while (scheduler.executeEligibleTasks()) {
+    }
+  }
+
+  roo_scheduler::Scheduler scheduler;
+  SimulatedInterface interface;
+  InMemoryStore store;
+  Controller controller;
+};
+
+void ReportAllocations(benchmark::State& state, size_t allocations) {
+  state.counters["allocs"] = benchmark::Counter(
+      allocations, benchmark::Counter::kAvgIterations);
+}
+
+void BM_OnScanCompleted(benchmark::State& state) {
+  Fixture f(state.range(0));
+  // Warm up, so that we measure steady-state scans.
+  f.scan();
+  size_t allocations = allocation_count;
+  for (auto _ : state) {
+    f.scan();
+  }
+  ReportAllocations(state, allocation_count - allocations);
+  benchmark::DoNotOptimize(f.controller.otherScannedNetworksCount());
+}
+
+BENCHMARK(BM_OnScanCompleted)->RangeMultiplier(10)->Range(10, 1000);
+
+void BM_RefreshCurrentNetwork(benchmark::State& state) {
+  Fixture f(state.range(0));
+  f.scan();
+  f.controller.connect("network-0", "password");
+  f.runPending();
+  NetworkDetails& ap = f.interface.accessPoint(0).details;
+  size_t allocations = allocation_count;
+  for (auto _ : state) {
+    // Alternate the signal strength so that every refresh notifies.
+    ap.rssi = (ap.rssi == -40) ? -41 : -40;
+    f.refresh();
+  }
+  ReportAllocations(state, allocation_count - allocations);
+}
+
+BENCHMARK(BM_RefreshCurrentNetwork)->RangeMultiplier(10)->Range(10, 1000);
+
+void BM_RefreshCurrentNetworkDisconnected(benchmark::State& state) {
+  Fixture f(state.range(0));
+  f.store.setDefaultSSID("network-1");
+  f.scan();
+  size_t allocations = allocation_count;
+  for (auto _ : state) {
+    f.refresh();
+  }
+  ReportAllocations(state, allocation_count - allocations);
+}
+
+BENCHMARK(BM_RefreshCurrentNetworkDisconnected)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000);
+
+void BM_Connect(benchmark::State& state) {
+  Fixture f(state.range(0));
+  f.scan();
+  size_t allocations = allocation_count;
+  int i = 0;
+  for (auto _ : state) {
+    f.controller.connect((i++ % 2 == 0) ? "network-0" : "network-1",
+                         "password");
+    f.runPending();
+  }
+  ReportAllocations(state, allocation_count - allocations);
+}
+
+BENCHMARK(BM_Connect)->RangeMultiplier(10)->Range(10, 1000);
+
+void BM_ListenerFanout(benchmark::State& state) {
+  Fixture f(state.range(0));
+  std::vector<NopListener> listeners(state.range(1));
+  for (NopListener& l : listeners) f.controller.addListener(&l);
+  f.scan();
+  size_t allocations = allocation_count;
+  for (auto _ : state) {
+    f.scan();
+  }
+  ReportAllocations(state, allocation_count - allocations);
+}
+
+BENCHMARK(BM_ListenerFanout)
+    ->ArgsProduct({{10, 100, 1000}, {1, 8, 64}})
+    ->ArgNames({"aps", "listeners"});
+
+}  // namespace
+
+}  // namespace roo_wifi
+
+BENCHMARK_MAIN();
@@ -5,13 +5,16 @@
 /// Provides Wi-Fi controller interfaces and platform adapters.
 
 #include "roo_scheduler.h"
+#include "roo_wifi/basic_controller.h"
 #include "roo_wifi/controller.h"
+#include "roo_wifi/hal/caching_store.h"
 #include "roo_wifi/hal/interface.h"
 
 /// Must be included after `<Arduino.h>`.
 
 #ifdef ESP32
 
+#include "esp_system.h"
 #include "roo_wifi/hal/esp32/arduino_preferences_store.h"
 #include "roo_wifi/hal/esp32/esp32_arduino_interface.h"
 
@@ -21,16 +24,54 @@ namespace roo_wifi {
 class Esp32Wifi : public Controller {
  public:
   Esp32Wifi(roo_scheduler::Scheduler& scheduler)
-      : Controller(store_, interface_, scheduler), store_(), interface_() {}
+      : Controller(cached_store_, interface_, scheduler),
+        store_(),
+        cached_store_(store_),
+        interface_() {}
 
   void begin() {
     store_.begin();
+    cached_store_.begin();
     interface_.begin();
+    // Hardware RNG; uptime at boot is the same on every device.
+    setRandomSeed(esp_random());
     Controller::begin();
   }
 
  private:
   ArduinoPreferencesStore store_;
+  CachingStore cached_store_;
+  Esp32ArduinoInterface interface_;
+};
+
+/// Like Esp32Wifi, but specialized for the ESP32 interface and store, so
+/// that the controller's calls to them, and the caching store's calls to the
+/// preferences store, are resolved at compile time (see BasicController).
+/// Use it when the application does not need a `Controller`.
+class Esp32WifiSpecialized
+    : public BasicController<Esp32ArduinoInterface,
+                             BasicCachingStore<ArduinoPreferencesStore>> {
+ public:
+  using Base = BasicController<Esp32ArduinoInterface,
+                               BasicCachingStore<ArduinoPreferencesStore>>;
+
+  Esp32WifiSpecialized(roo_scheduler::Scheduler& scheduler)
+      : Base(cached_store_, interface_, scheduler),
+        store_(),
+        cached_store_(store_),
+        interface_() {}
+
+  void begin() {
+    store_.begin();
+    cached_store_.begin();
+    interface_.begin();
+    setRandomSeed(esp_random());
+    Base::begin();
+  }
+
+ private:
+  ArduinoPreferencesStore store_;
+  BasicCachingStore<ArduinoPreferencesStore> cached_store_;
   Esp32ArduinoInterface interface_;
 };
 
@@ -0,0 +1,58 @@
+#include "roo_wifi/auto_join.h"
+
+#include <algorithm>
+
+namespace roo_wifi {
+
+namespace {
+
+// Weight of the success rate, in points (roughly dB).
+constexpr int kSuccessRateWeight = 30;
+
+// Points lost per this many milliseconds of time to IP.
+constexpr uint32_t kTimeToIpUnitMs = 250;
+
+// Cap on the points lost due to time to IP.
+constexpr uint32_t kMaxTimeToIpPenalty = 40;
+
+// Assumed time to IP of networks that have never been connected to.
+constexpr uint32_t kDefaultTimeToIpMs = 4000;
+
+// Counts are halved when attempts reach this many.
+constexpr uint16_t kHistoryAgingThreshold = 64;
+
+}  // namespace
+
+int AutoJoinScore(int8_t rssi, const ConnectionHistory* history) {
+  uint32_t attempts = (history == nullptr) ? 0 : history->attempts;
+  uint32_t successes = (history == nullptr) ? 0 : history->successes;
+  successes = std::min(successes, attempts);
+  uint32_t time_to_ip_ms = (successes == 0) ? kDefaultTimeToIpMs
+                                            : history->avg_time_to_ip_ms;
+  int score = rssi;
+  // Laplace-smoothed success rate, so that a single failure of a new network
+  // does not rule it out.
+  score += (int)(kSuccessRateWeight * (successes + 1) / (attempts + 2));
+  score -= (int)std::min(time_to_ip_ms / kTimeToIpUnitMs, kMaxTimeToIpPenalty);
+  return score;
+}
+
+void RecordConnectionAttempt(ConnectionHistory& history) {
+  if (history.attempts >= kHistoryAgingThreshold) {
+    history.attempts /= 2;
+    history.successes /= 2;
+  }
+  ++history.attempts;
+}
+
+void RecordConnectionSuccess(ConnectionHistory& history,
+                             uint32_t time_to_ip_ms) {
+  if (history.successes >= history.attempts) return;
+  ++history.successes;
+  // Running mean; converges on recent behavior as counts get aged.
+  int64_t avg = history.avg_time_to_ip_ms;
+  avg += ((int64_t)time_to_ip_ms - avg) / history.successes;
+  history.avg_time_to_ip_ms = (uint32_t)avg;
+}
+
+}  // namespace roo_wifi
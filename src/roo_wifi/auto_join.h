@@ -0,0 +1,27 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include "roo_wifi/hal/store.h"
+
+namespace roo_wifi {
+
+/// Scores a known network as an auto-join candidate; higher is better.
+///
+/// Starts from the signal strength (in dBm), adds up to 30 points for the
+/// success rate of past connection attempts, and subtracts a point per 250 ms
+/// of average time to IP (up to 40). Networks without history get a neutral
+/// success rate and a typical time to IP, so that a known-good network wins
+/// over an untried one of similar strength. `history` may be nullptr.
+int AutoJoinScore(int8_t rssi, const ConnectionHistory* history);
+
+/// Records the start of a connection attempt in the history. Ages the counts
+/// once they grow large, so that the success rate follows recent behavior.
+void RecordConnectionAttempt(ConnectionHistory& history);
+
+/// Records that the attempt has obtained an IP address, after the specified
+/// time.
+void RecordConnectionSuccess(ConnectionHistory& history,
+                             uint32_t time_to_ip_ms);
+
+}  // namespace roo_wifi
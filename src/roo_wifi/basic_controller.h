@@ -0,0 +1,643 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_scheduler.h"
+#include "roo_wifi/controller_base.h"
+#include "roo_wifi/hal/interface.h"
+#include "roo_wifi/hal/store.h"
+#include "roo_wifi/listener_registry.h"
+#include "roo_wifi/mpsc_queue.h"
+#include "roo_wifi/reconnect_policy.h"
+#include "roo_wifi/scan_list_diff.h"
+#include "roo_wifi/scan_policy.h"
+#include "roo_wifi/trace.h"
+
+namespace roo_wifi {
+
+/// High-level Wi-Fi controller that manages scanning and connections.
+///
+/// Talks to the interface and the store via InterfaceT and StoreT, which
+/// must derive from Interface and Store, respectively. Controller (i.e.
+/// BasicController<Interface, Store>) works with any implementation, via
+/// virtual calls. Instantiating the template with the concrete (final)
+/// classes instead, e.g.
+///
+///   BasicController<Esp32ArduinoInterface, ArduinoPreferencesStore>
+///
+/// lets the compiler resolve, and inline, the calls at compile time, and
+/// leave out the parts of the controller that the application does not
+/// use. (Callbacks via the visitor interfaces stay virtual.)
+template <typename InterfaceT, typename StoreT>
+class BasicController : public ControllerBase {
+ public:
+  /// Creates a controller using the provided store, interface, and scheduler.
+  BasicController(StoreT& store, InterfaceT& interface,
+                  roo_scheduler::Scheduler& scheduler);
+
+  /// Destroys the controller and detaches listeners.
+  ~BasicController();
+
+  /// Initializes the controller and registers for interface events.
+  void begin();
+
+  /// Adds a listener for the kinds of controller events specified by the
+  /// mask (a combination of Interest values). If the listener has already
+  /// been added, replaces its mask. May be called from within listener
+  /// callbacks; the listener then starts receiving events after the current
+  /// notification completes.
+  void addListener(Listener* listener, uint16_t mask = INTEREST_ALL);
+
+  /// Removes a previously added listener. May be called from within listener
+  /// callbacks; the listener does not receive any events afterwards.
+  void removeListener(Listener* listener);
+
+  /// Returns the number of non-current networks in the scan list.
+  int otherScannedNetworksCount() const;
+
+  /// Returns the number of networks in the scan list, including the current
+  /// one.
+  int scannedNetworksCount() const { return all_networks_.size(); }
+
+  /// Returns the ith network in the scan list, including the current one.
+  /// The list is sorted by signal strength.
+  const Network& scannedNetwork(int idx) const { return all_networks_[idx]; }
+
+  /// Returns the current network (may be empty if disconnected).
+  const Network& currentNetwork() const;
+
+  /// Returns a network by SSID, or nullptr if not found.
+  const Network* lookupNetwork(roo::string_view ssid) const;
+
+  /// Returns the connection status of the current network.
+  ConnectionStatus currentNetworkStatus() const;
+
+  /// Returns the ith non-current network in the scan list.
+  const Network& otherNetwork(int idx) const;
+
+  /// Returns the number of access points (BSSIDs) of a network from the scan
+  /// list.
+  int accessPointCount(const Network& network) const {
+    return network.ap_count_;
+  }
+
+  /// Returns the ith access point of a network from the scan list. Access
+  /// points are sorted by signal strength, strongest first. Valid until the
+  /// next scan completes.
+  const AccessPoint& accessPoint(const Network& network, int idx) const {
+    return access_points_[network.ap_begin_ + idx];
+  }
+
+  /// Starts a full scan, with the options set via setScanOptions(). Returns
+  /// false if a scan could not be started.
+  bool startScan();
+
+  /// Starts a scan with the specified options. If it is a partial scan,
+  /// networks outside of its scope stay in the scan list as of the previous
+  /// scan. Returns false if a scan could not be started.
+  bool startScan(const ScanOptions& options);
+
+  /// Sets the options of startScan() and of background scans, e.g. passive
+  /// scanning, or the dwell time. (The channels and the SSID are ignored:
+  /// startScan() scans all channels, and background scans pick them per
+  /// setPartialScans().) Takes effect at the next scan.
+  void setScanOptions(const ScanOptions& options);
+
+  /// Sets how successive scans get merged into the scan list. Takes effect
+  /// at the next scan.
+  void setScanAggregation(const ScanAggregation& aggregation) {
+    aggregation_ = aggregation;
+  }
+
+  /// Returns the options set via setScanOptions().
+  const ScanOptions& scanOptions() const { return scan_options_; }
+
+  /// Returns how long the latest scan started by the controller took, from
+  /// start to completion; zero if none has completed yet. See also
+  /// Stats::scan_duration.
+  roo_time::Duration lastScanDuration() const { return last_scan_duration_; }
+
+  /// Returns true when the current scan has completed.
+  bool isScanCompleted() const { return interface_.scanCompleted(); }
+  /// Returns true when the interface is enabled.
+  bool isEnabled() const { return enabled_; }
+
+  /// Returns true when a connection is in progress.
+  bool isConnecting() const { return connecting_; }
+
+  /// Sets the policy that decides when to scan and to refresh the current
+  /// network. The policy must outlive the controller. Passing nullptr
+  /// restores the default policy (scan every 15 s, refresh every 2 s). Takes
+  /// effect at the next scheduling decision.
+  void setScanPolicy(const ScanPolicy* policy);
+
+  /// Enables or disables partial scans. When enabled, background scans (but
+  /// not startScan()) are limited to the channels of the known networks, as
+  /// learned from connection hints and full scans, and every
+  /// `full_scan_every`-th one is a full scan, to discover networks elsewhere.
+  /// Scans looking for a specific network (e.g. to roam) are also limited to
+  /// its SSID. While a listener needs scan results, all scans are full.
+  /// Networks on channels that a partial scan skipped stay in the scan list
+  /// as of the latest scan that covered them. Enabled by default.
+  void setPartialScans(bool enabled, uint8_t full_scan_every = 8);
+
+  /// Sets the policy that decides whether, and when, to reconnect after a
+  /// connection attempt fails or the connection drops. The policy must
+  /// outlive the controller. Passing nullptr restores the default policy
+  /// (BackoffReconnectPolicy with default settings). Credentials that have
+  /// been rejected are not retried (nor auto-joined), regardless of the
+  /// policy, until passed to connect() or setPassword() again.
+  void setReconnectPolicy(const ReconnectPolicy* policy);
+
+  /// Seeds the random numbers used for reconnect jitter. By default, the
+  /// seed derives from the uptime at construction, which may be similar across
+  /// devices of the same kind; pass a hardware random number (e.g. from
+  /// esp_random()) for a better spread.
+  void setRandomSeed(uint32_t seed);
+
+  /// Sets the width (in dB, each way) of the signal strength band that the
+  /// interface monitors while connected, if it supports RSSI notifications.
+  /// Signal changes within the band are not reported. Defaults to 5 dB.
+  void setRssiHysteresis(uint8_t db) { rssi_hysteresis_ = db; }
+
+  /// Toggles the enabled/disabled state and persists it in the store.
+  void toggleEnabled();
+
+  /// Notifies listeners that enable state changed.
+  void notifyEnableChanged();
+
+  /// Looks up a stored password for the given SSID.
+  bool getStoredPassword(const std::string& ssid, std::string& passwd) const;
+
+  /// Temporarily disables periodic refresh and event processing.
+  void pause();
+
+  /// Resumes periodic refresh and event processing.
+  void resume();
+
+  /// Stores a password for the given SSID.
+  void setPassword(const std::string& ssid, const std::string& passwd);
+
+  /// Connects using stored SSID/password values.
+  bool connect();
+
+  /// Connects to the specified SSID/password.
+  bool connect(const std::string& ssid, const std::string& passwd);
+
+  /// Disconnects the current connection.
+  void disconnect();
+
+  /// Forgets the password and SSID association.
+  void forget(const std::string& ssid);
+
+  /// Enables or disables coalescing of connection state events. When
+  /// enabled, bursts of connection events (e.g. from a flapping link) that
+  /// get processed together collapse into their net transition: listeners
+  /// get at most one onConnectionStateChanged(), with the last event, and
+  /// none if the burst ends in the state it started in. A positive window
+  /// additionally delays processing by that much after the first event of a
+  /// burst, so that more of it gets absorbed. Disabled by default.
+  void setEventCoalescing(bool enabled,
+                          roo_time::Duration window = roo_time::Millis(0));
+
+  /// Returns the number of connection state events that have been absorbed
+  /// by coalescing, i.e. not notified to listeners.
+  uint32_t coalescedEventCount() const { return coalesced_events_; }
+
+  /// Enables or disables auto-join. When enabled, whenever a scan completes
+  /// while not connected (nor connecting), the controller connects to the
+  /// known network in range that ranks best according to AutoJoinScore(),
+  /// i.e. by signal strength and connection history. Known networks are
+  /// those with a stored password, and open networks that have been
+  /// connected to before. The joined network becomes the default one once
+  /// the connection succeeds. Requires a store that supports enumeration (see
+  /// Store::forEachKnownNetwork()). An explicit disconnect() suspends
+  /// auto-join until the next connect(). Disabled by default.
+  void setAutoJoin(bool enabled) { auto_join_ = enabled; }
+
+  /// Enables or disables roaming between the access points of the current
+  /// network. When enabled, and the signal of the connected AP stays below
+  /// `rssi_threshold` (in dBm) for `dwell`, the controller scans, and
+  /// re-associates with the strongest other AP of the same SSID, provided
+  /// that it is at least `hysteresis` dB stronger. (The margin keeps the
+  /// device from ping-ponging between APs of similar strength.) The dwell
+  /// time restarts after each scan that finds no such AP. Disabled by
+  /// default.
+  void setRoaming(bool enabled, int8_t rssi_threshold = -75,
+                  roo_time::Duration dwell = roo_time::Seconds(10),
+                  uint8_t hysteresis = 8);
+
+  /// Returns the reason code of the most recent disconnect event (see
+  /// Interface::Event::reason).
+  uint16_t lastDisconnectReason() const { return last_disconnect_reason_; }
+
+  /// Returns the number of interface events dropped because they arrived
+  /// faster than the scheduler processed them. After a drop, the controller
+  /// re-reads the connection state from the interface.
+  uint32_t droppedEventCount() const { return dropped_events_.load(); }
+
+  /// Sets the recorder that traces interface events, API calls and scan
+  /// summaries, for post-mortem analysis and replay; nullptr disables
+  /// tracing (the default). The recorder must outlive the controller, or be
+  /// reset before it is destroyed.
+  void setTraceRecorder(TraceRecorder* recorder) { trace_ = recorder; }
+
+  /// Returns a snapshot of the connection and scan metrics.
+  Stats stats() const;
+
+  /// Clears the connection and scan metrics.
+  void resetStats();
+
+ private:
+  // Receives interface events, possibly on the Wi-Fi event task, and queues
+  // them for processing on the scheduler thread.
+  class WifiListener : public Interface::EventListener {
+   public:
+    WifiListener(BasicController& wifi) : wifi_(wifi) {}
+
+    void handleEvent(const Interface::Event& event) override {
+      wifi_.enqueueEvent(event);
+    }
+
+   private:
+    BasicController& wifi_;
+  };
+
+  friend class WifiListener;
+
+  // Replays recorded signal readings, which would otherwise get picked up by
+  // periodic refreshes, as they happen.
+  friend class TraceReplayer;
+
+  class ScanDeltaNotifier;
+  class ScanCollector;
+  class AutoJoinRanker;
+  class ChannelLearner;
+
+  // Called on the interface's event thread(s); possibly on several ones
+  // concurrently. Must not touch controller state other than the event
+  // queue.
+  void enqueueEvent(const Interface::Event& event);
+
+  // Processes queued events, on the scheduler thread.
+  void drainEvents();
+
+  // Drains queued events, if any, and schedules the next poll. Used when the
+  // interface delivers events on another thread.
+  void pollEvents();
+
+  void processEvent(const Interface::Event& event);
+
+  void onConnectionStateChanged(Interface::EventType type);
+
+  // Updates internal state in response to the connection event. Returns
+  // false if the event should not be notified to listeners.
+  bool applyConnectionStateChange(Interface::EventType type);
+
+  // Updates the current network status, and notifies listeners.
+  void notifyConnectionStateChange(Interface::EventType type);
+
+  // Re-arms signal monitoring, or polling, after a connection event.
+  void resumeMonitoring(Interface::EventType type);
+
+  // Applies the connection event, deferring notifications until
+  // flushConnectionStateChanges().
+  void coalesceConnectionStateChange(Interface::EventType type);
+
+  // Notifies listeners of the net effect of the coalesced events, if any.
+  void flushConnectionStateChanges();
+
+  // Called when a hinted connection attempt fails. Retries without the hint,
+  // and returns true if the retry has been started.
+  bool retryWithoutHint();
+
+  // Records the BSSID and channel of the current association in the store,
+  // to speed up subsequent connects.
+  void rememberConnectionHint();
+
+  // Re-reads the state of the current network from the interface, and
+  // notifies listeners if it has changed.
+  void refreshCurrentNetwork();
+
+  void periodicRefreshCurrentNetwork();
+
+  // Returns true if the interface notifies us about signal changes of the
+  // current network, so that we do not need to poll.
+  bool rssiEventsActive() const;
+
+  // (Re-)arms the interface's RSSI band around the current signal strength,
+  // unless it is already armed and the signal is within the band.
+  void armRssiBand();
+
+  void onRssiChanged();
+
+  bool scanResultsNeeded();
+
+  ScanPolicy::Inputs scanPolicyInputs();
+
+  void scheduleNextScan();
+
+  void scheduleNextRefresh();
+
+  void updateCurrentNetwork(roo::string_view ssid, bool open, int8_t rssi,
+                            ConnectionStatus status, bool force_notify);
+
+  void onScanCompleted();
+
+  // Returns the index in scan_candidates_ of the scan result with the
+  // specified SSID, or -1 if not found.
+  int findScanResult(roo::string_view ssid) const;
+
+  // Clears the SSID hash table, resizing it to the specified power of two,
+  // and re-inserts all scan candidates.
+  void resetScanTable(size_t table_size);
+
+  // Inserts the scan candidate at the specified index into the hash table.
+  void insertScanSlot(size_t idx);
+
+  // Updates the current network status, accounting for the time spent in the
+  // previous one.
+  void setCurrentNetworkStatus(ConnectionStatus status);
+
+  // Records a connection attempt in the stats.
+  void countConnectAttempt();
+
+  // Records a disconnect event in the stats.
+  void countDisconnect(uint16_t reason);
+
+  // Starts a scan; startScan() minus tracing, for internal use.
+  bool initiateScan(const ScanOptions& options);
+
+  // Starts a scan on our own initiative. Unless `full` is set, the scan may
+  // be a partial one (see setPartialScans()).
+  bool startBackgroundScan(bool full = false);
+
+  // Returns the scan options, covering all channels.
+  ScanOptions fullScanOptions() const;
+
+  // Returns the channels on which the specified known network (or, if the
+  // SSID is empty, any known network) has been seen.
+  ChannelSet learnedChannels(roo::string_view ssid) const;
+
+  // Adds the APs of the previous scan list that the partial scan did not
+  // cover to the collector.
+  void carryOverAccessPoints(ScanCollector& collector) const;
+
+  // Adds the APs of the network from the previous scan list to the
+  // collector; if `unscanned_only` is set, just the ones that the scan in
+  // progress did not cover.
+  void readdAccessPoints(ScanCollector& collector, const Network& network,
+                         bool unscanned_only) const;
+
+  // Merges the previous scan list into the collected scan results, per
+  // aggregation_.
+  void aggregateScans(ScanCollector& collector);
+
+  // Starts a connection attempt; connect() minus tracing, for internal use.
+  // If `make_default`, the network becomes the default one right away;
+  // otherwise, it keeps whether it becomes the default one once connected.
+  bool initiateConnect(const std::string& ssid, const std::string& passwd,
+                       bool make_default);
+
+  // Appends a record to the trace, if enabled.
+  void trace(TraceKind kind, uint8_t a = 0, uint16_t b = 0, uint32_t c = 0,
+             uint32_t d = 0) {
+    if (trace_ != nullptr) trace_->record(kind, a, b, c, d);
+  }
+
+  // Connects to the best known network in range, if appropriate.
+  void autoJoin();
+
+  // Consults the reconnect policy after a connection attempt has failed, or
+  // the connection has dropped.
+  void scheduleReconnect(Interface::EventType type, bool link_was_up);
+
+  // Reconnects to the current network, unless already connecting.
+  void reconnect();
+
+  // Stops pending reconnects, and forgets past failures.
+  void resetReconnect();
+
+  uint32_t nextRandom();
+
+  // Updates the connection history after a successful attempt.
+  void recordConnectionSuccess();
+
+  // Updates the connection history after an attempt that failed before
+  // getting an IP address.
+  void recordConnectionFailure();
+
+  // Returns the connection history of the SSID, held in RAM; loads it from
+  // the store (saving the one held previously) if it is not the one held.
+  ConnectionHistory& connectionHistory(const std::string& ssid);
+
+  // Writes the history held in RAM to the store if it has changed, and if
+  // the outcome of attempts is not the one last saved, or the history has
+  // not been saved for an hour. (Or regardless of both, if `force` is set.)
+  void saveConnectionHistory(bool force);
+
+  // Sorts the access points of the scan into access_points_, grouped by
+  // network, strongest first.
+  void groupAccessPoints();
+
+  // Tracks how long the signal of the current AP has been weak.
+  void updateRoaming();
+
+  // Re-associates with a sufficiently stronger AP of the current network, if
+  // there is one. Returns true if it did.
+  bool tryRoam();
+
+  // Notifies listeners about changes to the scan list. Returns the number of
+  // networks that have been added or removed.
+  uint16_t notifyScanDeltas();
+
+  StoreT& store_;
+  InterfaceT& interface_;
+  bool enabled_;
+  Network current_network_;
+  int16_t current_network_index_;
+  ConnectionStatus current_network_status_;
+  std::vector<Network> all_networks_;
+
+  // The scan list before the most recent scan; used to compute deltas.
+  std::vector<Network> previous_networks_;
+
+  // Scratch buffers for processing scan results, retained across scans so
+  // that steady-state scans do not allocate.
+  std::vector<Network> scan_candidates_;  // Unique SSIDs, in scan order.
+  std::vector<uint32_t> scan_hashes_;     // SSID hashes of the candidates.
+  std::vector<uint16_t> scan_slots_;
+  size_t scan_slot_mask_;
+  std::vector<uint16_t> scan_indices_;
+  std::vector<int16_t> scan_ranks_;
+  std::vector<int16_t> delta_positions_;
+  internal::ScanListDiff scan_diff_;
+
+  // All access points of the latest scan, in scan order, and the indices of
+  // their networks in scan_candidates_.
+  std::vector<AccessPoint> scan_aps_;
+  std::vector<uint16_t> scan_ap_owners_;
+
+  // The access points of the scan list, grouped by network.
+  std::vector<AccessPoint> access_points_;
+
+  WifiListener wifi_listener_;
+
+  // Interface events, handed over from the event thread(s).
+  internal::MpscQueue<Interface::Event, 32> events_;
+  std::atomic<bool> drain_pending_;
+  std::atomic<uint32_t> dropped_events_;
+  uint32_t dropped_events_seen_;
+  uint16_t last_disconnect_reason_;
+
+  // Coalescing of connection state events.
+  bool coalesce_events_;
+  roo_time::Duration coalescing_window_;
+  bool coalescing_wait_;
+  Interface::EventType pending_connection_event_;
+  uint16_t pending_connection_events_;
+  uint32_t coalesced_events_;
+  internal::ListenerRegistry<Listener> model_listeners_;
+  bool connecting_;
+
+  bool auto_join_;
+  bool auto_join_suspended_;
+
+  // Whether the network being connected to (picked by auto-join) becomes the
+  // default one once the connection succeeds.
+  bool default_on_success_;
+
+  // Whether connect() has started an attempt that has not concluded yet, and
+  // when.
+  bool attempt_pending_;
+  roo_time::Uptime attempt_started_;
+
+  // Connection history of the SSID of the latest attempt. Updated in RAM on
+  // every attempt, but written to the store only when the outcome changes
+  // (see saveConnectionHistory()), so that retrying a network that is down
+  // does not write to flash every time.
+  std::string history_ssid_;
+  ConnectionHistory history_;
+  bool history_dirty_;
+
+  // Outcome as of the last save: -1 failing, 1 succeeding, 0 unknown.
+  int8_t history_saved_outcome_;
+  roo_time::Uptime history_saved_at_;
+
+  // Consecutive failed attempts.
+  uint16_t history_failures_;
+
+  // Whether the connection in progress has been started with a hint.
+  bool hinted_attempt_;
+
+  Stats stats_;
+  roo_time::Uptime status_since_;
+  TraceRecorder* trace_;
+
+  // When the current connection attempt got associated, if it did.
+  bool associated_;
+  roo_time::Uptime associated_at_;
+
+  // Whether an established connection has been lost, and not re-established
+  // since. Connection attempts in this state are counted as reconnects.
+  bool link_lost_;
+
+  // Whether the connection has been established (i.e. we got an IP address)
+  // since the last disconnect event. Tracked per event: unlike
+  // current_network_status_, it is not reset by EV_CONNECTED, nor deferred
+  // by event coalescing, so that a disconnect is classified by the state
+  // right before it.
+  bool link_up_;
+
+  // Whether a scan that we started has not been processed yet.
+  bool scan_in_progress_;
+
+  // When the scan in progress has been started, if by us.
+  bool scan_timed_;
+  roo_time::Uptime scan_started_;
+
+  bool partial_scans_;
+  uint8_t full_scan_every_;
+
+  // Number of partial scans since the last full one.
+  uint8_t partial_scans_since_full_;
+
+  ScanOptions scan_options_;
+
+  // Options of the scan in progress.
+  ScanOptions current_scan_;
+
+  ScanAggregation aggregation_;
+
+  roo_time::Duration last_scan_duration_;
+
+  DefaultScanPolicy default_scan_policy_;
+  const ScanPolicy* scan_policy_;
+
+  BackoffReconnectPolicy default_reconnect_policy_;
+  const ReconnectPolicy* reconnect_policy_;
+
+  // Number of consecutive disconnects without getting an IP address.
+  uint16_t reconnect_failures_;
+
+  // Number of consecutive handshake timeouts during connection setup.
+  uint16_t handshake_timeouts_;
+
+  // Whether to reconnect once a scan finds the current network.
+  bool reconnect_after_scan_;
+
+  // Network whose credentials have been rejected; empty if none.
+  std::string rejected_ssid_;
+
+  // State of the xorshift generator for reconnect jitter; never zero.
+  uint32_t random_state_;
+
+  bool roaming_;
+  int8_t roam_rssi_threshold_;
+  roo_time::Duration roam_dwell_;
+  uint8_t roam_hysteresis_;
+
+  // Whether the signal of the current AP is below the roaming threshold, and
+  // since when.
+  bool roam_weak_;
+  roo_time::Uptime roam_weak_since_;
+
+  // Whether we are re-associating with another AP of the current network.
+  bool roam_in_progress_;
+
+  // Whether the next scan for a stronger AP covers all channels.
+  bool roam_full_scan_;
+
+  // Interface::apGeneration() as of the last getApInfo() that described the
+  // current network; zero if none.
+  uint32_t ap_generation_;
+
+  // Signal strength band monitored by the interface.
+  uint8_t rssi_hysteresis_;
+  bool rssi_band_armed_;
+  int8_t rssi_band_low_;
+  int8_t rssi_band_high_;
+
+  // Inputs to the scan policy.
+  int8_t rssi_trend_;
+  uint16_t list_churn_;
+  uint16_t quiet_scans_;
+
+  roo_scheduler::SingletonTask drain_;
+  roo_scheduler::SingletonTask poll_events_;
+  roo_scheduler::SingletonTask start_scan_;
+  roo_scheduler::SingletonTask refresh_current_network_;
+  roo_scheduler::SingletonTask reconnect_;
+  roo_scheduler::SingletonTask roam_check_;
+};
+
+}  // namespace roo_wifi
+
+#include "roo_wifi/basic_controller_impl.h"
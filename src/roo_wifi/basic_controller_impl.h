@@ -0,0 +1,1607 @@
+#pragma once
+
+// Definitions of the BasicController members. Included by basic_controller.h.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roo_wifi/auto_join.h"
+
+namespace roo_wifi {
+
+template <typename InterfaceT, typename StoreT>
+BasicController<InterfaceT, StoreT>::BasicController(
+    StoreT& store, InterfaceT& interface, roo_scheduler::Scheduler& scheduler)
+    : store_(store),
+      interface_(interface),
+      enabled_(false),
+      current_network_(),
+      current_network_index_(-1),
+      current_network_status_(WL_NO_SSID_AVAIL),
+      all_networks_(),
+      previous_networks_(),
+      scan_candidates_(),
+      scan_hashes_(),
+      scan_slots_(),
+      scan_slot_mask_(0),
+      scan_indices_(),
+      scan_ranks_(),
+      delta_positions_(),
+      scan_diff_(),
+      scan_aps_(),
+      scan_ap_owners_(),
+      access_points_(),
+      wifi_listener_(*this),
+      events_(),
+      drain_pending_(false),
+      dropped_events_(0),
+      dropped_events_seen_(0),
+      last_disconnect_reason_(0),
+      coalesce_events_(false),
+      coalescing_window_(roo_time::Millis(0)),
+      coalescing_wait_(false),
+      pending_connection_event_(Interface::EV_UNKNOWN),
+      pending_connection_events_(0),
+      coalesced_events_(0),
+      model_listeners_(),
+      connecting_(false),
+      auto_join_(false),
+      auto_join_suspended_(false),
+      default_on_success_(false),
+      attempt_pending_(false),
+      attempt_started_(),
+      history_ssid_(),
+      history_(),
+      history_dirty_(false),
+      history_saved_outcome_(0),
+      history_saved_at_(),
+      history_failures_(0),
+      hinted_attempt_(false),
+      stats_(),
+      status_since_(roo_time::Uptime::Now()),
+      trace_(nullptr),
+      associated_(false),
+      associated_at_(),
+      link_lost_(false),
+      link_up_(false),
+      scan_in_progress_(false),
+      scan_timed_(false),
+      scan_started_(),
+      partial_scans_(true),
+      full_scan_every_(8),
+      partial_scans_since_full_(0),
+      scan_options_(),
+      current_scan_(),
+      aggregation_(),
+      last_scan_duration_(roo_time::Millis(0)),
+      default_scan_policy_(),
+      scan_policy_(&default_scan_policy_),
+      default_reconnect_policy_(),
+      reconnect_policy_(&default_reconnect_policy_),
+      reconnect_failures_(0),
+      handshake_timeouts_(0),
+      reconnect_after_scan_(false),
+      rejected_ssid_(),
+      random_state_((uint32_t)roo_time::Uptime::Now().inMicros() | 1),
+      roaming_(false),
+      roam_rssi_threshold_(-75),
+      roam_dwell_(roo_time::Seconds(10)),
+      roam_hysteresis_(8),
+      roam_weak_(false),
+      roam_weak_since_(),
+      roam_in_progress_(false),
+      roam_full_scan_(false),
+      ap_generation_(0),
+      rssi_hysteresis_(5),
+      rssi_band_armed_(false),
+      rssi_band_low_(-128),
+      rssi_band_high_(127),
+      rssi_trend_(0),
+      list_churn_(0),
+      quiet_scans_(0),
+      drain_(scheduler, [this]() { drainEvents(); }),
+      poll_events_(scheduler, [this]() { pollEvents(); }),
+      start_scan_(scheduler, [this]() { startBackgroundScan(); }),
+      refresh_current_network_(scheduler,
+                               [this]() { periodicRefreshCurrentNetwork(); }),
+      reconnect_(scheduler, [this]() { reconnect(); }),
+      roam_check_(scheduler,
+                  [this]() { startBackgroundScan(roam_full_scan_); }) {}
+
+template <typename InterfaceT, typename StoreT>
+BasicController<InterfaceT, StoreT>::~BasicController() {
+  interface_.removeEventListener(&wifi_listener_);
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::begin() {
+  interface_.addEventListener(&wifi_listener_);
+  if (!interface_.deliversEventsOnSchedulerThread()) pollEvents();
+  enabled_ = store_.getIsInterfaceEnabled();
+  if (enabled_) notifyEnableChanged();
+  std::string ssid = store_.getDefaultSSID();
+  trace(TRACE_BEGIN, enabled_, 0, TraceSsidHash(ssid));
+  if (enabled_ && !ssid.empty()) {
+    std::string password;
+    store_.getPassword(ssid, password);
+    initiateConnect(ssid, password, true);
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::addListener(Listener* listener,
+                                                      uint16_t mask) {
+  model_listeners_.add(listener, mask);
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::removeListener(Listener* listener) {
+  model_listeners_.remove(listener);
+}
+
+template <typename InterfaceT, typename StoreT>
+int BasicController<InterfaceT, StoreT>::otherScannedNetworksCount() const {
+  int count = all_networks_.size();
+  if (current_network_index_ >= 0) --count;
+  return count;
+}
+
+template <typename InterfaceT, typename StoreT>
+const ControllerBase::Network&
+BasicController<InterfaceT, StoreT>::currentNetwork() const {
+  return current_network_;
+}
+
+template <typename InterfaceT, typename StoreT>
+const ControllerBase::Network*
+BasicController<InterfaceT, StoreT>::lookupNetwork(
+    roo::string_view ssid) const {
+  for (const Network& net : all_networks_) {
+    if (net.ssid() == ssid) return &net;
+  }
+  return nullptr;
+}
+
+template <typename InterfaceT, typename StoreT>
+ConnectionStatus BasicController<InterfaceT, StoreT>::currentNetworkStatus()
+    const {
+  return current_network_status_;
+}
+
+template <typename InterfaceT, typename StoreT>
+const ControllerBase::Network&
+BasicController<InterfaceT, StoreT>::otherNetwork(int idx) const {
+  if (current_network_index_ >= 0 && idx >= current_network_index_) {
+    idx++;
+  }
+  return all_networks_[idx];
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::startScan() {
+  return startScan(fullScanOptions());
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::startScan(
+    const ScanOptions& options) {
+  bool started = initiateScan(options);
+  trace(TRACE_START_SCAN, started);
+  return started;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::setScanOptions(
+    const ScanOptions& options) {
+  scan_options_ = options;
+}
+
+template <typename InterfaceT, typename StoreT>
+ScanOptions BasicController<InterfaceT, StoreT>::fullScanOptions() const {
+  ScanOptions options = scan_options_;
+  options.channels = ChannelSet::All();
+  options.ssid.clear();
+  return options;
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::startBackgroundScan(bool full) {
+  ScanOptions options = fullScanOptions();
+  if (!full && partial_scans_ &&
+      partial_scans_since_full_ + 1 < full_scan_every_ &&
+      !scanResultsNeeded()) {
+    if (roam_weak_ || (reconnect_after_scan_ && !auto_join_)) {
+      // Looking for the current network specifically.
+      options.ssid.assign(current_network_.ssid().data(),
+                          current_network_.ssid().size());
+    }
+    options.channels = learnedChannels(options.ssid);
+    if (options.channels.empty()) {
+      // Nothing learned yet.
+      options.channels = ChannelSet::All();
+      options.ssid.clear();
+    }
+  }
+  return initiateScan(options);
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::initiateScan(
+    const ScanOptions& options) {
+  bool started = interface_.startScan(options);
+  if (started) {
+    current_scan_ = options;
+    if (options.partial()) {
+      ++partial_scans_since_full_;
+    } else {
+      partial_scans_since_full_ = 0;
+    }
+    scan_in_progress_ = true;
+    scan_timed_ = true;
+    scan_started_ = roo_time::Uptime::Now();
+    for (auto& l : model_listeners_.of(INTEREST_SCAN_STARTED)) {
+      l->onScanStarted();
+    };
+  }
+  return started;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::setScanPolicy(
+    const ScanPolicy* policy) {
+  scan_policy_ = (policy != nullptr) ? policy : &default_scan_policy_;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::setPartialScans(
+    bool enabled, uint8_t full_scan_every) {
+  partial_scans_ = enabled;
+  full_scan_every_ = full_scan_every;
+}
+
+// Collects the channels of known networks: from their connection hints, and
+// from the scan list.
+template <typename InterfaceT, typename StoreT>
+class BasicController<InterfaceT, StoreT>::ChannelLearner
+    : public KnownNetworkVisitor {
+ public:
+  ChannelLearner(const BasicController& controller, roo::string_view ssid)
+      : controller_(controller), ssid_(ssid), channels_() {}
+
+  bool visit(const KnownNetwork& network) override {
+    if (!ssid_.empty() && ssid_ != network.ssid) return true;
+    if ((network.flags & KNOWN_NETWORK_HINT) != 0) {
+      channels_.add(network.hint.channel);
+    }
+    const Network* scanned = controller_.lookupNetwork(network.ssid);
+    if (scanned != nullptr) {
+      for (int i = 0; i < controller_.accessPointCount(*scanned); ++i) {
+        channels_.add(controller_.accessPoint(*scanned, i).channel);
+      }
+    }
+    return true;
+  }
+
+  ChannelSet channels() const { return channels_; }
+
+ private:
+  const BasicController& controller_;
+  roo::string_view ssid_;
+  ChannelSet channels_;
+};
+
+template <typename InterfaceT, typename StoreT>
+ChannelSet BasicController<InterfaceT, StoreT>::learnedChannels(
+    roo::string_view ssid) const {
+  ChannelLearner learner(*this, ssid);
+  if (!store_.forEachKnownNetwork(learner)) return ChannelSet();
+  return learner.channels();
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::toggleEnabled() {
+  enabled_ = !enabled_;
+  trace(TRACE_TOGGLE_ENABLED, enabled_);
+  store_.setIsInterfaceEnabled(enabled_);
+  if (!enabled_) {
+    resetReconnect();
+    interface_.disconnect();
+  }
+  connecting_ = false;
+  notifyEnableChanged();
+  if (enabled_) {
+    resume();
+  } else {
+    pause();
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::notifyEnableChanged() {
+  for (auto& l : model_listeners_.of(INTEREST_ENABLE)) {
+    l->onEnableChanged(enabled_);
+  };
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::getStoredPassword(
+    const std::string& ssid, std::string& passwd) const {
+  return store_.getPassword(ssid, passwd);
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::pause() { start_scan_.cancel(); }
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::resume() {
+  if (!enabled_) return;
+  refreshCurrentNetwork();
+  if (!refresh_current_network_.is_scheduled()) {
+    scheduleNextRefresh();
+  }
+  if (interface_.scanCompleted()) {
+    for (auto& l : model_listeners_.of(INTEREST_SCAN_COMPLETED)) {
+      l->onScanCompleted();
+    };
+    scheduleNextScan();
+  } else {
+    startBackgroundScan();
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::setPassword(
+    const std::string& ssid, const std::string& passwd) {
+  if (ssid == rejected_ssid_) rejected_ssid_.clear();
+  store_.setPassword(ssid, passwd);
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::connect() {
+  std::string ssid = store_.getDefaultSSID();
+  std::string password;
+  store_.getPassword(ssid, password);
+  trace(TRACE_CONNECT, (password.empty() ? 1 : 0) | 2, 0, TraceSsidHash(ssid));
+  resetReconnect();
+  rejected_ssid_.clear();
+  return initiateConnect(ssid, password, true);
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::connect(const std::string& ssid,
+                                                  const std::string& passwd) {
+  trace(TRACE_CONNECT, passwd.empty() ? 1 : 0, 0, TraceSsidHash(ssid));
+  resetReconnect();
+  rejected_ssid_.clear();
+  return initiateConnect(ssid, passwd, true);
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::initiateConnect(
+    const std::string& ssid, const std::string& passwd, bool make_default) {
+  auto_join_suspended_ = false;
+  reconnect_.cancel();
+  reconnect_after_scan_ = false;
+  roam_in_progress_ = false;
+  RecordConnectionAttempt(connectionHistory(ssid));
+  history_dirty_ = true;
+  {
+    StoreBatch<StoreT> batch(store_);
+    if (make_default) {
+      default_on_success_ = false;
+      if (ssid != store_.getDefaultSSID()) store_.setDefaultSSID(ssid);
+    }
+    std::string current_password;
+    if (!passwd.empty() && (!store_.getPassword(ssid, current_password) ||
+                            current_password != passwd)) {
+      store_.setPassword(ssid, passwd);
+    }
+  }
+  ConnectionHint hint;
+  hinted_attempt_ = store_.getConnectionHint(ssid, hint);
+  bool started = hinted_attempt_ ? interface_.connect(ssid, passwd, hint)
+                                 : interface_.connect(ssid, passwd);
+  if (!started) {
+    hinted_attempt_ = false;
+    return false;
+  }
+  countConnectAttempt();
+  connecting_ = true;
+  attempt_pending_ = true;
+  attempt_started_ = roo_time::Uptime::Now();
+  associated_ = false;
+  const Network* in_range = lookupNetwork(ssid);
+  if (in_range == nullptr) {
+    updateCurrentNetwork(ssid, passwd.empty(), -128, WL_DISCONNECTED, true);
+  } else {
+    updateCurrentNetwork(ssid, in_range->open, in_range->rssi, WL_DISCONNECTED,
+                         true);
+  }
+  return true;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::disconnect() {
+  trace(TRACE_DISCONNECT);
+  resetReconnect();
+  roam_in_progress_ = false;
+  auto_join_suspended_ = true;
+  attempt_pending_ = false;
+  link_lost_ = false;
+  connecting_ = false;
+  hinted_attempt_ = false;
+  interface_.disconnect();
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::forget(const std::string& ssid) {
+  trace(TRACE_FORGET, 0, 0, TraceSsidHash(ssid));
+  if (ssid == rejected_ssid_) rejected_ssid_.clear();
+  if (current_network_.ssid() == roo::string_view(ssid)) resetReconnect();
+  StoreBatch<StoreT> batch(store_);
+  store_.clearPassword(ssid);
+  store_.clearConnectionHint(ssid);
+  store_.clearConnectionHistory(ssid);
+  if (ssid == history_ssid_) {
+    history_ssid_.clear();
+    history_dirty_ = false;
+  }
+  if (ssid == store_.getDefaultSSID()) {
+    store_.clearDefaultSSID();
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::enqueueEvent(
+    const Interface::Event& event) {
+  if (!events_.push(event)) {
+    dropped_events_.fetch_add(1);
+  }
+  // Unless we are on the scheduler thread, the scheduler may be running
+  // concurrently, so leave it to pollEvents() to pick the events up.
+  if (!drain_pending_.exchange(true) &&
+      interface_.deliversEventsOnSchedulerThread()) {
+    drain_.scheduleNow();
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::pollEvents() {
+  // While waiting for a coalescing window, drain_ is already scheduled.
+  if (drain_pending_.load() && !coalescing_wait_) drainEvents();
+  poll_events_.scheduleAfter(roo_time::Millis(internal::kEventPollIntervalMs));
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::drainEvents() {
+  if (coalesce_events_ && coalescing_window_ > roo_time::Millis(0) &&
+      !coalescing_wait_) {
+    // Let the burst play out. The flag stays set, so that we do not get
+    // re-scheduled, nor polled, in the meantime.
+    coalescing_wait_ = true;
+    drain_.scheduleAfter(coalescing_window_);
+    return;
+  }
+  coalescing_wait_ = false;
+  // Clear the flag first, so that events pushed from now on trigger another
+  // drain. (An exchange, so that we see the events whose producers found the
+  // flag set.)
+  drain_pending_.exchange(false);
+  Interface::Event event;
+  while (events_.pop(event)) {
+    processEvent(event);
+  }
+  flushConnectionStateChanges();
+  uint32_t dropped = dropped_events_.load();
+  if (dropped != dropped_events_seen_) {
+    trace(TRACE_EVENTS_DROPPED, 0, 0, dropped - dropped_events_seen_);
+    // Some events got lost; catch up with the state of the interface.
+    dropped_events_seen_ = dropped;
+    refreshCurrentNetwork();
+    // Only a scan that we are still waiting for; the results of a processed
+    // one stay around.
+    if (scan_in_progress_ && interface_.scanCompleted()) onScanCompleted();
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::processEvent(
+    const Interface::Event& event) {
+  trace(TRACE_EVENT, event.type, event.reason);
+  switch (event.type) {
+    case Interface::EV_SCAN_COMPLETED: {
+      flushConnectionStateChanges();
+      onScanCompleted();
+      break;
+    }
+    case Interface::EV_RSSI_CHANGED: {
+      flushConnectionStateChanges();
+      onRssiChanged();
+      break;
+    }
+    case Interface::EV_DISCONNECTED:
+    case Interface::EV_CONNECTION_FAILED:
+    case Interface::EV_CONNECTION_LOST: {
+      last_disconnect_reason_ = event.reason;
+      countDisconnect(event.reason);
+    }
+      // fall through
+    default: {
+      if (coalesce_events_) {
+        coalesceConnectionStateChange(event.type);
+      } else {
+        onConnectionStateChanged(event.type);
+      }
+      break;
+    }
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::setEventCoalescing(
+    bool enabled, roo_time::Duration window) {
+  coalesce_events_ = enabled;
+  coalescing_window_ = window;
+  if (!enabled) flushConnectionStateChanges();
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::onConnectionStateChanged(
+    Interface::EventType type) {
+  if (applyConnectionStateChange(type)) {
+    notifyConnectionStateChange(type);
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::applyConnectionStateChange(
+    Interface::EventType type) {
+  if (type == Interface::EV_UNKNOWN) return false;
+  if (roam_in_progress_ &&
+      (type == Interface::EV_CONNECTED ||
+       (type == Interface::EV_DISCONNECTED &&
+        last_disconnect_reason_ == Interface::REASON_ASSOC_LEAVE))) {
+    // Moving between APs of the same network. As far as listeners are
+    // concerned, the link stays up.
+    return false;
+  }
+  if (hinted_attempt_ && connecting_ &&
+      (type == Interface::EV_DISCONNECTED ||
+       type == Interface::EV_CONNECTION_LOST)) {
+    // The AP from the hint did not respond, e.g. because it is gone or has
+    // moved to a different channel. Transparently fall back to the plain
+    // connect.
+    if (retryWithoutHint()) return false;
+  }
+  quiet_scans_ = 0;
+  roo_time::Uptime now = roo_time::Uptime::Now();
+  if (type == Interface::EV_CONNECTED && attempt_pending_ && !associated_) {
+    associated_ = true;
+    associated_at_ = now;
+    stats_.connect_latency.add(now - attempt_started_);
+  }
+  if (type == Interface::EV_GOT_IP) {
+    if (associated_) {
+      associated_ = false;
+      stats_.got_ip_latency.add(now - associated_at_);
+    }
+    link_lost_ = false;
+    link_up_ = true;
+    hinted_attempt_ = false;
+    reconnect_failures_ = 0;
+    handshake_timeouts_ = 0;
+    roam_in_progress_ = false;
+    StoreBatch<StoreT> batch(store_);
+    if (default_on_success_) {
+      default_on_success_ = false;
+      store_.setDefaultSSID(std::string(current_network_.ssid().data(),
+                                        current_network_.ssid().size()));
+    }
+    rememberConnectionHint();
+    recordConnectionSuccess();
+  }
+  if (type == Interface::EV_DISCONNECTED ||
+      type == Interface::EV_CONNECTION_FAILED ||
+      type == Interface::EV_CONNECTION_LOST) {
+    if (attempt_pending_) recordConnectionFailure();
+    // Unless disconnect() has been called.
+    bool dropped = connecting_;
+    bool link_was_up = link_up_;
+    if (link_was_up && dropped) link_lost_ = true;
+    link_up_ = false;
+    connecting_ = false;
+    attempt_pending_ = false;
+    associated_ = false;
+    hinted_attempt_ = false;
+    rssi_band_armed_ = false;
+    roam_in_progress_ = false;
+    if (dropped) scheduleReconnect(type, link_was_up);
+  }
+  return true;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::notifyConnectionStateChange(
+    Interface::EventType type) {
+  updateCurrentNetwork(current_network_.ssid(), current_network_.open,
+                       current_network_.rssi,
+                       internal::getConnectionStatus(type), true);
+  for (auto& l : model_listeners_.of(INTEREST_CONNECTION_STATE)) {
+    l->onConnectionStateChanged(type);
+  }
+  resumeMonitoring(type);
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::resumeMonitoring(
+    Interface::EventType type) {
+  if (type == Interface::EV_GOT_IP && rssiEventsActive()) {
+    // Pick up the actual signal strength, and start monitoring it.
+    refreshCurrentNetwork();
+  } else if (enabled_ && !rssiEventsActive() &&
+             !refresh_current_network_.is_scheduled()) {
+    // No longer event-driven; resume polling.
+    scheduleNextRefresh();
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::coalesceConnectionStateChange(
+    Interface::EventType type) {
+  if (!applyConnectionStateChange(type)) return;
+  pending_connection_event_ = type;
+  ++pending_connection_events_;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::flushConnectionStateChanges() {
+  if (pending_connection_events_ == 0) return;
+  uint16_t count = pending_connection_events_;
+  pending_connection_events_ = 0;
+  if (count > 1 && internal::getConnectionStatus(pending_connection_event_) ==
+                       current_network_status_) {
+    // A flap that ended where it started.
+    coalesced_events_ += count;
+    resumeMonitoring(pending_connection_event_);
+    return;
+  }
+  coalesced_events_ += count - 1;
+  notifyConnectionStateChange(pending_connection_event_);
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::rssiEventsActive() const {
+  return current_network_status_ == WL_CONNECTED &&
+         interface_.rssiMonitoring() != Interface::RSSI_MONITORING_NONE;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::armRssiBand() {
+  if (!rssiEventsActive()) {
+    rssi_band_armed_ = false;
+    return;
+  }
+  int8_t rssi = current_network_.rssi;
+  if (rssi_band_armed_ && rssi >= rssi_band_low_ && rssi <= rssi_band_high_) {
+    return;
+  }
+  rssi_band_low_ = std::max(-128, rssi - rssi_hysteresis_);
+  rssi_band_high_ = std::min(127, rssi + rssi_hysteresis_);
+  rssi_band_armed_ = true;
+  interface_.setRssiBand(rssi_band_low_, rssi_band_high_);
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::onRssiChanged() {
+  rssi_band_armed_ = false;
+  refreshCurrentNetwork();
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::scanResultsNeeded() {
+  for (auto& l : model_listeners_.of(INTEREST_SCAN_COMPLETED)) {
+    if (l->needsScanResults()) return true;
+  }
+  for (auto& l : model_listeners_.of(INTEREST_SCAN_DELTAS)) {
+    if (l->needsScanResults()) return true;
+  }
+  return false;
+}
+
+template <typename InterfaceT, typename StoreT>
+ScanPolicy::Inputs BasicController<InterfaceT, StoreT>::scanPolicyInputs() {
+  ScanPolicy::Inputs inputs;
+  inputs.status = current_network_status_;
+  inputs.scan_results_needed = scanResultsNeeded();
+  inputs.rssi = current_network_.rssi;
+  inputs.rssi_trend = rssi_trend_;
+  inputs.list_churn = list_churn_;
+  inputs.quiet_scans = quiet_scans_;
+  return inputs;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::scheduleNextScan() {
+  roo_time::Duration delay;
+  if (scan_policy_->nextScanDelay(scanPolicyInputs(), delay)) {
+    start_scan_.scheduleAfter(delay);
+  } else {
+    start_scan_.cancel();
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::scheduleNextRefresh() {
+  if (rssiEventsActive()) {
+    // The interface tells us when the signal changes; no need to poll.
+    refresh_current_network_.cancel();
+    return;
+  }
+  roo_time::Duration delay;
+  if (scan_policy_->nextRefreshDelay(scanPolicyInputs(), delay)) {
+    refresh_current_network_.scheduleAfter(delay);
+  } else {
+    refresh_current_network_.cancel();
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::retryWithoutHint() {
+  hinted_attempt_ = false;
+  std::string ssid(current_network_.ssid().data(),
+                   current_network_.ssid().size());
+  std::string passwd;
+  store_.getPassword(ssid, passwd);
+  store_.clearConnectionHint(ssid);
+  if (!interface_.connect(ssid, passwd)) return false;
+  countConnectAttempt();
+  return true;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::rememberConnectionHint() {
+  NetworkDetails info;
+  if (!interface_.getApInfo(&info)) return;
+  std::string ssid((const char*)info.ssid, internal::SsidLength(info));
+  ConnectionHint hint;
+  memcpy(hint.bssid, info.bssid, 6);
+  hint.channel = info.primary;
+  ConnectionHint stored;
+  if (store_.getConnectionHint(ssid, stored) &&
+      memcmp(stored.bssid, hint.bssid, 6) == 0 &&
+      stored.channel == hint.channel) {
+    return;
+  }
+  store_.setConnectionHint(ssid, hint);
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::periodicRefreshCurrentNetwork() {
+  refreshCurrentNetwork();
+  if (isEnabled()) {
+    scheduleNextRefresh();
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::refreshCurrentNetwork() {
+  // If the association has not changed since the last full query, only the
+  // signal strength and the status can have changed.
+  uint32_t generation = interface_.apGeneration();
+  int8_t rssi;
+  if (generation != 0 && generation == ap_generation_ &&
+      interface_.getRssi(&rssi)) {
+    if (rssi != current_network_.rssi) trace(TRACE_RSSI, (uint8_t)rssi);
+    updateCurrentNetwork(current_network_.ssid(), current_network_.open, rssi,
+                         interface_.getStatus(), false);
+    armRssiBand();
+    return;
+  }
+  // If we're connected to the network, this is it.
+  NetworkDetails current;
+  if (interface_.getApInfo(&current)) {
+    ap_generation_ = generation;
+    if (current.rssi != current_network_.rssi) {
+      trace(TRACE_RSSI, (uint8_t)current.rssi);
+    }
+    updateCurrentNetwork(roo::string_view((const char*)current.ssid,
+                                          internal::SsidLength(current)),
+                         (current.authmode == WIFI_AUTH_OPEN), current.rssi,
+                         current.status, false);
+    memcpy(current_network_.bssid, current.bssid, 6);
+    current_network_.channel = current.primary;
+    armRssiBand();
+  } else {
+    ap_generation_ = 0;
+    memset(current_network_.bssid, 0, 6);
+    current_network_.channel = 0;
+    // Check if we have a default network.
+    std::string default_ssid = store_.getDefaultSSID();
+    const Network* default_network_in_range = nullptr;
+    if (!default_ssid.empty()) {
+      // See if the default network is in range according to the latest
+      // scan results.
+      default_network_in_range = lookupNetwork(default_ssid);
+    }
+    // Keep erroneous states sticky. Only update if the network has actually
+    // changed.
+    if (default_network_in_range == nullptr) {
+      ConnectionStatus new_status = (current_network_.ssid() == default_ssid)
+                                        ? current_network_status_
+                                        : WL_NO_SSID_AVAIL;
+      updateCurrentNetwork(default_ssid, true, -128, new_status, false);
+    } else {
+      ConnectionStatus new_status = (current_network_.ssid() == default_ssid)
+                                        ? current_network_status_
+                                        : WL_DISCONNECTED;
+      updateCurrentNetwork(default_ssid, default_network_in_range->open,
+                           default_network_in_range->rssi, new_status, false);
+    }
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::updateCurrentNetwork(
+    roo::string_view ssid, bool open, int8_t rssi, ConnectionStatus status,
+    bool force_notify) {
+  if (current_network_.ssid() == ssid && rssi != -128 &&
+      current_network_.rssi != -128) {
+    int trend = rssi - current_network_.rssi;
+    rssi_trend_ = std::max(-128, std::min(127, trend));
+  } else {
+    rssi_trend_ = 0;
+  }
+  bool signal_only = !force_notify && current_network_.ssid() == ssid &&
+                     open == current_network_.open &&
+                     status == current_network_status_;
+  if (signal_only && rssi == current_network_.rssi) return;
+  current_network_.setSsid(ssid);
+  current_network_.open = open;
+  current_network_.rssi = rssi;
+  setCurrentNetworkStatus(status);
+  current_network_index_ = -1;
+  for (size_t i = 0; i < all_networks_.size(); ++i) {
+    if (all_networks_[i].ssid() == current_network_.ssid()) {
+      current_network_index_ = static_cast<int16_t>(i);
+      break;
+    }
+  }
+  for (auto& l : model_listeners_.of(signal_only ? INTEREST_SIGNAL_STRENGTH
+                                                : INTEREST_CURRENT_NETWORK)) {
+    l->onCurrentNetworkChanged();
+  };
+  updateRoaming();
+}
+
+template <typename InterfaceT, typename StoreT>
+class BasicController<InterfaceT, StoreT>::ScanDeltaNotifier
+    : public internal::ScanListDiff::Sink {
+ public:
+  ScanDeltaNotifier(BasicController& controller)
+      : controller_(controller), membership_changes_(0) {}
+
+  // Returns the number of networks that have been added or removed.
+  uint16_t membership_changes() const { return membership_changes_; }
+
+  void removed(int idx) override {
+    ++membership_changes_;
+    for (auto& l : controller_.model_listeners_.of(INTEREST_SCAN_DELTAS)) {
+      l->onScannedNetworkRemoved(idx);
+    }
+  }
+
+  void added(int idx, int new_pos) override {
+    ++membership_changes_;
+    const Network& network = controller_.all_networks_[new_pos];
+    for (auto& l : controller_.model_listeners_.of(INTEREST_SCAN_DELTAS)) {
+      l->onScannedNetworkAdded(idx, network);
+    }
+  }
+
+  void moved(int from_idx, int to_idx) override {
+    for (auto& l : controller_.model_listeners_.of(INTEREST_SCAN_DELTAS)) {
+      l->onScannedNetworkMoved(from_idx, to_idx);
+    }
+  }
+
+ private:
+  BasicController& controller_;
+  uint16_t membership_changes_;
+};
+
+// De-duplicates scan results by SSID, as they are streamed from the
+// interface, keeping the strongest signal of each. Results go straight into
+// the controller's candidate table, without intermediate copies.
+template <typename InterfaceT, typename StoreT>
+class BasicController<InterfaceT, StoreT>::ScanCollector
+    : public Interface::ScanResultVisitor {
+ public:
+  ScanCollector(BasicController& controller)
+      : controller_(controller), seen_(0) {
+    // Scan populations tend to be stable, so size the table for the previous
+    // one, avoiding rehashes as the table grows.
+    size_t table_size = 16;
+    while (table_size < 2 * controller_.scan_candidates_.size()) {
+      table_size <<= 1;
+    }
+    controller_.scan_candidates_.clear();
+    controller_.scan_hashes_.clear();
+    controller_.scan_aps_.clear();
+    controller_.scan_ap_owners_.clear();
+    controller_.resetScanTable(table_size);
+  }
+
+  bool visit(const NetworkDetails& result) override {
+    if (inScope(result)) add(result);
+    return ++seen_ < internal::kMaxRawScanResults;
+  }
+
+  // Adds a result to the candidates.
+  void add(const NetworkDetails& result) {
+    BasicController& c = controller_;
+    // Keep the load factor at or below 1/2, so probe sequences stay short.
+    if (2 * (c.scan_candidates_.size() + 1) > c.scan_slot_mask_ + 1) {
+      c.resetScanTable(2 * (c.scan_slot_mask_ + 1));
+    }
+    size_t len = internal::SsidLength(result);
+    uint32_t hash = internal::HashSsid(result.ssid, len);
+    size_t slot = hash & c.scan_slot_mask_;
+    while (true) {
+      uint16_t& entry = c.scan_slots_[slot];
+      if (entry == 0) {
+        c.scan_candidates_.emplace_back();
+        Network& added = c.scan_candidates_.back();
+        added.setSsid(roo::string_view((const char*)result.ssid, len));
+        added.open = (result.authmode == WIFI_AUTH_OPEN);
+        added.rssi = result.rssi;
+        memcpy(added.bssid, result.bssid, 6);
+        added.channel = result.primary;
+        c.scan_hashes_.push_back(hash);
+        entry = static_cast<uint16_t>(c.scan_candidates_.size());
+        addAccessPoint(result, entry - 1);
+        break;
+      }
+      Network& existing = c.scan_candidates_[entry - 1];
+      if (c.scan_hashes_[entry - 1] == hash && existing.ssid().size() == len &&
+          memcmp(existing.ssid().data(), result.ssid, len) == 0) {
+        if (result.rssi > existing.rssi) {
+          // Keep the stronger one, in the place of the older one, so that
+          // ties in the sort are still broken by the first occurrence.
+          existing.open = (result.authmode == WIFI_AUTH_OPEN);
+          existing.rssi = result.rssi;
+          memcpy(existing.bssid, result.bssid, 6);
+          existing.channel = result.primary;
+        }
+        addAccessPoint(result, entry - 1);
+        break;
+      }
+      slot = (slot + 1) & c.scan_slot_mask_;
+    }
+  }
+
+  int seen() const { return seen_; }
+
+ private:
+  // Returns true if the result is within what the scan was supposed to
+  // cover. Interfaces may scan more; such extra results are dropped, as the
+  // APs on the channels not covered get carried over from the previous scan.
+  // Full scans keep everything, including results on channels that the set
+  // cannot represent (e.g. 0, from interfaces that do not report it).
+  bool inScope(const NetworkDetails& result) const {
+    const BasicController& c = controller_;
+    const ScanOptions& scan = c.current_scan_;
+    if (!scan.channels.isAll() && !scan.channels.contains(result.primary)) {
+      return false;
+    }
+    return scan.ssid.empty() ||
+           scan.ssid == roo::string_view((const char*)result.ssid,
+                                         internal::SsidLength(result));
+  }
+
+  void addAccessPoint(const NetworkDetails& result, uint16_t owner) {
+    AccessPoint ap;
+    memcpy(ap.bssid, result.bssid, 6);
+    ap.channel = result.primary;
+    ap.rssi = result.rssi;
+    controller_.scan_aps_.push_back(ap);
+    controller_.scan_ap_owners_.push_back(owner);
+  }
+
+  BasicController& controller_;
+  int seen_;
+};
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::carryOverAccessPoints(
+    ScanCollector& collector) const {
+  for (const Network& network : all_networks_) {
+    readdAccessPoints(collector, network, true);
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::readdAccessPoints(
+    ScanCollector& collector, const Network& network,
+    bool unscanned_only) const {
+  roo::string_view ssid = network.ssid();
+  bool ssid_scanned = current_scan_.ssid.empty() || current_scan_.ssid == ssid;
+  NetworkDetails details;
+  memset(&details, 0, sizeof(details));
+  memcpy(details.ssid, ssid.data(), ssid.size());
+  details.ssid[ssid.size()] = 0;
+  details.authmode = network.open ? WIFI_AUTH_OPEN : WIFI_AUTH_UNKNOWN;
+  for (int i = 0; i < accessPointCount(network); ++i) {
+    const AccessPoint& ap = accessPoint(network, i);
+    if (unscanned_only && ssid_scanned &&
+        current_scan_.channels.contains(ap.channel)) {
+      continue;
+    }
+    memcpy(details.bssid, ap.bssid, 6);
+    details.primary = ap.channel;
+    details.rssi = ap.rssi;
+    collector.add(details);
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::aggregateScans(
+    ScanCollector& collector) {
+  for (Network& network : scan_candidates_) {
+    network.smoothed_rssi_ = network.rssi * 16;
+    network.sort_rssi_ = network.rssi;
+    network.missed_scans_ = 0;
+    network.previous_position_ = UINT16_MAX;
+  }
+  if (aggregation_.rssi_weight >= 1 && aggregation_.max_missed_scans == 0 &&
+      aggregation_.reorder_hysteresis == 0) {
+    // Each scan replaces the list.
+    return;
+  }
+  for (size_t i = 0; i < all_networks_.size(); ++i) {
+    const Network& previous = all_networks_[i];
+    int idx = findScanResult(previous.ssid());
+    if (idx < 0) {
+      if (previous.missed_scans_ >= aggregation_.max_missed_scans) continue;
+      // Keep it, as it was, for now.
+      readdAccessPoints(collector, previous, false);
+      idx = findScanResult(previous.ssid());
+      if (idx < 0) continue;
+      Network& network = scan_candidates_[idx];
+      network.missed_scans_ = previous.missed_scans_ + 1;
+      network.smoothed_rssi_ = previous.smoothed_rssi_;
+    } else {
+      Network& network = scan_candidates_[idx];
+      network.smoothed_rssi_ =
+          previous.smoothed_rssi_ +
+          (int16_t)lroundf(aggregation_.rssi_weight *
+                           (network.smoothed_rssi_ - previous.smoothed_rssi_));
+    }
+    Network& network = scan_candidates_[idx];
+    network.rssi = (int8_t)lroundf(network.smoothed_rssi_ / 16.0f);
+    network.sort_rssi_ =
+        (abs(network.rssi - previous.sort_rssi_) >
+         aggregation_.reorder_hysteresis)
+            ? network.rssi
+            : previous.sort_rssi_;
+    network.previous_position_ = static_cast<uint16_t>(i);
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::onScanCompleted() {
+  scan_in_progress_ = false;
+  current_network_index_ = -1;
+  uint16_t results;
+  bool partial = current_scan_.partial();
+  size_t max_results = current_scan_.max_results;
+  {
+    ScanCollector collector(*this);
+    if (!interface_.forEachScanResult(collector)) {
+      scan_candidates_.clear();
+      scan_hashes_.clear();
+      scan_aps_.clear();
+      scan_ap_owners_.clear();
+    }
+    if (partial) {
+      carryOverAccessPoints(collector);
+      ++stats_.partial_scans;
+    }
+    aggregateScans(collector);
+    // Scans that we did not start are full ones, as far as we know.
+    current_scan_ = fullScanOptions();
+    results = collector.seen();
+    ++stats_.scans;
+    stats_.scan_results += results;
+    stats_.last_scan_results = results;
+    stats_.max_scan_results = std::max(stats_.max_scan_results, results);
+  }
+  groupAccessPoints();
+  if (scan_timed_) {
+    scan_timed_ = false;
+    last_scan_duration_ = roo_time::Uptime::Now() - scan_started_;
+    stats_.scan_duration.add(last_scan_duration_);
+  }
+  // Now, select the top networks by signal strength. Ties are broken by the
+  // previous order (when aggregating), and then by the order of the scan
+  // results, so that the outcome is deterministic.
+  size_t unique_count = scan_candidates_.size();
+  scan_indices_.resize(unique_count);
+  for (size_t i = 0; i < unique_count; ++i) {
+    scan_indices_[i] = static_cast<uint16_t>(i);
+  }
+  size_t count = std::min<size_t>(unique_count, max_results);
+  std::partial_sort(scan_indices_.begin(), scan_indices_.begin() + count,
+                    scan_indices_.end(), [&](uint16_t a, uint16_t b) -> bool {
+                      const Network& net_a = scan_candidates_[a];
+                      const Network& net_b = scan_candidates_[b];
+                      if (net_a.sort_rssi_ != net_b.sort_rssi_) {
+                        return net_a.sort_rssi_ > net_b.sort_rssi_;
+                      }
+                      if (net_a.previous_position_ !=
+                          net_b.previous_position_) {
+                        return net_a.previous_position_ <
+                               net_b.previous_position_;
+                      }
+                      return a < b;
+                    });
+  // Finally, fill in the results, retaining the previous list for deltas.
+  std::swap(all_networks_, previous_networks_);
+  all_networks_.resize(count);
+  bool found = false;
+  for (size_t i = 0; i < count; ++i) {
+    Network& dst = all_networks_[i];
+    dst = scan_candidates_[scan_indices_[i]];
+    if (!found && dst.ssid() == current_network_.ssid()) {
+      found = true;
+      current_network_index_ = static_cast<int16_t>(i);
+      if (current_network_status_ == WL_NO_SSID_AVAIL) {
+        setCurrentNetworkStatus(WL_DISCONNECTED);
+      }
+    }
+  }
+  if (!found && current_network_status_ == WL_DISCONNECTED) {
+    setCurrentNetworkStatus(WL_NO_SSID_AVAIL);
+  }
+  if (trace_ != nullptr) {
+    trace_->record(TRACE_SCAN, std::min<size_t>(count, 255), results,
+                   found ? TraceSsidHash(current_network_.ssid()) : 0,
+                   found ? ((uint8_t)current_network_.rssi |
+                            (current_network_.open ? 0x100 : 0))
+                         : 0);
+  }
+  list_churn_ = notifyScanDeltas();
+  if (rssiEventsActive()) {
+    // Piggy-back on the scan to catch signal improvements, which interfaces
+    // with RSSI_MONITORING_LOW do not report.
+    refreshCurrentNetwork();
+  }
+  if (current_network_status_ == WL_CONNECTED && list_churn_ == 0 &&
+      !scanResultsNeeded()) {
+    if (quiet_scans_ < UINT16_MAX) ++quiet_scans_;
+  } else {
+    quiet_scans_ = 0;
+  }
+  for (auto& l : model_listeners_.of(INTEREST_SCAN_COMPLETED)) {
+    l->onScanCompleted();
+  };
+  if (enabled_) {
+    if (roam_weak_ &&
+        roo_time::Uptime::Now() - roam_weak_since_ >= roam_dwell_ &&
+        !tryRoam()) {
+      // Give the signal another dwell period before looking again, this
+      // time on all channels, in case that another AP has shown up.
+      roam_full_scan_ = partial;
+      roam_weak_since_ = roo_time::Uptime::Now();
+      roam_check_.scheduleAfter(roam_dwell_);
+    }
+    if (reconnect_after_scan_ && found) reconnect();
+    autoJoin();
+    scheduleNextScan();
+  }
+}
+
+// Finds the best-ranking known network among the scanned ones.
+template <typename InterfaceT, typename StoreT>
+class BasicController<InterfaceT, StoreT>::AutoJoinRanker
+    : public KnownNetworkVisitor {
+ public:
+  AutoJoinRanker(const BasicController& controller)
+      : controller_(controller), best_(nullptr), best_score_(0) {}
+
+  bool visit(const KnownNetwork& known) override {
+    if (known.ssid == controller_.rejected_ssid_) return true;
+    const Network* network = controller_.lookupNetwork(known.ssid);
+    if (network == nullptr) return true;
+    const ConnectionHistory* history =
+        (known.flags & KNOWN_NETWORK_HISTORY) ? &known.history : nullptr;
+    if (known.ssid == controller_.history_ssid_) {
+      // Possibly more recent than the stored one.
+      history = &controller_.history_;
+    }
+    if (!(known.flags & KNOWN_NETWORK_PASSWORD)) {
+      // Open networks count as known once we have connected to them.
+      if (!network->open || history == nullptr || history->successes == 0) {
+        return true;
+      }
+    }
+    int score = AutoJoinScore(network->rssi, history);
+    if (best_ == nullptr || score > best_score_) {
+      best_ = network;
+      best_score_ = score;
+      best_password_ = known.password;
+    }
+    return true;
+  }
+
+  const Network* best() const { return best_; }
+  const std::string& bestPassword() const { return best_password_; }
+
+ private:
+  const BasicController& controller_;
+  const Network* best_;
+  int best_score_;
+  std::string best_password_;
+};
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::autoJoin() {
+  if (!auto_join_ || auto_join_suspended_ || connecting_ ||
+      current_network_status_ == WL_CONNECTED ||
+      current_network_status_ == WL_IDLE_STATUS) {
+    return;
+  }
+  AutoJoinRanker ranker(*this);
+  store_.forEachKnownNetwork(ranker);
+  if (ranker.best() == nullptr) return;
+  // Candidates that do not work out must not replace the default network.
+  default_on_success_ = true;
+  initiateConnect(std::string(ranker.best()->ssid().data(),
+                              ranker.best()->ssid().size()),
+                  ranker.bestPassword(), false);
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::groupAccessPoints() {
+  // Counting sort by network.
+  for (Network& network : scan_candidates_) network.ap_count_ = 0;
+  for (uint16_t owner : scan_ap_owners_) ++scan_candidates_[owner].ap_count_;
+  uint16_t begin = 0;
+  for (Network& network : scan_candidates_) {
+    network.ap_begin_ = begin;
+    begin += network.ap_count_;
+    network.ap_count_ = 0;
+  }
+  access_points_.resize(scan_aps_.size());
+  for (size_t i = 0; i < scan_aps_.size(); ++i) {
+    Network& network = scan_candidates_[scan_ap_owners_[i]];
+    // Insertion sort by signal strength; networks have few APs.
+    AccessPoint* aps = &access_points_[network.ap_begin_];
+    int pos = network.ap_count_++;
+    while (pos > 0 && aps[pos - 1].rssi < scan_aps_[i].rssi) {
+      aps[pos] = aps[pos - 1];
+      --pos;
+    }
+    aps[pos] = scan_aps_[i];
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::setRoaming(bool enabled,
+                                                     int8_t rssi_threshold,
+                                                     roo_time::Duration dwell,
+                                                     uint8_t hysteresis) {
+  roaming_ = enabled;
+  roam_rssi_threshold_ = rssi_threshold;
+  roam_dwell_ = dwell;
+  roam_hysteresis_ = hysteresis;
+  updateRoaming();
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::updateRoaming() {
+  bool weak = roaming_ && !roam_in_progress_ &&
+              current_network_status_ == WL_CONNECTED &&
+              current_network_.rssi != -128 &&
+              current_network_.rssi < roam_rssi_threshold_;
+  if (weak == roam_weak_) return;
+  roam_weak_ = weak;
+  if (weak) {
+    roam_weak_since_ = roo_time::Uptime::Now();
+    roam_check_.scheduleAfter(roam_dwell_);
+  } else {
+    roam_check_.cancel();
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+bool BasicController<InterfaceT, StoreT>::tryRoam() {
+  const Network* network = lookupNetwork(current_network_.ssid());
+  if (network == nullptr) return false;
+  for (int i = 0; i < accessPointCount(*network); ++i) {
+    const AccessPoint& ap = accessPoint(*network, i);
+    if (ap.rssi < current_network_.rssi + roam_hysteresis_) break;
+    if (memcmp(ap.bssid, current_network_.bssid, 6) == 0) continue;
+    std::string ssid(current_network_.ssid().data(),
+                     current_network_.ssid().size());
+    std::string passwd;
+    store_.getPassword(ssid, passwd);
+    ConnectionHint hint;
+    memcpy(hint.bssid, ap.bssid, 6);
+    hint.channel = ap.channel;
+    if (!interface_.connect(ssid, passwd, hint)) return false;
+    ++stats_.roams;
+    countConnectAttempt();
+    roam_in_progress_ = true;
+    roam_weak_ = false;
+    roam_full_scan_ = false;
+    roam_check_.cancel();
+    // If the AP does not respond, fall back to the plain connect.
+    hinted_attempt_ = true;
+    connecting_ = true;
+    attempt_pending_ = true;
+    attempt_started_ = roo_time::Uptime::Now();
+    associated_ = false;
+    return true;
+  }
+  return false;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::setReconnectPolicy(
+    const ReconnectPolicy* policy) {
+  reconnect_policy_ =
+      (policy != nullptr) ? policy : &default_reconnect_policy_;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::setRandomSeed(uint32_t seed) {
+  random_state_ = (seed != 0) ? seed : 1;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::scheduleReconnect(
+    Interface::EventType type, bool link_was_up) {
+  if (!enabled_ || current_network_.ssid().empty()) return;
+  ReconnectPolicy::Inputs inputs;
+  if (!link_was_up && IsHandshakeTimeout(last_disconnect_reason_)) {
+    if (handshake_timeouts_ < UINT16_MAX) ++handshake_timeouts_;
+  } else {
+    handshake_timeouts_ = 0;
+  }
+  inputs.kind = ClassifyDisconnect(type, last_disconnect_reason_, link_was_up,
+                                   handshake_timeouts_);
+  inputs.reason = last_disconnect_reason_;
+  if (reconnect_failures_ < UINT16_MAX) ++reconnect_failures_;
+  inputs.failures = reconnect_failures_;
+  roo_time::Duration scan_delay;
+  inputs.scans_expected =
+      scan_policy_->nextScanDelay(scanPolicyInputs(), scan_delay);
+  inputs.random = nextRandom();
+  if (inputs.kind == DISCONNECT_AUTH_FAILED) {
+    // Not retried by reconnect(), nor by auto-join.
+    rejected_ssid_.assign(current_network_.ssid().data(),
+                          current_network_.ssid().size());
+  }
+  roo_time::Duration delay;
+  switch (reconnect_policy_->nextAction(inputs, delay)) {
+    case ReconnectPolicy::RECONNECT_AFTER_DELAY: {
+      reconnect_.scheduleAfter(delay);
+      break;
+    }
+    case ReconnectPolicy::RECONNECT_AFTER_SCAN: {
+      reconnect_after_scan_ = true;
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::reconnect() {
+  reconnect_after_scan_ = false;
+  if (!enabled_ || connecting_) return;
+  std::string ssid(current_network_.ssid().data(),
+                   current_network_.ssid().size());
+  if (ssid.empty() || ssid == rejected_ssid_) return;
+  std::string passwd;
+  store_.getPassword(ssid, passwd);
+  initiateConnect(ssid, passwd, false);
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::resetReconnect() {
+  reconnect_.cancel();
+  reconnect_after_scan_ = false;
+  reconnect_failures_ = 0;
+  handshake_timeouts_ = 0;
+}
+
+template <typename InterfaceT, typename StoreT>
+uint32_t BasicController<InterfaceT, StoreT>::nextRandom() {
+  uint32_t x = random_state_;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  random_state_ = x;
+  return x;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::recordConnectionSuccess() {
+  if (!attempt_pending_) return;
+  attempt_pending_ = false;
+  std::string ssid(current_network_.ssid().data(),
+                   current_network_.ssid().size());
+  if (ssid != history_ssid_) return;
+  RecordConnectionSuccess(
+      history_, (roo_time::Uptime::Now() - attempt_started_).inMillis());
+  history_dirty_ = true;
+  history_failures_ = 0;
+  saveConnectionHistory(history_saved_outcome_ <= 0);
+  history_saved_outcome_ = 1;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::recordConnectionFailure() {
+  if (history_ssid_.empty()) return;
+  if (history_failures_ < UINT16_MAX) ++history_failures_;
+  if (history_failures_ >= internal::kHistorySaveFailures &&
+      history_saved_outcome_ >= 0) {
+    saveConnectionHistory(true);
+    history_saved_outcome_ = -1;
+    return;
+  }
+  saveConnectionHistory(false);
+}
+
+template <typename InterfaceT, typename StoreT>
+ConnectionHistory& BasicController<InterfaceT, StoreT>::connectionHistory(
+    const std::string& ssid) {
+  if (ssid != history_ssid_ || ssid.empty()) {
+    saveConnectionHistory(true);
+    if (!store_.getConnectionHistory(ssid, history_)) {
+      history_ = ConnectionHistory{0, 0, 0};
+    }
+    history_ssid_ = ssid;
+    history_dirty_ = false;
+    history_saved_outcome_ = 0;
+    history_saved_at_ = roo_time::Uptime::Now();
+    history_failures_ = 0;
+  }
+  return history_;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::saveConnectionHistory(bool force) {
+  if (!history_dirty_ || history_ssid_.empty()) return;
+  roo_time::Uptime now = roo_time::Uptime::Now();
+  if (!force &&
+      (now - history_saved_at_).inMillis() < internal::kHistorySaveIntervalMs) {
+    return;
+  }
+  store_.setConnectionHistory(history_ssid_, history_);
+  history_dirty_ = false;
+  history_saved_at_ = now;
+}
+
+template <typename InterfaceT, typename StoreT>
+ControllerBase::Stats BasicController<InterfaceT, StoreT>::stats() const {
+  Stats snapshot = stats_;
+  snapshot.taken = roo_time::Uptime::Now();
+  roo_time::Duration& spent =
+      snapshot.time_in_status[current_network_status_];
+  spent = spent + (snapshot.taken - status_since_);
+  return snapshot;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::resetStats() {
+  stats_ = Stats();
+  stats_.since = roo_time::Uptime::Now();
+  status_since_ = stats_.since;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::setCurrentNetworkStatus(
+    ConnectionStatus status) {
+  if (status == current_network_status_) return;
+  roo_time::Uptime now = roo_time::Uptime::Now();
+  roo_time::Duration& spent = stats_.time_in_status[current_network_status_];
+  spent = spent + (now - status_since_);
+  status_since_ = now;
+  current_network_status_ = status;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::countConnectAttempt() {
+  ++stats_.connect_attempts;
+  if (link_lost_) ++stats_.reconnect_attempts;
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::countDisconnect(uint16_t reason) {
+  ++stats_.disconnects;
+  for (int i = 0; i < stats_.disconnect_reasons; ++i) {
+    if (stats_.disconnects_by_reason[i].reason == reason) {
+      ++stats_.disconnects_by_reason[i].count;
+      return;
+    }
+  }
+  if (stats_.disconnect_reasons < Stats::kMaxDisconnectReasons) {
+    stats_.disconnects_by_reason[stats_.disconnect_reasons++] =
+        Stats::ReasonCount{reason, 1};
+  } else {
+    ++stats_.other_disconnects;
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::resetScanTable(size_t table_size) {
+  // Slots hold index + 1; zero means empty.
+  if (scan_slots_.size() < table_size) scan_slots_.resize(table_size);
+  std::fill(scan_slots_.begin(), scan_slots_.begin() + table_size, 0);
+  scan_slot_mask_ = table_size - 1;
+  for (size_t i = 0; i < scan_candidates_.size(); ++i) {
+    insertScanSlot(i);
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+void BasicController<InterfaceT, StoreT>::insertScanSlot(size_t idx) {
+  size_t slot = scan_hashes_[idx] & scan_slot_mask_;
+  while (scan_slots_[slot] != 0) slot = (slot + 1) & scan_slot_mask_;
+  scan_slots_[slot] = static_cast<uint16_t>(idx + 1);
+}
+
+template <typename InterfaceT, typename StoreT>
+int BasicController<InterfaceT, StoreT>::findScanResult(
+    roo::string_view ssid) const {
+  uint32_t hash =
+      internal::HashSsid((const uint8_t*)ssid.data(), ssid.size());
+  size_t slot = hash & scan_slot_mask_;
+  while (true) {
+    uint16_t entry = scan_slots_[slot];
+    if (entry == 0) return -1;
+    if (scan_hashes_[entry - 1] == hash &&
+        scan_candidates_[entry - 1].ssid() == ssid) {
+      return entry - 1;
+    }
+    slot = (slot + 1) & scan_slot_mask_;
+  }
+}
+
+template <typename InterfaceT, typename StoreT>
+uint16_t BasicController<InterfaceT, StoreT>::notifyScanDeltas() {
+  // Rank of each (de-duplicated) scan result in the new list, or -1 if it
+  // did not make it to the list.
+  scan_ranks_.assign(scan_candidates_.size(), -1);
+  for (size_t i = 0; i < all_networks_.size(); ++i) {
+    scan_ranks_[scan_indices_[i]] = static_cast<int16_t>(i);
+  }
+  size_t old_count = previous_networks_.size();
+  delta_positions_.resize(old_count);
+  for (size_t j = 0; j < old_count; ++j) {
+    int idx = findScanResult(previous_networks_[j].ssid());
+    delta_positions_[j] = (idx < 0) ? -1 : scan_ranks_[idx];
+  }
+  ScanDeltaNotifier notifier(*this);
+  scan_diff_.compute(delta_positions_.data(), old_count, all_networks_.size(),
+                     notifier);
+  uint16_t membership_changes = notifier.membership_changes();
+  for (size_t j = 0; j < old_count; ++j) {
+    int16_t pos = delta_positions_[j];
+    if (pos < 0) continue;
+    const Network& before = previous_networks_[j];
+    const Network& after = all_networks_[pos];
+    if (before.rssi == after.rssi && before.open == after.open) continue;
+    for (auto& l : model_listeners_.of(INTEREST_SCAN_DELTAS)) {
+      l->onScannedNetworkChanged(pos, after);
+    }
+  }
+  return membership_changes;
+}
+
+}  // namespace roo_wifi
@@ -0,0 +1,52 @@
+#include "roo_wifi/controller_base.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace roo_wifi {
+
+namespace internal {
+
+ConnectionStatus getConnectionStatus(Interface::EventType type) {
+  switch (type) {
+    case Interface::EV_CONNECTED:
+      return WL_IDLE_STATUS;
+    case Interface::EV_GOT_IP:
+      return WL_CONNECTED;
+    case Interface::EV_DISCONNECTED:
+      return WL_DISCONNECTED;
+    case Interface::EV_CONNECTION_FAILED:
+      return WL_CONNECT_FAILED;
+    case Interface::EV_CONNECTION_LOST:
+      return WL_CONNECTION_LOST;
+    default:
+      return WL_CONNECT_FAILED;
+  }
+}
+
+size_t SsidLength(const NetworkDetails& details) {
+  size_t len = 0;
+  while (len < 32 && details.ssid[len] != 0) ++len;
+  return len;
+}
+
+uint32_t HashSsid(const uint8_t* ssid, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= ssid[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+}  // namespace internal
+
+void ControllerBase::Network::setSsid(roo::string_view ssid) {
+  size_t len = std::min<size_t>(ssid.size(), sizeof(ssid_));
+  // May alias (e.g. when re-setting the current network).
+  memmove(ssid_, ssid.data(), len);
+  ssid_len_ = static_cast<uint8_t>(len);
+}
+
+}  // namespace roo_wifi
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_time.h"
+#include "roo_wifi/hal/interface.h"
+#include "roo_wifi/latency_histogram.h"
+
+namespace roo_wifi {
+
+template <typename InterfaceT, typename StoreT>
+class BasicController;
+
+/// The parts of the controller that do not depend on the interface and store
+/// types (see BasicController), so that listeners, and code that handles
+/// scan results, work with any controller.
+class ControllerBase {
+ public:
+  /// Summary of a scanned network.
+  struct Network {
+    Network()
+        : open(false),
+          rssi(-128),
+          bssid(),
+          channel(0),
+          ssid_len_(0),
+          ap_begin_(0),
+          ap_count_(0),
+          smoothed_rssi_(-128 * 16),
+          sort_rssi_(-128),
+          missed_scans_(0),
+          previous_position_(UINT16_MAX) {}
+
+    /// Returns the SSID. The view is valid as long as the network object.
+    roo::string_view ssid() const { return roo::string_view(ssid_, ssid_len_); }
+
+    /// Sets the SSID, truncating it to 32 bytes if needed.
+    void setSsid(roo::string_view ssid);
+
+    bool open;
+
+    /// Signal strength of the strongest AP; smoothed over successive scans
+    /// if so configured (see setScanAggregation()).
+    int8_t rssi;
+
+    /// MAC address and primary channel of the AP: the strongest one for
+    /// scanned networks (see accessPoint() for all of them), and the
+    /// associated one for the current network (zero if not associated).
+    uint8_t bssid[6];
+    uint8_t channel;
+
+   private:
+    template <typename InterfaceT, typename StoreT>
+    friend class BasicController;
+
+    // Stored inline (rather than as std::string), so that refreshing the scan
+    // list does not churn the heap.
+    char ssid_[32];
+    uint8_t ssid_len_;
+
+    // Range of the network's APs in access_points_.
+    uint16_t ap_begin_;
+    uint16_t ap_count_;
+
+    // Aggregation state (see ScanAggregation): the moving average of the
+    // signal strength, in 1/16 dB; the signal strength that the list is
+    // sorted by; the number of consecutive scans that missed the network;
+    // and its position in the previous scan list.
+    int16_t smoothed_rssi_;
+    int8_t sort_rssi_;
+    uint8_t missed_scans_;
+    uint16_t previous_position_;
+  };
+
+  /// How successive scans get merged into the scan list. The defaults make
+  /// each scan replace the list.
+  struct ScanAggregation {
+    ScanAggregation()
+        : rssi_weight(1), max_missed_scans(0), reorder_hysteresis(0) {}
+
+    /// Weight of the latest scan in the exponential moving average of the
+    /// signal strength of each network; in (0, 1]. Lower values smooth out
+    /// more jitter, but track real changes slower. 1 disables smoothing.
+    float rssi_weight;
+
+    /// Number of consecutive scans that may miss a network (e.g. a weak AP
+    /// whose beacons got lost) before it is removed from the list.
+    uint8_t max_missed_scans;
+
+    /// Change of the (smoothed) signal strength, in dB, that it takes for a
+    /// network to move in the list. Smaller changes keep the previous order,
+    /// so that jitter does not reshuffle the list.
+    uint8_t reorder_hysteresis;
+  };
+
+  /// An access point (BSSID) of a scanned network.
+  struct AccessPoint {
+    uint8_t bssid[6];
+    uint8_t channel;
+    int8_t rssi;
+  };
+
+  /// Connection and scan metrics, accumulated since the last resetStats().
+  /// Fixed-size; taking a snapshot does not allocate.
+  struct Stats {
+    /// Number of distinct disconnect reasons that get counted separately.
+    static constexpr int kMaxDisconnectReasons = 8;
+
+    /// Number of disconnect events with the given reason.
+    struct ReasonCount {
+      uint16_t reason;
+      uint32_t count;
+    };
+
+    roo_time::Uptime since;  ///< When the stats have been reset.
+    roo_time::Uptime taken;  ///< When the snapshot has been taken.
+
+    LatencyHistogram connect_latency;  ///< From connect() to EV_CONNECTED.
+    LatencyHistogram got_ip_latency;   ///< From EV_CONNECTED to EV_GOT_IP.
+    LatencyHistogram scan_duration;    ///< From startScan() to completion.
+
+    uint32_t scans;              ///< Completed scans.
+    uint32_t partial_scans;      ///< Of those, limited to channels or an SSID.
+    uint32_t scan_results;       ///< Raw scan results (BSSIDs), in total.
+    uint16_t last_scan_results;  ///< Raw scan results of the latest scan.
+    uint16_t max_scan_results;   ///< Most raw scan results of any scan.
+
+    /// Connection attempts, including the fallbacks after stale hints.
+    uint32_t connect_attempts;
+    /// Connection attempts made after losing an established connection,
+    /// until the connection gets re-established or explicitly dropped.
+    uint32_t reconnect_attempts;
+    /// Re-associations with a stronger AP of the current network.
+    uint32_t roams;
+
+    /// Disconnected, connection failed and connection lost events.
+    uint32_t disconnects;
+    /// Disconnects by reason (see Interface::Event::reason), in the order in
+    /// which the reasons first occurred. Reasons that did not fit are
+    /// counted in other_disconnects.
+    ReasonCount disconnects_by_reason[kMaxDisconnectReasons];
+    uint8_t disconnect_reasons;
+    uint32_t other_disconnects;
+
+    /// Time spent with each currentNetworkStatus(), indexed by its value.
+    roo_time::Duration time_in_status[WL_DISCONNECTED + 1];
+  };
+
+  /// Listener for controller events.
+  class Listener {
+   public:
+    Listener() = default;
+    virtual ~Listener() = default;
+
+    virtual void onEnableChanged(bool /*enabled*/) {}
+    virtual void onScanStarted() {}
+    virtual void onScanCompleted() {}
+    virtual void onCurrentNetworkChanged() {}
+    virtual void onConnectionStateChanged(Interface::EventType /*type*/) {}
+
+    /// Returns true if the listener currently needs up-to-date scan results
+    /// (e.g. it is showing the list of networks). Scan policies may scan
+    /// less often when no listener does.
+    virtual bool needsScanResults() const { return false; }
+
+    // Incremental updates to the scan list (see scannedNetwork()), delivered
+    // right before onScanCompleted(). Indices are stable: each one refers to
+    // the list as modified by the preceding updates, so a listener can apply
+    // them in order to its copy of the previous list. Removals are reported
+    // first, then moves and additions, then changes.
+
+    /// The network at `idx` is no longer in the scan list.
+    virtual void onScannedNetworkRemoved(int /*idx*/) {}
+
+    /// A new network has been inserted at `idx`.
+    virtual void onScannedNetworkAdded(int /*idx*/,
+                                       const Network& /*network*/) {}
+
+    /// The network at `from_idx` has moved so that it is now at `to_idx`.
+    virtual void onScannedNetworkMoved(int /*from_idx*/, int /*to_idx*/) {}
+
+    /// Signal strength (or security) of the network at `idx` has changed.
+    virtual void onScannedNetworkChanged(int /*idx*/,
+                                         const Network& /*network*/) {}
+
+   private:
+    template <typename InterfaceT, typename StoreT>
+    friend class BasicController;
+  };
+
+  /// Kinds of listener notifications, to be combined into interest masks
+  /// (see addListener()).
+  enum Interest {
+    /// onEnableChanged().
+    INTEREST_ENABLE = 1 << 0,
+    /// onScanStarted().
+    INTEREST_SCAN_STARTED = 1 << 1,
+    /// onScanCompleted(). Also, needsScanResults() is consulted.
+    INTEREST_SCAN_COMPLETED = 1 << 2,
+    /// onScannedNetworkRemoved/Added/Moved/Changed(). Also,
+    /// needsScanResults() is consulted.
+    INTEREST_SCAN_DELTAS = 1 << 3,
+    /// onCurrentNetworkChanged(), when anything but the signal strength has
+    /// changed.
+    INTEREST_CURRENT_NETWORK = 1 << 4,
+    /// onCurrentNetworkChanged(), when only the signal strength has changed.
+    INTEREST_SIGNAL_STRENGTH = 1 << 5,
+    /// onConnectionStateChanged().
+    INTEREST_CONNECTION_STATE = 1 << 6,
+
+    INTEREST_ALL = (1 << 7) - 1,
+  };
+
+ protected:
+  ControllerBase() = default;
+};
+
+namespace internal {
+
+// Upper bound on the number of raw scan results (BSSIDs) that the controller
+// processes.
+constexpr int kMaxRawScanResults = 1024;
+
+// How often the scheduler thread checks for queued interface events, when
+// the interface delivers them on another thread.
+constexpr int64_t kEventPollIntervalMs = 10;
+
+// Consecutive failed connection attempts after which the connection history
+// is saved (as failing), and the longest time that changes to it stay
+// unsaved otherwise.
+constexpr uint16_t kHistorySaveFailures = 3;
+constexpr int64_t kHistorySaveIntervalMs = 60 * 60 * 1000;
+
+// Returns the connection status that the interface event leads to.
+ConnectionStatus getConnectionStatus(Interface::EventType type);
+
+// Returns the length of the (zero-terminated) SSID of the scan result.
+size_t SsidLength(const NetworkDetails& details);
+
+// FNV-1a.
+uint32_t HashSsid(const uint8_t* ssid, size_t len);
+
+}  // namespace internal
+
+}  // namespace roo_wifi
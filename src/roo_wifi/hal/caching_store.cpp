@@ -0,0 +1,7 @@
+#include "roo_wifi/hal/caching_store.h"
+
+namespace roo_wifi {
+
+template class BasicCachingStore<Store>;
+
+}  // namespace roo_wifi
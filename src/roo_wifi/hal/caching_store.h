@@ -0,0 +1,146 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "roo_wifi/hal/store.h"
+
+namespace roo_wifi {
+
+/// Store decorator that serves reads from RAM, and writes through to the
+/// underlying store.
+///
+/// The enabled flag and the default SSID (with its password, connection hint
+/// and history) are loaded once, in begin(). Data of other networks is loaded
+/// on first use, and then cached, including negative lookups. This keeps flash
+/// (e.g. NVS) accesses off the controller's periodic paths. The cache holds
+/// up to `capacity` networks (besides the default one); beyond that, the
+/// least recently used ones get evicted, so that a dense environment, with
+/// many unknown SSIDs, does not grow it without bounds.
+///
+/// All writes must go through this store, or the cache becomes stale.
+///
+/// Talks to the underlying store via DelegateT, which must derive from
+/// Store. CachingStore (i.e. BasicCachingStore<Store>) works on top of any
+/// store; instantiating the template with a concrete (final) store instead
+/// resolves the calls to it at compile time.
+template <typename DelegateT>
+class BasicCachingStore final : public Store {
+ public:
+  /// Creates a caching store on top of the specified one.
+  BasicCachingStore(DelegateT& delegate, size_t capacity = 16);
+
+  /// Loads the cached state from the underlying store. Called implicitly on
+  /// first access if not called explicitly.
+  void begin();
+
+  /// Returns whether the Wi-Fi interface is enabled.
+  bool getIsInterfaceEnabled() override;
+
+  /// Sets whether the Wi-Fi interface is enabled.
+  void setIsInterfaceEnabled(bool enabled) override;
+
+  /// Returns the default SSID, if any.
+  std::string getDefaultSSID() override;
+
+  /// Sets the default SSID.
+  void setDefaultSSID(const std::string& ssid) override;
+
+  /// Clears the default SSID.
+  void clearDefaultSSID() override;
+
+  /// Retrieves a stored password for an SSID.
+  bool getPassword(const std::string& ssid, std::string& password) override;
+
+  /// Stores a password for an SSID.
+  void setPassword(const std::string& ssid, roo::string_view password) override;
+
+  /// Clears a stored password for an SSID.
+  void clearPassword(const std::string& ssid) override;
+
+  /// Retrieves the connection hint for an SSID.
+  bool getConnectionHint(const std::string& ssid,
+                         ConnectionHint& hint) override;
+
+  /// Stores the connection hint for an SSID.
+  void setConnectionHint(const std::string& ssid,
+                         const ConnectionHint& hint) override;
+
+  /// Clears the connection hint for an SSID.
+  void clearConnectionHint(const std::string& ssid) override;
+
+  /// Retrieves the connection history of an SSID.
+  bool getConnectionHistory(const std::string& ssid,
+                            ConnectionHistory& history) override;
+
+  /// Stores the connection history of an SSID.
+  void setConnectionHistory(const std::string& ssid,
+                            const ConnectionHistory& history) override;
+
+  /// Clears the connection history of an SSID.
+  void clearConnectionHistory(const std::string& ssid) override;
+
+  /// Enumerates the known networks of the underlying store. Not cached.
+  bool forEachKnownNetwork(KnownNetworkVisitor& visitor) override {
+    return delegate_.forEachKnownNetwork(visitor);
+  }
+
+  /// Starts a batch of writes in the underlying store.
+  void beginBatch() override { delegate_.beginBatch(); }
+
+  /// Ends a batch of writes in the underlying store.
+  void endBatch() override { delegate_.endBatch(); }
+
+  /// Returns the number of commits issued by the underlying store.
+  uint32_t commitCount() const override { return delegate_.commitCount(); }
+
+  /// Returns the number of networks currently cached.
+  size_t cachedNetworkCount() const { return networks_.size(); }
+
+ private:
+  // What we know about a given SSID.
+  struct CachedNetwork {
+    bool password_loaded;
+    bool has_password;
+    std::string password;
+
+    bool hint_loaded;
+    bool has_hint;
+    ConnectionHint hint;
+
+    bool history_loaded;
+    bool has_history;
+    ConnectionHistory history;
+
+    // Value of use_counter_ as of the latest access.
+    uint32_t last_used;
+  };
+
+  void ensureLoaded();
+
+  // Returns the cache entry of the SSID, creating an empty one (and evicting
+  // the least recently used one, if the cache is full) if needed.
+  CachedNetwork& entry(const std::string& ssid);
+
+  CachedNetwork& lookupPassword(const std::string& ssid);
+  CachedNetwork& lookupHint(const std::string& ssid);
+  CachedNetwork& lookupHistory(const std::string& ssid);
+
+  DelegateT& delegate_;
+  bool loaded_;
+  bool is_interface_enabled_;
+  std::string default_ssid_;
+  std::map<std::string, CachedNetwork> networks_;
+  size_t capacity_;
+  uint32_t use_counter_;
+};
+
+/// The caching store that works on top of any Store implementation.
+using CachingStore = BasicCachingStore<Store>;
+
+// Instantiated once, in caching_store.cpp.
+extern template class BasicCachingStore<Store>;
+
+}  // namespace roo_wifi
+
+#include "roo_wifi/hal/caching_store_impl.h"
@@ -0,0 +1,241 @@
+#pragma once
+
+// Definitions of the BasicCachingStore members. Included by caching_store.h.
+
+#include <string.h>
+
+namespace roo_wifi {
+
+template <typename DelegateT>
+BasicCachingStore<DelegateT>::BasicCachingStore(DelegateT& delegate,
+                                                size_t capacity)
+    : delegate_(delegate),
+      loaded_(false),
+      is_interface_enabled_(false),
+      default_ssid_(),
+      networks_(),
+      capacity_(capacity),
+      use_counter_(0) {}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::begin() {
+  is_interface_enabled_ = delegate_.getIsInterfaceEnabled();
+  default_ssid_ = delegate_.getDefaultSSID();
+  networks_.clear();
+  loaded_ = true;
+  if (!default_ssid_.empty()) {
+    lookupPassword(default_ssid_);
+    lookupHint(default_ssid_);
+    lookupHistory(default_ssid_);
+  }
+}
+
+template <typename DelegateT>
+bool BasicCachingStore<DelegateT>::getIsInterfaceEnabled() {
+  ensureLoaded();
+  return is_interface_enabled_;
+}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::setIsInterfaceEnabled(bool enabled) {
+  ensureLoaded();
+  if (enabled == is_interface_enabled_) return;
+  delegate_.setIsInterfaceEnabled(enabled);
+  is_interface_enabled_ = enabled;
+}
+
+template <typename DelegateT>
+std::string BasicCachingStore<DelegateT>::getDefaultSSID() {
+  ensureLoaded();
+  return default_ssid_;
+}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::setDefaultSSID(const std::string& ssid) {
+  ensureLoaded();
+  if (ssid == default_ssid_) return;
+  delegate_.setDefaultSSID(ssid);
+  default_ssid_ = ssid;
+}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::clearDefaultSSID() {
+  ensureLoaded();
+  delegate_.clearDefaultSSID();
+  default_ssid_.clear();
+}
+
+template <typename DelegateT>
+bool BasicCachingStore<DelegateT>::getPassword(const std::string& ssid,
+                                               std::string& password) {
+  ensureLoaded();
+  const CachedNetwork& cached = lookupPassword(ssid);
+  if (!cached.has_password) return false;
+  password = cached.password;
+  return true;
+}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::setPassword(const std::string& ssid,
+                                               roo::string_view password) {
+  ensureLoaded();
+  CachedNetwork& cached = entry(ssid);
+  if (cached.password_loaded && cached.has_password &&
+      roo::string_view(cached.password) == password) {
+    return;
+  }
+  delegate_.setPassword(ssid, password);
+  cached.password_loaded = true;
+  cached.has_password = true;
+  cached.password = std::string(password.data(), password.size());
+}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::clearPassword(const std::string& ssid) {
+  ensureLoaded();
+  CachedNetwork& cached = entry(ssid);
+  if (cached.password_loaded && !cached.has_password) return;
+  delegate_.clearPassword(ssid);
+  cached.password_loaded = true;
+  cached.has_password = false;
+  cached.password.clear();
+}
+
+template <typename DelegateT>
+bool BasicCachingStore<DelegateT>::getConnectionHint(const std::string& ssid,
+                                                     ConnectionHint& hint) {
+  ensureLoaded();
+  const CachedNetwork& cached = lookupHint(ssid);
+  if (!cached.has_hint) return false;
+  hint = cached.hint;
+  return true;
+}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::setConnectionHint(
+    const std::string& ssid, const ConnectionHint& hint) {
+  ensureLoaded();
+  CachedNetwork& cached = entry(ssid);
+  if (cached.hint_loaded && cached.has_hint &&
+      memcmp(cached.hint.bssid, hint.bssid, 6) == 0 &&
+      cached.hint.channel == hint.channel) {
+    return;
+  }
+  delegate_.setConnectionHint(ssid, hint);
+  cached.hint_loaded = true;
+  cached.has_hint = true;
+  cached.hint = hint;
+}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::clearConnectionHint(
+    const std::string& ssid) {
+  ensureLoaded();
+  CachedNetwork& cached = entry(ssid);
+  if (cached.hint_loaded && !cached.has_hint) return;
+  delegate_.clearConnectionHint(ssid);
+  cached.hint_loaded = true;
+  cached.has_hint = false;
+}
+
+template <typename DelegateT>
+bool BasicCachingStore<DelegateT>::getConnectionHistory(
+    const std::string& ssid, ConnectionHistory& history) {
+  ensureLoaded();
+  const CachedNetwork& cached = lookupHistory(ssid);
+  if (!cached.has_history) return false;
+  history = cached.history;
+  return true;
+}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::setConnectionHistory(
+    const std::string& ssid, const ConnectionHistory& history) {
+  ensureLoaded();
+  CachedNetwork& cached = entry(ssid);
+  if (cached.history_loaded && cached.has_history &&
+      cached.history.attempts == history.attempts &&
+      cached.history.successes == history.successes &&
+      cached.history.avg_time_to_ip_ms == history.avg_time_to_ip_ms) {
+    return;
+  }
+  delegate_.setConnectionHistory(ssid, history);
+  cached.history_loaded = true;
+  cached.has_history = true;
+  cached.history = history;
+}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::clearConnectionHistory(
+    const std::string& ssid) {
+  ensureLoaded();
+  CachedNetwork& cached = entry(ssid);
+  if (cached.history_loaded && !cached.has_history) return;
+  delegate_.clearConnectionHistory(ssid);
+  cached.history_loaded = true;
+  cached.has_history = false;
+}
+
+template <typename DelegateT>
+void BasicCachingStore<DelegateT>::ensureLoaded() {
+  if (!loaded_) begin();
+}
+
+template <typename DelegateT>
+typename BasicCachingStore<DelegateT>::CachedNetwork&
+BasicCachingStore<DelegateT>::entry(const std::string& ssid) {
+  auto it = networks_.find(ssid);
+  if (it == networks_.end()) {
+    size_t limit = capacity_ + networks_.count(default_ssid_);
+    if (networks_.size() >= limit) {
+      // Evict the least recently used entry, except the default network.
+      auto victim = networks_.end();
+      for (auto i = networks_.begin(); i != networks_.end(); ++i) {
+        if (i->first == default_ssid_) continue;
+        if (victim == networks_.end() ||
+            i->second.last_used < victim->second.last_used) {
+          victim = i;
+        }
+      }
+      if (victim != networks_.end()) networks_.erase(victim);
+    }
+    it = networks_.emplace(ssid, CachedNetwork()).first;
+  }
+  it->second.last_used = ++use_counter_;
+  return it->second;
+}
+
+template <typename DelegateT>
+typename BasicCachingStore<DelegateT>::CachedNetwork&
+BasicCachingStore<DelegateT>::lookupPassword(const std::string& ssid) {
+  CachedNetwork& cached = entry(ssid);
+  if (!cached.password_loaded) {
+    cached.has_password = delegate_.getPassword(ssid, cached.password);
+    cached.password_loaded = true;
+  }
+  return cached;
+}
+
+template <typename DelegateT>
+typename BasicCachingStore<DelegateT>::CachedNetwork&
+BasicCachingStore<DelegateT>::lookupHint(const std::string& ssid) {
+  CachedNetwork& cached = entry(ssid);
+  if (!cached.hint_loaded) {
+    cached.has_hint = delegate_.getConnectionHint(ssid, cached.hint);
+    cached.hint_loaded = true;
+  }
+  return cached;
+}
+
+template <typename DelegateT>
+typename BasicCachingStore<DelegateT>::CachedNetwork&
+BasicCachingStore<DelegateT>::lookupHistory(const std::string& ssid) {
+  CachedNetwork& cached = entry(ssid);
+  if (!cached.history_loaded) {
+    cached.has_history = delegate_.getConnectionHistory(ssid, cached.history);
+    cached.history_loaded = true;
+  }
+  return cached;
+}
+
+}  // namespace roo_wifi
@@ -1,9 +1,22 @@
 #include "arduino_preferences_store.h"
 
+#include <string.h>
+
+#include <vector>
+
 namespace roo_wifi {
 
 namespace {
 
+// Key of the known networks table, and of the upper bound of its size in
+// bytes (needed to read it back).
+const char* kNetworksKey = "nets";
+const char* kNetworksCapacityKey = "nets-cap";
+
+// Passwords stored by earlier versions, before the table was introduced,
+// are under per-SSID keys, named after hashes of SSIDs. They are moved into
+// the table when first looked up.
+
 uint64_t inline MurmurOAAT64(const char* key) {
   uint64_t h(525201411107845655ull);
   for (; *key != '\0'; ++key) {
@@ -32,13 +45,23 @@ void ToSsiPwdKey(const std::string& ssid, char* result) {
 ArduinoPreferencesStore::ArduinoPreferencesStore()
     : collection_("roo/wifi"),
       is_interface_enabled_(collection_, "enabled", false),
-      default_ssid_(collection_, "ssid", "") {}
+      default_ssid_(collection_, "ssid", ""),
+      networks_(),
+      networks_loaded_(false),
+      stored_networks_(),
+      networks_capacity_(0),
+      networks_dirty_(false),
+      batch_(),
+      batch_depth_(0),
+      batch_dirty_(false),
+      commit_count_(0) {}
 
 bool ArduinoPreferencesStore::getIsInterfaceEnabled() {
   return is_interface_enabled_.get();
 }
 
 void ArduinoPreferencesStore::setIsInterfaceEnabled(bool enabled) {
+  countWrite();
   is_interface_enabled_.set(enabled);
 }
 
@@ -47,35 +70,216 @@ std::string ArduinoPreferencesStore::getDefaultSSID() {
 }
 
 void ArduinoPreferencesStore::setDefaultSSID(const std::string& ssid) {
+  countWrite();
   default_ssid_.set(ssid);
 }
 
 void ArduinoPreferencesStore::clearDefaultSSID() {
+  countWrite();
   roo_prefs::Transaction t(collection_);
   t.store().clear("ssid");
 }
 
 bool ArduinoPreferencesStore::getPassword(const std::string& ssid,
                                           std::string& password) {
-  roo_prefs::Transaction t(collection_, true);
-  char pwkey[16];
-  ToSsiPwdKey(ssid, pwkey);
-  return (t.store().readString(pwkey, password) == roo_prefs::ReadResult::kOk);
+  const KnownNetwork* network = lookup(ssid);
+  if (network == nullptr || !(network->flags & KNOWN_NETWORK_PASSWORD)) {
+    return false;
+  }
+  password = network->password;
+  return true;
 }
 
 void ArduinoPreferencesStore::setPassword(const std::string& ssid,
                                           roo::string_view password) {
-  roo_prefs::Transaction t(collection_);
-  char pwkey[16];
-  ToSsiPwdKey(ssid, pwkey);
-  t.store().writeString(pwkey, password);
+  KnownNetwork& network = update(ssid);
+  if ((network.flags & KNOWN_NETWORK_PASSWORD) &&
+      roo::string_view(network.password) == password) {
+    return;
+  }
+  network.password.assign(password.data(), password.size());
+  network.flags |= KNOWN_NETWORK_PASSWORD;
+  saveNetworks();
 }
 
 void ArduinoPreferencesStore::clearPassword(const std::string& ssid) {
-  roo_prefs::Transaction t(collection_);
+  lookup(ssid);
+  if (!networks_.clear(ssid, KNOWN_NETWORK_PASSWORD)) return;
+  saveNetworks();
+}
+
+bool ArduinoPreferencesStore::getConnectionHint(const std::string& ssid,
+                                                ConnectionHint& hint) {
+  const KnownNetwork* network = lookup(ssid);
+  if (network == nullptr || !(network->flags & KNOWN_NETWORK_HINT)) {
+    return false;
+  }
+  hint = network->hint;
+  return true;
+}
+
+void ArduinoPreferencesStore::setConnectionHint(const std::string& ssid,
+                                                const ConnectionHint& hint) {
+  KnownNetwork& network = update(ssid);
+  if ((network.flags & KNOWN_NETWORK_HINT) &&
+      memcmp(network.hint.bssid, hint.bssid, 6) == 0 &&
+      network.hint.channel == hint.channel) {
+    return;
+  }
+  network.hint = hint;
+  network.flags |= KNOWN_NETWORK_HINT;
+  saveNetworks();
+}
+
+void ArduinoPreferencesStore::clearConnectionHint(const std::string& ssid) {
+  lookup(ssid);
+  if (!networks_.clear(ssid, KNOWN_NETWORK_HINT)) return;
+  saveNetworks();
+}
+
+bool ArduinoPreferencesStore::getConnectionHistory(
+    const std::string& ssid, ConnectionHistory& history) {
+  const KnownNetwork* network = lookup(ssid);
+  if (network == nullptr || !(network->flags & KNOWN_NETWORK_HISTORY)) {
+    return false;
+  }
+  history = network->history;
+  return true;
+}
+
+void ArduinoPreferencesStore::setConnectionHistory(
+    const std::string& ssid, const ConnectionHistory& history) {
+  KnownNetwork& network = update(ssid);
+  if ((network.flags & KNOWN_NETWORK_HISTORY) &&
+      network.history.attempts == history.attempts &&
+      network.history.successes == history.successes &&
+      network.history.avg_time_to_ip_ms == history.avg_time_to_ip_ms) {
+    return;
+  }
+  network.history = history;
+  network.flags |= KNOWN_NETWORK_HISTORY;
+  saveNetworks();
+}
+
+void ArduinoPreferencesStore::clearConnectionHistory(const std::string& ssid) {
+  lookup(ssid);
+  if (!networks_.clear(ssid, KNOWN_NETWORK_HISTORY)) return;
+  saveNetworks();
+}
+
+bool ArduinoPreferencesStore::forEachKnownNetwork(
+    KnownNetworkVisitor& visitor) {
+  ensureLoaded();
+  networks_.forEach(visitor);
+  return true;
+}
+
+void ArduinoPreferencesStore::ensureLoaded() {
+  if (networks_loaded_) return;
+  networks_loaded_ = true;
+  {
+    roo_prefs::Transaction t(collection_, true);
+    if (t.store().readU32(kNetworksCapacityKey, networks_capacity_) ==
+        roo_prefs::ReadResult::kOk) {
+      stored_networks_.resize(networks_capacity_);
+      size_t read = 0;
+      if (t.store().readBytes(kNetworksKey, stored_networks_.data(),
+                              stored_networks_.size(),
+                              &read) != roo_prefs::ReadResult::kOk ||
+          !networks_.decode(stored_networks_.data(), read)) {
+        // Unreadable (e.g. torn, or written by a newer version). Start over.
+        networks_.clear();
+        read = 0;
+      }
+      stored_networks_.resize(read);
+    }
+  }
+  // Migrate the default network right away, as it is needed first.
+  std::string ssid = getDefaultSSID();
+  if (!ssid.empty()) lookup(ssid);
+}
+
+const KnownNetwork* ArduinoPreferencesStore::lookup(const std::string& ssid) {
+  ensureLoaded();
+  const KnownNetwork* network = networks_.find(ssid);
+  return network != nullptr ? network : migrate(ssid);
+}
+
+KnownNetwork& ArduinoPreferencesStore::update(const std::string& ssid) {
+  // Migrates the legacy password, if any, so that the new entry does not
+  // shadow it.
+  lookup(ssid);
+  return networks_.insert(ssid);
+}
+
+const KnownNetwork* ArduinoPreferencesStore::migrate(const std::string& ssid) {
   char pwkey[16];
   ToSsiPwdKey(ssid, pwkey);
+  std::string password;
+  {
+    // Most lookups that miss the table are of networks that have never
+    // been stored; keep them read-only.
+    roo_prefs::Transaction t(collection_, true);
+    if (t.store().readString(pwkey, password) != roo_prefs::ReadResult::kOk) {
+      return nullptr;
+    }
+  }
+  KnownNetwork& network = networks_.insert(ssid);
+  network.password = std::move(password);
+  network.flags |= KNOWN_NETWORK_PASSWORD;
+  roo_prefs::Transaction t(collection_);
+  // The table must be written before the legacy key gets dropped.
+  writeNetworks(t);
   t.store().clear(pwkey);
+  countWrite();
+  return &network;
+}
+
+void ArduinoPreferencesStore::saveNetworks() {
+  if (batch_depth_ > 0) {
+    networks_dirty_ = true;
+    return;
+  }
+  roo_prefs::Transaction t(collection_);
+  if (writeNetworks(t)) ++commit_count_;
+}
+
+bool ArduinoPreferencesStore::writeNetworks(roo_prefs::Transaction& t) {
+  networks_dirty_ = false;
+  std::vector<uint8_t> data;
+  networks_.encode(&data);
+  // E.g. a value set, and then cleared, within a batch.
+  if (data == stored_networks_) return false;
+  // The capacity never shrinks, and grows before the table does, so that it
+  // bounds the size of the table even if we lose power in between the writes.
+  if (data.size() > networks_capacity_) {
+    networks_capacity_ = data.size();
+    t.store().writeU32(kNetworksCapacityKey, networks_capacity_);
+  }
+  t.store().writeBytes(kNetworksKey, data.data(), data.size());
+  stored_networks_.swap(data);
+  return true;
+}
+
+void ArduinoPreferencesStore::beginBatch() {
+  if (batch_depth_++ > 0) return;
+  batch_dirty_ = false;
+  batch_.reset(new roo_prefs::Transaction(collection_));
+}
+
+void ArduinoPreferencesStore::endBatch() {
+  if (--batch_depth_ > 0) return;
+  if (networks_dirty_ && writeNetworks(*batch_)) batch_dirty_ = true;
+  batch_.reset();
+  if (batch_dirty_) ++commit_count_;
+}
+
+void ArduinoPreferencesStore::countWrite() {
+  if (batch_depth_ > 0) {
+    batch_dirty_ = true;
+  } else {
+    ++commit_count_;
+  }
 }
 
 }  // namespace roo_wifi
@@ -1,17 +1,29 @@
 #pragma once
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "roo_prefs.h"
+#include "roo_wifi/hal/known_network_table.h"
 #include "roo_wifi/hal/store.h"
 
 namespace roo_wifi {
 
 /// Store implementation backed by roo_prefs (ESP32 Arduino preferences).
-class ArduinoPreferencesStore : public Store {
+///
+/// Known networks (passwords, connection hints and history) are kept in a
+/// single versioned blob, which is loaded into RAM on first use, and
+/// rewritten as a whole (once per batch) when it changes. Passwords stored
+/// by earlier versions, under hashed per-SSID keys, are moved into the table
+/// when the SSID is first looked up (the default SSID: on load).
+class ArduinoPreferencesStore final : public Store {
  public:
   ArduinoPreferencesStore();
 
-  /// Initializes the preferences store (no-op placeholder).
-  void begin() {}
+  /// Loads the known networks table. Called implicitly on first access if
+  /// not called explicitly.
+  void begin() { ensureLoaded(); }
 
   /// Returns whether the Wi-Fi interface is enabled.
   bool getIsInterfaceEnabled() override;
@@ -37,10 +49,88 @@ class ArduinoPreferencesStore : public Store {
   /// Clears a stored password for an SSID.
   void clearPassword(const std::string& ssid) override;
 
+  /// Retrieves the connection hint for an SSID.
+  bool getConnectionHint(const std::string& ssid,
+                         ConnectionHint& hint) override;
+
+  /// Stores the connection hint for an SSID.
+  void setConnectionHint(const std::string& ssid,
+                         const ConnectionHint& hint) override;
+
+  /// Clears the connection hint for an SSID.
+  void clearConnectionHint(const std::string& ssid) override;
+
+  /// Retrieves the connection history of an SSID.
+  bool getConnectionHistory(const std::string& ssid,
+                            ConnectionHistory& history) override;
+
+  /// Stores the connection history of an SSID.
+  void setConnectionHistory(const std::string& ssid,
+                            const ConnectionHistory& history) override;
+
+  /// Clears the connection history of an SSID.
+  void clearConnectionHistory(const std::string& ssid) override;
+
+  /// Calls the visitor for each known network, in SSID order.
+  bool forEachKnownNetwork(KnownNetworkVisitor& visitor) override;
+
+  /// Opens a preferences transaction that spans the whole batch.
+  void beginBatch() override;
+
+  /// Closes the batch transaction, if it is the outermost batch.
+  void endBatch() override;
+
+  /// Returns the number of preferences transactions that wrote data.
+  uint32_t commitCount() const override { return commit_count_; }
+
  private:
+  // Accounts for a write: a commit of its own, or part of the open batch.
+  void countWrite();
+
+  // Loads the known networks table, if not loaded yet.
+  void ensureLoaded();
+
+  // Returns the table entry for the SSID, or nullptr if the network is
+  // unknown.
+  const KnownNetwork* lookup(const std::string& ssid);
+
+  // Like lookup(), but adds an entry if the network is unknown.
+  KnownNetwork& update(const std::string& ssid);
+
+  // Moves the password stored under the legacy key of the SSID, if any,
+  // into the table. Returns the new entry, or nullptr if there was none.
+  const KnownNetwork* migrate(const std::string& ssid);
+
+  // Writes the table, now, or at the end of the batch.
+  void saveNetworks();
+
+  // Writes the table within the specified transaction, unless it is the
+  // same as the stored one. Returns true if it has been written.
+  bool writeNetworks(roo_prefs::Transaction& t);
+
   roo_prefs::Collection collection_;
   roo_prefs::Bool is_interface_enabled_;
   roo_prefs::String default_ssid_;
+
+  KnownNetworkTable networks_;
+  bool networks_loaded_;
+
+  // The table as last read or written, so that unchanged tables do not get
+  // rewritten.
+  std::vector<uint8_t> stored_networks_;
+
+  // Upper bound of the size of the stored table, in bytes.
+  uint32_t networks_capacity_;
+
+  // Whether the table has been modified in the current batch.
+  bool networks_dirty_;
+
+  // Outer transaction of the current batch, if any. Transactions opened by
+  // individual writes nest inside it.
+  std::unique_ptr<roo_prefs::Transaction> batch_;
+  int batch_depth_;
+  bool batch_dirty_;
+  uint32_t commit_count_;
 };
 
 }  // namespace roo_wifi
@@ -2,6 +2,8 @@
 
 #include "WiFiGeneric.h"
 #include "WiFi.h"
+#include "esp_arduino_version.h"
+#include "esp_wifi.h"
 
 namespace roo_wifi {
 
@@ -55,7 +57,7 @@ void dispatch(arduino_event_id_t event, arduino_event_info_t info) {
   if (head == nullptr) return;
   auto n = head;
   do {
-    n->notify_fn(event, info);
+    n->notify_fn(n->context, event, info);
     n = n->next;
   } while (n != head);
 }
@@ -69,12 +71,16 @@ void init() {
 }  // namespace
 
 Esp32ArduinoInterface::Esp32ArduinoInterface()
-    : event_relay_([&](arduino_event_id_t event, arduino_event_info_t info) {
-        dispatchEvent(event, info);
-      }),
-      scanning_(false) {}
+    : event_relay_(&Esp32ArduinoInterface::relayEvent, this),
+      scanning_(false),
+      ap_generation_(1),
+      rssi_low_handler_(nullptr) {}
 
 Esp32ArduinoInterface::~Esp32ArduinoInterface() {
+  if (rssi_low_handler_ != nullptr) {
+    esp_event_handler_instance_unregister(
+        WIFI_EVENT, WIFI_EVENT_STA_BSS_RSSI_LOW, rssi_low_handler_);
+  }
   detach(&event_relay_);
 }
 
@@ -82,6 +88,14 @@ void Esp32ArduinoInterface::begin() {
   init();
   attach(&event_relay_);
   WiFi.mode(WIFI_STA);
+  // The controller reconnects, with backoff and jitter.
+  WiFi.setAutoReconnect(false);
+  if (rssi_low_handler_ == nullptr) {
+    esp_event_handler_instance_register(WIFI_EVENT,
+                                        WIFI_EVENT_STA_BSS_RSSI_LOW,
+                                        &Esp32ArduinoInterface::onRssiLow,
+                                        this, &rssi_low_handler_);
+  }
   // // #ifdef ESP32
   // WiFi.onEvent(
   //     [this](arduino_event_id_t event) {
@@ -100,8 +114,12 @@ bool Esp32ArduinoInterface::getApInfo(NetworkDetails* info) const {
   info->ssid[ssid.length()] = 0;
   info->authmode = WIFI_AUTH_UNKNOWN;  // authMode(WiFi.encryptionType());
   info->rssi = WiFi.RSSI();
-  auto mac = WiFi.macAddress();
-  memcpy(info->bssid, mac.c_str(), 6);
+  const uint8_t* bssid = WiFi.BSSID();
+  if (bssid != nullptr) {
+    memcpy(info->bssid, bssid, 6);
+  } else {
+    memset(info->bssid, 0, 6);
+  }
   info->primary = WiFi.channel();
   info->group_cipher = WIFI_CIPHER_TYPE_UNKNOWN;
   info->pairwise_cipher = WIFI_CIPHER_TYPE_UNKNOWN;
@@ -114,55 +132,150 @@ bool Esp32ArduinoInterface::getApInfo(NetworkDetails* info) const {
   return true;
 }
 
+bool Esp32ArduinoInterface::getRssi(int8_t* rssi) const {
+  wifi_ap_record_t record;
+  if (esp_wifi_sta_get_ap_info(&record) != ESP_OK) return false;
+  *rssi = record.rssi;
+  return true;
+}
+
+bool Esp32ArduinoInterface::getChannel(uint8_t* channel) const {
+  wifi_ap_record_t record;
+  if (esp_wifi_sta_get_ap_info(&record) != ESP_OK) return false;
+  *channel = record.primary;
+  return true;
+}
+
+bool Esp32ArduinoInterface::getBssid(uint8_t bssid[6]) const {
+  wifi_ap_record_t record;
+  if (esp_wifi_sta_get_ap_info(&record) != ESP_OK) return false;
+  memcpy(bssid, record.bssid, 6);
+  return true;
+}
+
+void Esp32ArduinoInterface::bumpApGeneration() {
+  if (++ap_generation_ == 0) ++ap_generation_;
+}
+
 bool Esp32ArduinoInterface::startScan() {
   scanning_ = (WiFi.scanNetworks(true, false) == WIFI_SCAN_RUNNING);
   return scanning_;
 }
 
+bool Esp32ArduinoInterface::startScan(const ScanOptions& options) {
+  // The driver limits scans to a single channel, or none; scan all of them
+  // when asked for several. The minimum dwell time is not configurable.
+  uint8_t channel =
+      (options.channels.count() == 1) ? options.channels.first() : 0;
+#if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(2, 0, 6)
+  scanning_ = (WiFi.scanNetworks(
+                   true, options.show_hidden, options.passive,
+                   options.max_dwell_ms, channel,
+                   options.ssid.empty() ? nullptr : options.ssid.c_str()) ==
+               WIFI_SCAN_RUNNING);
+#else
+  // Older cores cannot limit scans to an SSID; the results then include
+  // other networks as well, which is harmless.
+  scanning_ = (WiFi.scanNetworks(true, options.show_hidden, options.passive,
+                                 options.max_dwell_ms, channel) ==
+               WIFI_SCAN_RUNNING);
+#endif
+  return scanning_;
+}
+
 bool Esp32ArduinoInterface::scanCompleted() const {
   bool completed = WiFi.scanComplete() >= 0;
   return completed;
 }
 
+namespace {
+
+void fromApRecord(const wifi_ap_record_t& record, NetworkDetails& info) {
+  memcpy(info.bssid, record.bssid, 6);
+  memcpy(info.ssid, record.ssid, 32);
+  info.ssid[32] = 0;
+  info.primary = record.primary;
+  info.rssi = record.rssi;
+  info.authmode = authMode(record.authmode);
+  info.group_cipher = WIFI_CIPHER_TYPE_UNKNOWN;
+  info.pairwise_cipher = WIFI_CIPHER_TYPE_UNKNOWN;
+  info.use_11b = record.phy_11b;
+  info.use_11g = record.phy_11g;
+  info.use_11n = record.phy_11n;
+  info.supports_wps = record.wps;
+  info.status = WL_DISCONNECTED;
+}
+
+class ScanResultCollector : public Interface::ScanResultVisitor {
+ public:
+  ScanResultCollector(std::vector<NetworkDetails>* list, int max_count)
+      : list_(list), max_count_(max_count) {}
+
+  bool visit(const NetworkDetails& result) override {
+    if ((int)list_->size() >= max_count_) return false;
+    list_->push_back(result);
+    return true;
+  }
+
+ private:
+  std::vector<NetworkDetails>* list_;
+  int max_count_;
+};
+
+}  // namespace
+
 bool Esp32ArduinoInterface::getScanResults(std::vector<NetworkDetails>* list,
                                            int max_count) const {
-  int16_t result = WiFi.scanComplete();
-  if (result < 0) return false;
-  if (max_count > result) {
-    max_count = result;
-  }
   list->clear();
-  for (int i = 0; i < max_count; ++i) {
-    NetworkDetails info;
-    auto ssid = WiFi.SSID(i);
-    memcpy(info.ssid, ssid.c_str(), ssid.length());
-    info.ssid[ssid.length()] = 0;
-    info.authmode = authMode(WiFi.encryptionType(i));
-    info.rssi = WiFi.RSSI(i);
-    info.primary = WiFi.channel(i);
-    info.group_cipher = WIFI_CIPHER_TYPE_UNKNOWN;
-    info.pairwise_cipher = WIFI_CIPHER_TYPE_UNKNOWN;
-    info.use_11b = false;
-    info.use_11g = false;
-    info.use_11n = false;
-    info.supports_wps = false;
-    list->push_back(std::move(info));
+  ScanResultCollector collector(list, max_count);
+  return forEachScanResult(collector);
+}
+
+bool Esp32ArduinoInterface::forEachScanResult(
+    ScanResultVisitor& visitor) const {
+  int16_t count = WiFi.scanComplete();
+  if (count < 0) return false;
+  // A single conversion buffer; the records themselves stay in the Arduino
+  // scan cache, and no Strings get created.
+  NetworkDetails info;
+  for (int i = 0; i < count; ++i) {
+    const wifi_ap_record_t* record =
+        (const wifi_ap_record_t*)WiFi.getScanInfoByIndex(i);
+    if (record == nullptr) break;
+    fromApRecord(*record, info);
+    if (!visitor.visit(info)) break;
   }
   return true;
 }
 
-void Esp32ArduinoInterface::disconnect() { WiFi.disconnect(); }
+void Esp32ArduinoInterface::disconnect() {
+  bumpApGeneration();
+  WiFi.disconnect();
+}
 
 bool Esp32ArduinoInterface::connect(const std::string& ssid,
                                     const std::string& passwd) {
+  bumpApGeneration();
   WiFi.begin(ssid.c_str(), passwd.c_str());
   return true;
 }
 
+bool Esp32ArduinoInterface::connect(const std::string& ssid,
+                                    const std::string& passwd,
+                                    const ConnectionHint& hint) {
+  bumpApGeneration();
+  WiFi.begin(ssid.c_str(), passwd.c_str(), hint.channel, hint.bssid);
+  return true;
+}
+
 ConnectionStatus Esp32ArduinoInterface::getStatus() {
   return (ConnectionStatus)WiFi.status();
 }
 
+void Esp32ArduinoInterface::setRssiBand(int8_t low, int8_t /*high*/) {
+  esp_wifi_set_rssi_threshold(low);
+}
+
 void Esp32ArduinoInterface::addEventListener(EventListener* listener) {
   listeners_.insert(listener);
 }
@@ -204,8 +317,36 @@ void Esp32ArduinoInterface::dispatchEvent(arduino_event_id_t event, arduino_even
   if (type == Interface::EV_SCAN_COMPLETED) {
     scanning_ = false;
   }
+  uint16_t reason = 0;
+  if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    reason = info.wifi_sta_disconnected.reason;
+  }
+  if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED ||
+      event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    bumpApGeneration();
+  }
+  dispatch(Event{type, reason});
+}
+
+void Esp32ArduinoInterface::relayEvent(void* context,
+                                       arduino_event_id_t event,
+                                       arduino_event_info_t info) {
+  ((Esp32ArduinoInterface*)context)->dispatchEvent(event, info);
+}
+
+void Esp32ArduinoInterface::onRssiLow(void* arg, esp_event_base_t /*base*/,
+                                      int32_t /*id*/, void* /*data*/) {
+  // Runs on the system event task, concurrently with the events relayed
+  // from the Arduino event task; listeners must accept both (the controller
+  // queues them in a multi-producer queue, which the scheduler thread polls,
+  // as deliversEventsOnSchedulerThread() is false). The threshold is
+  // one-shot; the listener re-arms it via setRssiBand().
+  ((Esp32ArduinoInterface*)arg)->dispatch(Event{EV_RSSI_CHANGED, 0});
+}
+
+void Esp32ArduinoInterface::dispatch(const Event& event) {
   for (const auto& l : listeners_) {
-    l->onEvent(type);
+    l->handleEvent(event);
   }
 }
 
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+
 #include "WiFi.h"
+#include "esp_event.h"
 #include "roo_collections.h"
 #include "roo_scheduler.h"
 #include "roo_wifi/hal/esp32/arduino_preferences_store.h"
@@ -11,23 +14,27 @@ namespace roo_wifi {
 
 namespace internal {
 
-/// Linked list node storing a native ESP32 event callback.
+/// Linked list node storing a native ESP32 event callback. A plain function
+/// pointer with a context argument, rather than std::function, so that no
+/// type-erasure machinery gets linked in.
 struct Esp32ListenerListNode {
-  std::function<void(arduino_event_id_t event, arduino_event_info_t info)>
-      notify_fn;
+  void (*notify_fn)(void* context, arduino_event_id_t event,
+                    arduino_event_info_t info);
+  void* context;
   Esp32ListenerListNode* next;
   Esp32ListenerListNode* prev;
 
-  Esp32ListenerListNode(
-      std::function<void(arduino_event_id_t event, arduino_event_info_t info)>
-          notify_fn)
-      : notify_fn(notify_fn), next(nullptr), prev(nullptr) {}
+  Esp32ListenerListNode(void (*notify_fn)(void* context,
+                                          arduino_event_id_t event,
+                                          arduino_event_info_t info),
+                        void* context)
+      : notify_fn(notify_fn), context(context), next(nullptr), prev(nullptr) {}
 };
 
 }  // namespace internal
 
 /// ESP32 Arduino Wi-Fi interface implementation.
-class Esp32ArduinoInterface : public Interface {
+class Esp32ArduinoInterface final : public Interface {
  public:
   Esp32ArduinoInterface();
 
@@ -39,8 +46,24 @@ class Esp32ArduinoInterface : public Interface {
   /// Returns current AP information; false if not connected.
   bool getApInfo(NetworkDetails* info) const override;
 
+  /// Returns the signal strength of the associated AP, straight from the
+  /// driver; false if not associated.
+  bool getRssi(int8_t* rssi) const override;
+
+  /// Returns the primary channel of the associated AP; false if not
+  /// associated.
+  bool getChannel(uint8_t* channel) const override;
+
+  /// Returns the MAC address of the associated AP; false if not associated.
+  bool getBssid(uint8_t bssid[6]) const override;
+
+  /// Returns a counter that changes on connect, disconnect, and on station
+  /// connection events.
+  uint32_t apGeneration() const override { return ap_generation_; }
+
   /// Starts a scan.
   bool startScan() override;
+  bool startScan(const ScanOptions& options) override;
 
   /// Returns true if the scan has completed.
   bool scanCompleted() const override;
@@ -49,15 +72,32 @@ class Esp32ArduinoInterface : public Interface {
   bool getScanResults(std::vector<NetworkDetails>* list,
                       int max_count) const override;
 
+  /// Walks the driver's scan records in place, passing each to the visitor.
+  bool forEachScanResult(ScanResultVisitor& visitor) const override;
+
   /// Disconnects from the current network.
   void disconnect() override;
 
   /// Connects to the specified SSID/password.
   bool connect(const std::string& ssid, const std::string& passwd) override;
 
+  /// Connects to the specified SSID/password, using the BSSID and channel
+  /// from the hint to skip the scan.
+  bool connect(const std::string& ssid, const std::string& passwd,
+               const ConnectionHint& hint) override;
+
   /// Returns the current connection status.
   ConnectionStatus getStatus() override;
 
+  /// Returns RSSI_MONITORING_LOW; the driver only reports signal drops.
+  RssiMonitoring rssiMonitoring() const override {
+    return RSSI_MONITORING_LOW;
+  }
+
+  /// Arms the driver's RSSI-low threshold at `low`. The upper bound is
+  /// ignored.
+  void setRssiBand(int8_t low, int8_t high) override;
+
   /// Registers an interface event listener.
   void addEventListener(EventListener* listener) override;
 
@@ -67,10 +107,26 @@ class Esp32ArduinoInterface : public Interface {
  private:
   void dispatchEvent(WiFiEvent_t event, WiFiEventInfo_t info);
 
+  static void relayEvent(void* context, arduino_event_id_t event,
+                         arduino_event_info_t info);
+
+  static void onRssiLow(void* arg, esp_event_base_t base, int32_t id,
+                        void* data);
+
+  void dispatch(const Event& event);
+
+  void bumpApGeneration();
+
   internal::Esp32ListenerListNode event_relay_;
   roo_collections::FlatSmallHashSet<EventListener*> listeners_;
 
   bool scanning_;
+
+  // Bumped from the event task, read from the main loop.
+  std::atomic<uint32_t> ap_generation_;
+
+  // Registration of the WIFI_EVENT_STA_BSS_RSSI_LOW handler.
+  esp_event_handler_instance_t rssi_low_handler_;
 };
 
 }  // namespace roo_wifi
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <inttypes.h>
+#include <limits.h>
+#include <string.h>
 
 #include <string>
 #include <vector>
@@ -66,6 +68,101 @@ struct NetworkDetails {
   ConnectionStatus status;
 };
 
+/// Hint that lets the interface associate with a known access point directly,
+/// skipping the probe for the SSID across all channels.
+struct ConnectionHint {
+  uint8_t bssid[6];  ///< MAC address of the AP.
+  uint8_t channel;   ///< Primary channel of the AP.
+};
+
+/// Set of 2.4 GHz channels (1-14), e.g. to limit a scan to.
+class ChannelSet {
+ public:
+  /// Creates an empty set.
+  ChannelSet() : mask_(0) {}
+
+  /// Returns the set of all channels.
+  static ChannelSet All() { return ChannelSet(kAllChannels); }
+
+  /// Adds the channel. Ignores channels out of range.
+  void add(uint8_t channel) {
+    if (channel >= 1 && channel <= 14) mask_ |= (1 << channel);
+  }
+
+  bool contains(uint8_t channel) const {
+    return channel <= 14 && (mask_ & (1 << channel)) != 0;
+  }
+
+  bool empty() const { return mask_ == 0; }
+  bool isAll() const { return mask_ == kAllChannels; }
+
+  /// Returns the number of channels in the set.
+  int count() const {
+    int result = 0;
+    for (uint16_t m = mask_; m != 0; m &= m - 1) ++result;
+    return result;
+  }
+
+  /// Returns the lowest channel in the set; zero if empty.
+  uint8_t first() const {
+    for (uint8_t channel = 1; channel <= 14; ++channel) {
+      if (contains(channel)) return channel;
+    }
+    return 0;
+  }
+
+  /// Bit n stands for channel n.
+  uint16_t mask() const { return mask_; }
+
+ private:
+  static constexpr uint16_t kAllChannels = 0x7FFE;
+
+  explicit ChannelSet(uint16_t mask) : mask_(mask) {}
+
+  uint16_t mask_;
+};
+
+/// How to scan: trades the speed of scans against their completeness.
+struct ScanOptions {
+  ScanOptions()
+      : channels(ChannelSet::All()),
+        ssid(),
+        passive(false),
+        min_dwell_ms(0),
+        max_dwell_ms(300),
+        show_hidden(false),
+        max_results(100) {}
+
+  /// Channels to scan. Anything less than all of them makes a partial scan.
+  ChannelSet channels;
+
+  /// If not empty, only this SSID is looked for (also a partial scan).
+  /// Interfaces that cannot filter by SSID may report other networks, too.
+  std::string ssid;
+
+  /// Whether to just listen for beacons, rather than send probe requests.
+  /// Passive scans are slower (and need a longer dwell time, at least the
+  /// beacon interval, typically ~100 ms), but do not transmit.
+  bool passive;
+
+  /// Time spent on each channel, in milliseconds. Active scans move on
+  /// after the minimum if no AP responds. Interfaces may ignore the
+  /// minimum.
+  uint16_t min_dwell_ms;
+  uint16_t max_dwell_ms;
+
+  /// Whether to report networks that do not broadcast their SSID (with an
+  /// empty SSID).
+  bool show_hidden;
+
+  /// Maximum number of networks that the controller keeps in the scan list
+  /// (the strongest ones). Not used by interfaces.
+  uint16_t max_results;
+
+  /// Returns true if the scan is limited to some channels, or to an SSID.
+  bool partial() const { return !channels.isAll() || !ssid.empty(); }
+};
+
 /// Abstraction for interacting with the hardware Wi-Fi interface.
 class Interface {
  public:
@@ -78,13 +175,66 @@ class Interface {
     EV_DISCONNECTED = 4,
     EV_CONNECTION_FAILED = 5,
     EV_CONNECTION_LOST = 6,
+    EV_RSSI_CHANGED = 7,  ///< Signal left the band set via setRssiBand().
+  };
+
+  /// Support for signal strength notifications (see setRssiBand()).
+  enum RssiMonitoring {
+    RSSI_MONITORING_NONE = 0,  ///< No notifications; needs polling.
+    RSSI_MONITORING_LOW = 1,   ///< Notifies only when the signal drops.
+    RSSI_MONITORING_BAND = 2,  ///< Notifies when the signal leaves the band.
+  };
+
+  /// Reason codes of disconnect events: IEEE 802.11 reason codes, plus
+  /// extended codes from 200 up. (Both match ESP-IDF's wifi_err_reason_t, so
+  /// that the ESP32 interface can pass its codes through unchanged.) Lists
+  /// the codes that the controller tells apart; interfaces may report
+  /// others.
+  enum DisconnectReason {
+    REASON_UNKNOWN = 0,
+    REASON_UNSPECIFIED = 1,
+    REASON_AUTH_EXPIRE = 2,
+    REASON_AUTH_LEAVE = 3,
+    REASON_ASSOC_EXPIRE = 4,
+    REASON_ASSOC_LEAVE = 8,
+    REASON_4WAY_HANDSHAKE_TIMEOUT = 15,
+    REASON_802_1X_AUTH_FAILED = 23,
+    REASON_BEACON_TIMEOUT = 200,
+    REASON_NO_AP_FOUND = 201,
+    REASON_AUTH_FAIL = 202,
+    REASON_ASSOC_FAIL = 203,
+    REASON_HANDSHAKE_TIMEOUT = 204,
+    REASON_CONNECTION_FAIL = 205,
+  };
+
+  /// Interface event, with its payload.
+  struct Event {
+    EventType type;
+    /// Reason code of disconnect events (see DisconnectReason); zero if
+    /// unknown or not applicable.
+    uint16_t reason;
   };
 
   /// Listener for interface events.
+  ///
+  /// Note: interfaces may call listeners from a different thread (e.g. the
+  /// ESP32 event task).
   class EventListener {
    public:
     virtual ~EventListener() {}
-    virtual void onEvent(EventType type) {}
+    virtual void onEvent(EventType /*type*/) {}
+    /// Called by interfaces for every event. The default implementation
+    /// forwards to onEvent(event.type).
+    virtual void handleEvent(const Event& event) { onEvent(event.type); }
+  };
+
+  /// Receives scan results, one at a time (see forEachScanResult()).
+  class ScanResultVisitor {
+   public:
+    virtual ~ScanResultVisitor() {}
+    /// Called for each scan result. The reference is only valid for the
+    /// duration of the call. Returns false to stop the iteration.
+    virtual bool visit(const NetworkDetails& result) = 0;
   };
 
   /// Registers an interface event listener.
@@ -94,21 +244,96 @@ class Interface {
 
   /// Returns current AP information; false if not connected.
   virtual bool getApInfo(NetworkDetails* info) const = 0;
-  /// Starts a scan.
+  /// Starts a scan of all channels, with default options.
   virtual bool startScan() = 0;
+  /// Starts a scan with the specified options. Partial scans (limited to
+  /// some channels, or to an SSID) take a fraction of the airtime of a full
+  /// scan, and keep the radio off the home channel for shorter. Interfaces
+  /// may scan more than requested (e.g. if the driver can only limit scans
+  /// to a single channel). The default implementation ignores the options.
+  virtual bool startScan(const ScanOptions& /*options*/) { return startScan(); }
   /// Returns true if the last scan has completed.
   virtual bool scanCompleted() const = 0;
 
   /// Disconnects from the current network.
   virtual void disconnect() = 0;
-  /// Connects to the specified SSID/password.
+  /// Connects to the specified SSID/password. If the attempt fails, or the
+  /// connection is later lost, the interface should report it and stay
+  /// disconnected: reconnecting is up to the controller (see
+  /// ReconnectPolicy).
   virtual bool connect(const std::string& ssid, const std::string& passwd) = 0;
+  /// Connects to the specified SSID/password, associating directly with the
+  /// AP indicated by the hint. If that AP is not available, the attempt fails
+  /// (it is up to the caller to fall back to the plain connect). The default
+  /// implementation ignores the hint.
+  virtual bool connect(const std::string& ssid, const std::string& passwd,
+                       const ConnectionHint& /*hint*/) {
+    return connect(ssid, passwd);
+  }
   /// Returns the current connection status.
   virtual ConnectionStatus getStatus() = 0;
 
+  /// Returns the signal strength of the associated AP; false if not
+  /// associated. Meant to be cheap and allocation-free. The default
+  /// implementation uses getApInfo().
+  virtual bool getRssi(int8_t* rssi) const {
+    NetworkDetails info;
+    if (!getApInfo(&info)) return false;
+    *rssi = info.rssi;
+    return true;
+  }
+  /// Returns the primary channel of the associated AP; false if not
+  /// associated. The default implementation uses getApInfo().
+  virtual bool getChannel(uint8_t* channel) const {
+    NetworkDetails info;
+    if (!getApInfo(&info)) return false;
+    *channel = info.primary;
+    return true;
+  }
+  /// Returns the MAC address of the associated AP; false if not associated.
+  /// The default implementation uses getApInfo().
+  virtual bool getBssid(uint8_t bssid[6]) const {
+    NetworkDetails info;
+    if (!getApInfo(&info)) return false;
+    memcpy(bssid, info.bssid, 6);
+    return true;
+  }
+  /// Returns a counter that changes whenever the association may have
+  /// changed (e.g. a connect, or a disconnect). While it stays the same, the
+  /// SSID and the auth mode reported by getApInfo() stay the same too, so
+  /// callers can get by with getRssi(). Zero means that the interface does
+  /// not track it; this is what the default implementation returns.
+  virtual uint32_t apGeneration() const { return 0; }
+
+  /// Returns true if event listeners get called on the thread that runs the
+  /// controller's scheduler (e.g. from scheduler tasks). Otherwise, the
+  /// controller does not touch the scheduler from the listener, as it may
+  /// not be thread-safe; it polls for queued events instead, every
+  /// few milliseconds. The default implementation returns false.
+  virtual bool deliversEventsOnSchedulerThread() const { return false; }
+
+  /// Returns the supported kind of signal strength notifications.
+  virtual RssiMonitoring rssiMonitoring() const { return RSSI_MONITORING_NONE; }
+  /// Requests a single EV_RSSI_CHANGED when the signal of the current AP
+  /// drops below `low`, or (if supported) rises above `high`. Replaces the
+  /// previously set band. Needs to be called again after the event fires.
+  virtual void setRssiBand(int8_t /*low*/, int8_t /*high*/) {}
+
   /// Returns scan results, up to max_count entries.
   virtual bool getScanResults(std::vector<NetworkDetails>* list,
                               int max_count) const = 0;
+  /// Passes the results of the last completed scan to the visitor, in the
+  /// order reported by the driver, without copying them into intermediate
+  /// containers. Returns false if there are no scan results. The default
+  /// implementation uses getScanResults().
+  virtual bool forEachScanResult(ScanResultVisitor& visitor) const {
+    std::vector<NetworkDetails> list;
+    if (!getScanResults(&list, INT_MAX)) return false;
+    for (const NetworkDetails& result : list) {
+      if (!visitor.visit(result)) break;
+    }
+    return true;
+  }
   /// Virtual destructor.
   virtual ~Interface() {}
 };
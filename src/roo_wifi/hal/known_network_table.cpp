@@ -0,0 +1,218 @@
+#include "roo_wifi/hal/known_network_table.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace roo_wifi {
+
+// Encoding (all integers little-endian):
+//
+//   header:  'K' 'N' <version> <reserved: 0> <u32 payload size>
+//            <u32 FNV-1a checksum of the payload>
+//   payload: entries, in SSID order, each:
+//            <u8 SSID length> <SSID> <u8 flags>
+//            [<u8 password length> <password>]   if KNOWN_NETWORK_PASSWORD
+//            [<6-byte BSSID> <u8 channel>]         if KNOWN_NETWORK_HINT
+//            [<u16 attempts> <u16 successes>
+//             <u32 avg time to IP>]                if KNOWN_NETWORK_HISTORY
+
+namespace {
+
+constexpr size_t kHeaderSize = 12;
+
+uint32_t Fnv1a(const uint8_t* data, size_t size) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    h ^= data[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void PutU16(std::vector<uint8_t>* out, uint16_t v) {
+  out->push_back(v & 0xFF);
+  out->push_back(v >> 8);
+}
+
+void PutU32(std::vector<uint8_t>* out, uint32_t v) {
+  PutU16(out, v & 0xFFFF);
+  PutU16(out, v >> 16);
+}
+
+void PutString(std::vector<uint8_t>* out, const std::string& s) {
+  out->push_back((uint8_t)s.size());
+  out->insert(out->end(), s.begin(), s.end());
+}
+
+// Bounds-checked reader over the payload.
+class Reader {
+ public:
+  Reader(const uint8_t* data, size_t size) : pos_(data), end_(data + size) {}
+
+  bool done() const { return pos_ == end_; }
+
+  bool u8(uint8_t& v) {
+    if (end_ - pos_ < 1) return false;
+    v = *pos_++;
+    return true;
+  }
+
+  bool u16(uint16_t& v) {
+    if (end_ - pos_ < 2) return false;
+    v = pos_[0] | (pos_[1] << 8);
+    pos_ += 2;
+    return true;
+  }
+
+  bool u32(uint32_t& v) {
+    uint16_t lo, hi;
+    if (!u16(lo) || !u16(hi)) return false;
+    v = lo | ((uint32_t)hi << 16);
+    return true;
+  }
+
+  bool bytes(uint8_t* dst, size_t len) {
+    if ((size_t)(end_ - pos_) < len) return false;
+    memcpy(dst, pos_, len);
+    pos_ += len;
+    return true;
+  }
+
+  bool string(std::string& s) {
+    uint8_t len;
+    if (!u8(len) || end_ - pos_ < len) return false;
+    s.assign((const char*)pos_, len);
+    pos_ += len;
+    return true;
+  }
+
+ private:
+  const uint8_t* pos_;
+  const uint8_t* end_;
+};
+
+}  // namespace
+
+constexpr uint8_t KnownNetworkTable::kVersion;
+
+KnownNetworkTable::KnownNetworkTable() : entries_() {}
+
+std::vector<KnownNetwork>::iterator KnownNetworkTable::lowerBound(
+    roo::string_view ssid) {
+  return std::lower_bound(entries_.begin(), entries_.end(), ssid,
+                          [](const KnownNetwork& e, roo::string_view s) {
+                            return roo::string_view(e.ssid).compare(s) < 0;
+                          });
+}
+
+const KnownNetwork* KnownNetworkTable::find(roo::string_view ssid) const {
+  auto itr = const_cast<KnownNetworkTable*>(this)->lowerBound(ssid);
+  if (itr == entries_.end() || roo::string_view(itr->ssid) != ssid) {
+    return nullptr;
+  }
+  return &*itr;
+}
+
+KnownNetwork& KnownNetworkTable::insert(const std::string& ssid) {
+  auto itr = lowerBound(ssid);
+  if (itr == entries_.end() || itr->ssid != ssid) {
+    itr = entries_.insert(itr, KnownNetwork());
+    itr->ssid = ssid;
+    itr->flags = 0;
+  }
+  return *itr;
+}
+
+bool KnownNetworkTable::clear(const std::string& ssid, uint8_t flags) {
+  auto itr = lowerBound(ssid);
+  if (itr == entries_.end() || itr->ssid != ssid) return false;
+  if ((itr->flags & flags) == 0) return false;
+  itr->flags &= ~flags;
+  if ((flags & KNOWN_NETWORK_PASSWORD) != 0) itr->password.clear();
+  if (itr->flags == 0) entries_.erase(itr);
+  return true;
+}
+
+void KnownNetworkTable::forEach(KnownNetworkVisitor& visitor) const {
+  for (const KnownNetwork& e : entries_) {
+    if (!visitor.visit(e)) return;
+  }
+}
+
+void KnownNetworkTable::encode(std::vector<uint8_t>* out) const {
+  out->clear();
+  out->resize(kHeaderSize);
+  for (const KnownNetwork& e : entries_) {
+    // Never the case for valid 802.11 SSIDs (up to 32 bytes) and passphrases
+    // (up to 64 bytes).
+    if (e.ssid.size() > 255 || e.password.size() > 255) continue;
+    PutString(out, e.ssid);
+    out->push_back(e.flags);
+    if (e.flags & KNOWN_NETWORK_PASSWORD) {
+      PutString(out, e.password);
+    }
+    if (e.flags & KNOWN_NETWORK_HINT) {
+      out->insert(out->end(), e.hint.bssid, e.hint.bssid + 6);
+      out->push_back(e.hint.channel);
+    }
+    if (e.flags & KNOWN_NETWORK_HISTORY) {
+      PutU16(out, e.history.attempts);
+      PutU16(out, e.history.successes);
+      PutU32(out, e.history.avg_time_to_ip_ms);
+    }
+  }
+  uint32_t payload_size = out->size() - kHeaderSize;
+  std::vector<uint8_t> header;
+  header.reserve(kHeaderSize);
+  header.push_back('K');
+  header.push_back('N');
+  header.push_back(kVersion);
+  header.push_back(0);
+  PutU32(&header, payload_size);
+  PutU32(&header, Fnv1a(out->data() + kHeaderSize, payload_size));
+  std::copy(header.begin(), header.end(), out->begin());
+}
+
+bool KnownNetworkTable::decode(const uint8_t* data, size_t size) {
+  entries_.clear();
+  Reader header(data, std::min(size, kHeaderSize));
+  uint8_t magic[2], version, reserved;
+  uint32_t payload_size, checksum;
+  if (!header.bytes(magic, 2) || !header.u8(version) ||
+      !header.u8(reserved) || !header.u32(payload_size) ||
+      !header.u32(checksum)) {
+    return false;
+  }
+  if (magic[0] != 'K' || magic[1] != 'N' || version != kVersion ||
+      payload_size != size - kHeaderSize ||
+      Fnv1a(data + kHeaderSize, payload_size) != checksum) {
+    return false;
+  }
+  Reader payload(data + kHeaderSize, payload_size);
+  while (!payload.done()) {
+    KnownNetwork e;
+    bool ok = payload.string(e.ssid) && payload.u8(e.flags);
+    if (ok && (e.flags & KNOWN_NETWORK_PASSWORD)) {
+      ok = payload.string(e.password);
+    }
+    if (ok && (e.flags & KNOWN_NETWORK_HINT)) {
+      ok = payload.bytes(e.hint.bssid, 6) && payload.u8(e.hint.channel);
+    }
+    if (ok && (e.flags & KNOWN_NETWORK_HISTORY)) {
+      ok = payload.u16(e.history.attempts) &&
+           payload.u16(e.history.successes) &&
+           payload.u32(e.history.avg_time_to_ip_ms);
+    }
+    // Entries must be strictly sorted.
+    if (ok && !entries_.empty()) ok = (entries_.back().ssid < e.ssid);
+    if (!ok) {
+      entries_.clear();
+      return false;
+    }
+    entries_.push_back(std::move(e));
+  }
+  return true;
+}
+
+}  // namespace roo_wifi
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_wifi/hal/store.h"
+
+namespace roo_wifi {
+
+/// In-memory table of known networks, sorted by SSID, with a compact,
+/// versioned binary encoding.
+///
+/// Used by stores that keep all networks together, e.g. as a single flash
+/// blob that gets loaded once, and rewritten atomically on updates.
+class KnownNetworkTable {
+ public:
+  /// Current version of the encoding.
+  static constexpr uint8_t kVersion = 1;
+
+  KnownNetworkTable();
+
+  /// Returns the number of entries.
+  size_t size() const { return entries_.size(); }
+
+  /// Removes all entries.
+  void clear() { entries_.clear(); }
+
+  /// Returns the entry for the SSID, or nullptr if there is none.
+  const KnownNetwork* find(roo::string_view ssid) const;
+
+  /// Returns the entry for the SSID, adding one (with no flags) if needed.
+  /// The caller is expected to set some field, along with its flag.
+  KnownNetwork& insert(const std::string& ssid);
+
+  /// Clears the specified flags of the entry for the SSID, removing the entry
+  /// if no flags remain. Returns true if the table has changed.
+  bool clear(const std::string& ssid, uint8_t flags);
+
+  /// Calls the visitor for each entry, in SSID order.
+  void forEach(KnownNetworkVisitor& visitor) const;
+
+  /// Replaces the content of `out` with the encoded table.
+  void encode(std::vector<uint8_t>* out) const;
+
+  /// Replaces the table with the decoded content. Returns false (leaving the
+  /// table empty) if the data is malformed, corrupted, or has an unsupported
+  /// version.
+  bool decode(const uint8_t* data, size_t size);
+
+ private:
+  std::vector<KnownNetwork>::iterator lowerBound(roo::string_view ssid);
+
+  std::vector<KnownNetwork> entries_;
+};
+
+}  // namespace roo_wifi
@@ -0,0 +1,136 @@
+#include "roo_wifi/hal/simulated/in_memory_store.h"
+
+namespace roo_wifi {
+
+InMemoryStore::InMemoryStore()
+    : enabled_(false),
+      default_ssid_(),
+      networks_(),
+      batch_depth_(0),
+      batch_dirty_(false),
+      commit_count_(0),
+      read_count_(0),
+      write_count_(0) {}
+
+bool InMemoryStore::getIsInterfaceEnabled() {
+  ++read_count_;
+  return enabled_;
+}
+
+void InMemoryStore::setIsInterfaceEnabled(bool enabled) {
+  countWrite();
+  enabled_ = enabled;
+}
+
+std::string InMemoryStore::getDefaultSSID() {
+  ++read_count_;
+  return default_ssid_;
+}
+
+void InMemoryStore::setDefaultSSID(const std::string& ssid) {
+  countWrite();
+  default_ssid_ = ssid;
+}
+
+void InMemoryStore::clearDefaultSSID() {
+  countWrite();
+  default_ssid_.clear();
+}
+
+bool InMemoryStore::getPassword(const std::string& ssid,
+                                std::string& password) {
+  ++read_count_;
+  const KnownNetwork* network = networks_.find(ssid);
+  if (network == nullptr || !(network->flags & KNOWN_NETWORK_PASSWORD)) {
+    return false;
+  }
+  password = network->password;
+  return true;
+}
+
+void InMemoryStore::setPassword(const std::string& ssid,
+                                roo::string_view password) {
+  countWrite();
+  KnownNetwork& network = networks_.insert(ssid);
+  network.password.assign(password.data(), password.size());
+  network.flags |= KNOWN_NETWORK_PASSWORD;
+}
+
+void InMemoryStore::clearPassword(const std::string& ssid) {
+  countWrite();
+  networks_.clear(ssid, KNOWN_NETWORK_PASSWORD);
+}
+
+bool InMemoryStore::getConnectionHint(const std::string& ssid,
+                                      ConnectionHint& hint) {
+  ++read_count_;
+  const KnownNetwork* network = networks_.find(ssid);
+  if (network == nullptr || !(network->flags & KNOWN_NETWORK_HINT)) {
+    return false;
+  }
+  hint = network->hint;
+  return true;
+}
+
+void InMemoryStore::setConnectionHint(const std::string& ssid,
+                                      const ConnectionHint& hint) {
+  countWrite();
+  KnownNetwork& network = networks_.insert(ssid);
+  network.hint = hint;
+  network.flags |= KNOWN_NETWORK_HINT;
+}
+
+void InMemoryStore::clearConnectionHint(const std::string& ssid) {
+  countWrite();
+  networks_.clear(ssid, KNOWN_NETWORK_HINT);
+}
+
+bool InMemoryStore::getConnectionHistory(const std::string& ssid,
+                                         ConnectionHistory& history) {
+  ++read_count_;
+  const KnownNetwork* network = networks_.find(ssid);
+  if (network == nullptr || !(network->flags & KNOWN_NETWORK_HISTORY)) {
+    return false;
+  }
+  history = network->history;
+  return true;
+}
+
+void InMemoryStore::setConnectionHistory(const std::string& ssid,
+                                         const ConnectionHistory& history) {
+  countWrite();
+  KnownNetwork& network = networks_.insert(ssid);
+  network.history = history;
+  network.flags |= KNOWN_NETWORK_HISTORY;
+}
+
+void InMemoryStore::clearConnectionHistory(const std::string& ssid) {
+  countWrite();
+  networks_.clear(ssid, KNOWN_NETWORK_HISTORY);
+}
+
+bool InMemoryStore::forEachKnownNetwork(KnownNetworkVisitor& visitor) {
+  ++read_count_;
+  networks_.forEach(visitor);
+  return true;
+}
+
+void InMemoryStore::beginBatch() {
+  if (batch_depth_++ == 0) batch_dirty_ = false;
+}
+
+void InMemoryStore::endBatch() {
+  if (--batch_depth_ > 0) return;
+  if (batch_dirty_) ++commit_count_;
+}
+
+void InMemoryStore::countWrite() {
+  ++write_count_;
+  if (batch_depth_ > 0) {
+    batch_dirty_ = true;
+  } else {
+    ++commit_count_;
+  }
+}
+
+}  // namespace roo_wifi
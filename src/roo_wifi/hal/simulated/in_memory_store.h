@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+
+#include "roo_wifi/hal/known_network_table.h"
+#include "roo_wifi/hal/store.h"
+
+namespace roo_wifi {
+
+/// Store implementation that keeps everything in RAM.
+///
+/// Intended for host-side tests, benchmarks and simulations; nothing survives
+/// the object lifetime.
+class InMemoryStore final : public Store {
+ public:
+  InMemoryStore();
+
+  /// Returns whether the Wi-Fi interface is enabled.
+  bool getIsInterfaceEnabled() override;
+
+  /// Sets whether the Wi-Fi interface is enabled.
+  void setIsInterfaceEnabled(bool enabled) override;
+
+  /// Returns the default SSID, if any.
+  std::string getDefaultSSID() override;
+
+  /// Sets the default SSID.
+  void setDefaultSSID(const std::string& ssid) override;
+
+  /// Clears the default SSID.
+  void clearDefaultSSID() override;
+
+  /// Retrieves a stored password for an SSID.
+  bool getPassword(const std::string& ssid, std::string& password) override;
+
+  /// Stores a password for an SSID.
+  void setPassword(const std::string& ssid, roo::string_view password) override;
+
+  /// Clears a stored password for an SSID.
+  void clearPassword(const std::string& ssid) override;
+
+  /// Retrieves the connection hint for an SSID.
+  bool getConnectionHint(const std::string& ssid,
+                         ConnectionHint& hint) override;
+
+  /// Stores the connection hint for an SSID.
+  void setConnectionHint(const std::string& ssid,
+                         const ConnectionHint& hint) override;
+
+  /// Clears the connection hint for an SSID.
+  void clearConnectionHint(const std::string& ssid) override;
+
+  /// Retrieves the connection history of an SSID.
+  bool getConnectionHistory(const std::string& ssid,
+                            ConnectionHistory& history) override;
+
+  /// Stores the connection history of an SSID.
+  void setConnectionHistory(const std::string& ssid,
+                            const ConnectionHistory& history) override;
+
+  /// Clears the connection history of an SSID.
+  void clearConnectionHistory(const std::string& ssid) override;
+
+  /// Calls the visitor for each known network.
+  bool forEachKnownNetwork(KnownNetworkVisitor& visitor) override;
+
+  /// Starts a batch of writes.
+  void beginBatch() override;
+
+  /// Ends a batch of writes.
+  void endBatch() override;
+
+  /// Returns the number of (simulated) commits so far.
+  uint32_t commitCount() const override { return commit_count_; }
+
+  /// Returns the number of read operations served so far.
+  int readCount() const { return read_count_; }
+
+  /// Returns the number of write operations served so far.
+  int writeCount() const { return write_count_; }
+
+ private:
+  void countWrite();
+
+  bool enabled_;
+  std::string default_ssid_;
+  KnownNetworkTable networks_;
+
+  int batch_depth_;
+  bool batch_dirty_;
+  uint32_t commit_count_;
+
+  int read_count_;
+  int write_count_;
+};
+
+}  // namespace roo_wifi
@@ -0,0 +1,142 @@
+#include "roo_wifi/hal/simulated/rf_environment.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace roo_wifi {
+
+RfEnvironment::Site::Site(roo::string_view ssid, roo::string_view password,
+                          int8_t rssi)
+    : ssid(ssid.data(), ssid.size()),
+      password(password.data(), password.size()),
+      authmode(password.empty() ? WIFI_AUTH_OPEN : WIFI_AUTH_WPA2_PSK),
+      channel(1),
+      rssi(rssi),
+      rssi_drift(0),
+      rssi_spread(0),
+      mean_uptime(roo_time::Millis(0)),
+      mean_downtime(roo_time::Millis(0)),
+      association_failure_rate(0),
+      association_failure_reason(Interface::REASON_ASSOC_FAIL) {}
+
+RfEnvironment::RfEnvironment(roo_scheduler::Scheduler& scheduler,
+                             SimulatedInterface& interface, uint32_t seed)
+    : interface_(interface),
+      sites_(),
+      step_(roo_time::Seconds(5)),
+      rng_(seed),
+      covered_(false),
+      uncovered_since_(roo_time::Uptime::Now()),
+      time_without_coverage_(roo_time::Millis(0)),
+      outage_count_(0),
+      step_task_(scheduler, [this]() { step(); }) {}
+
+int RfEnvironment::addSite(const Site& site) {
+  sites_.push_back(SiteState{site, false, site.rssi, {0}});
+  int idx = sites_.size() - 1;
+  setUp(idx, true);
+  return idx;
+}
+
+void RfEnvironment::setUp(int idx, bool up) {
+  SiteState& state = sites_[idx];
+  if (state.up == up) return;
+  state.up = up;
+  if (up) {
+    const Site& site = state.site;
+    int ap = interface_.addAccessPoint(site.ssid, state.rssi, site.authmode,
+                                       site.password, site.channel);
+    SimulatedInterface::AccessPoint& added = interface_.accessPoint(ap);
+    added.association_failure_rate = site.association_failure_rate;
+    added.association_failure_reason = site.association_failure_reason;
+    // The same AP comes back after an outage, so keep its BSSID.
+    if (state.bssid[0] == 0) {
+      memcpy(state.bssid, added.details.bssid, 6);
+    } else {
+      memcpy(added.details.bssid, state.bssid, 6);
+    }
+  } else {
+    ++outage_count_;
+    int ap = findAccessPoint(state);
+    if (ap >= 0) interface_.removeAccessPoint(ap);
+  }
+  updateCoverage();
+}
+
+void RfEnvironment::start() {
+  if (!step_task_.is_scheduled()) step_task_.scheduleAfter(step_);
+}
+
+roo_time::Duration RfEnvironment::timeWithoutCoverage() const {
+  if (covered_) return time_without_coverage_;
+  return time_without_coverage_ + (roo_time::Uptime::Now() - uncovered_since_);
+}
+
+void RfEnvironment::step() {
+  for (size_t i = 0; i < sites_.size(); ++i) {
+    SiteState& state = sites_[i];
+    bool churns = state.site.mean_uptime.inMicros() > 0;
+    if (state.up) {
+      if (churns && happens(state.site.mean_uptime)) {
+        setUp(i, false);
+      } else {
+        drift(state);
+      }
+    } else if (churns && happens(state.site.mean_downtime)) {
+      setUp(i, true);
+    }
+  }
+  step_task_.scheduleAfter(step_);
+}
+
+void RfEnvironment::drift(SiteState& state) {
+  const Site& site = state.site;
+  if (site.rssi_drift == 0) return;
+  int rssi = state.rssi + (int)(rng_() % (2 * site.rssi_drift + 1)) -
+             site.rssi_drift;
+  rssi = std::max(rssi, std::max(-127, site.rssi - site.rssi_spread));
+  rssi = std::min(rssi, std::min(0, site.rssi + site.rssi_spread));
+  if (rssi == state.rssi) return;
+  state.rssi = rssi;
+  int ap = findAccessPoint(state);
+  if (ap >= 0) interface_.setAccessPointRssi(ap, rssi);
+}
+
+int RfEnvironment::findAccessPoint(const SiteState& state) {
+  for (int i = 0; i < interface_.accessPointCount(); ++i) {
+    if (memcmp(interface_.accessPoint(i).details.bssid, state.bssid, 6) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool RfEnvironment::happens(roo_time::Duration mean_interval) {
+  if (mean_interval <= step_) return true;
+  // Uses the raw generator output (rather than a distribution), so that the
+  // sequence is the same on all platforms.
+  double p = (double)step_.inMicros() / mean_interval.inMicros();
+  return rng_() < p * 4294967296.0;
+}
+
+bool RfEnvironment::anyUp() const {
+  for (const SiteState& state : sites_) {
+    if (state.up) return true;
+  }
+  return false;
+}
+
+void RfEnvironment::updateCoverage() {
+  bool covered = anyUp();
+  if (covered == covered_) return;
+  covered_ = covered;
+  roo_time::Uptime now = roo_time::Uptime::Now();
+  if (covered) {
+    time_without_coverage_ += (now - uncovered_since_);
+  } else {
+    uncovered_since_ = now;
+  }
+}
+
+}  // namespace roo_wifi
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_scheduler.h"
+#include "roo_wifi/hal/simulated/simulated_interface.h"
+
+namespace roo_wifi {
+
+/// Randomized, but reproducible, radio environment for a SimulatedInterface.
+///
+/// Consists of sites (access points) that can come and go, and whose signal
+/// strength drifts. The environment evolves in discrete steps, run by the
+/// scheduler; all randomness comes from a seeded generator, so that a given
+/// seed always yields the same history.
+class RfEnvironment {
+ public:
+  /// An access point, and how it behaves over time.
+  struct Site {
+    Site(roo::string_view ssid, roo::string_view password, int8_t rssi);
+
+    std::string ssid;
+    std::string password;
+    AuthMode authmode;
+    uint8_t channel;
+
+    /// Average signal strength.
+    int8_t rssi;
+
+    /// Maximum change of the signal strength per step, in dB. The signal
+    /// makes a random walk, within `rssi_spread` from the average.
+    uint8_t rssi_drift;
+    uint8_t rssi_spread;
+
+    /// Average time that the AP stays up, and down. Zero uptime means that
+    /// the AP only goes down, and comes back, via setUp().
+    roo_time::Duration mean_uptime;
+    roo_time::Duration mean_downtime;
+
+    /// See SimulatedInterface::AccessPoint::association_failure_rate.
+    float association_failure_rate;
+
+    /// See SimulatedInterface::AccessPoint::association_failure_reason.
+    uint16_t association_failure_reason;
+  };
+
+  RfEnvironment(roo_scheduler::Scheduler& scheduler,
+                SimulatedInterface& interface, uint32_t seed = 1);
+
+  /// Sets the simulation step. Defaults to 5 seconds.
+  void setStep(roo_time::Duration step) { step_ = step; }
+
+  /// Adds a site, initially up. Returns its index.
+  int addSite(const Site& site);
+
+  /// Returns the number of sites.
+  int siteCount() const { return sites_.size(); }
+
+  /// Returns true if the site at the specified index is currently up.
+  bool isUp(int idx) const { return sites_[idx].up; }
+
+  /// Takes the site at the specified index up or down.
+  void setUp(int idx, bool up);
+
+  /// Returns the current signal strength of the site at the specified index.
+  int8_t rssi(int idx) const { return sites_[idx].rssi; }
+
+  /// Starts evolving the environment.
+  void start();
+
+  /// Stops evolving the environment.
+  void stop() { step_task_.cancel(); }
+
+  /// Returns the total time during which no site was up (and therefore no
+  /// connection was possible).
+  roo_time::Duration timeWithoutCoverage() const;
+
+  /// Returns the number of times that a site went down.
+  uint32_t outageCount() const { return outage_count_; }
+
+ private:
+  struct SiteState {
+    Site site;
+    bool up;
+    int8_t rssi;
+    uint8_t bssid[6];
+  };
+
+  void step();
+  void drift(SiteState& state);
+
+  // Returns the index of the site's AP in the interface, or -1.
+  int findAccessPoint(const SiteState& state);
+
+  // Returns true with the probability that an event with the specified mean
+  // interval happens within a step.
+  bool happens(roo_time::Duration mean_interval);
+
+  bool anyUp() const;
+  void updateCoverage();
+
+  SimulatedInterface& interface_;
+  std::vector<SiteState> sites_;
+  roo_time::Duration step_;
+  std::mt19937 rng_;
+
+  bool covered_;
+  roo_time::Uptime uncovered_since_;
+  roo_time::Duration time_without_coverage_;
+  uint32_t outage_count_;
+
+  roo_scheduler::SingletonTask step_task_;
+};
+
+}  // namespace roo_wifi
@@ -0,0 +1,388 @@
+#include "roo_wifi/hal/simulated/simulated_interface.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace roo_wifi {
+
+SimulatedInterface::SimulatedInterface(roo_scheduler::Scheduler& scheduler)
+    : scan_duration_(roo_time::Millis(2000)),
+      event_latency_(roo_time::Millis(0)),
+      access_points_(),
+      scan_results_(),
+      scan_options_(),
+      scanning_(false),
+      scan_completed_(false),
+      has_target_(false),
+      target_(),
+      status_(WL_DISCONNECTED),
+      ap_generation_(1),
+      rssi_band_armed_(false),
+      rssi_band_low_(-128),
+      rssi_band_high_(127),
+      pending_(),
+      listeners_(),
+      scan_count_(0),
+      partial_scan_count_(0),
+      scan_time_(roo_time::Millis(0)),
+      connect_count_(0),
+      hinted_connect_count_(0),
+      ap_info_count_(0),
+      next_bssid_(1),
+      rng_(1),
+      scan_timer_(scheduler, [this]() { completeScan(); }),
+      delivery_(scheduler, [this]() { deliverDueEvents(); }),
+      rssi_poll_(scheduler, [this]() {
+        checkRssiBand();
+        if (rssi_band_armed_) rssi_poll_.scheduleAfter(roo_time::Seconds(1));
+      }) {}
+
+int SimulatedInterface::addAccessPoint(roo::string_view ssid, int8_t rssi,
+                                       AuthMode authmode,
+                                       roo::string_view password,
+                                       uint8_t channel) {
+  AccessPoint ap;
+  memset(&ap.details, 0, sizeof(ap.details));
+  size_t len = std::min<size_t>(ssid.size(), 32);
+  memcpy(ap.details.ssid, ssid.data(), len);
+  ap.details.ssid[len] = 0;
+  // Locally-administered MAC, unique within the simulation.
+  uint32_t id = next_bssid_++;
+  ap.details.bssid[0] = 0x02;
+  ap.details.bssid[1] = 0x00;
+  ap.details.bssid[2] = (id >> 24) & 0xFF;
+  ap.details.bssid[3] = (id >> 16) & 0xFF;
+  ap.details.bssid[4] = (id >> 8) & 0xFF;
+  ap.details.bssid[5] = id & 0xFF;
+  ap.details.primary = channel;
+  ap.details.rssi = rssi;
+  ap.details.authmode = authmode;
+  ap.details.pairwise_cipher = WIFI_CIPHER_TYPE_CCMP;
+  ap.details.group_cipher = WIFI_CIPHER_TYPE_CCMP;
+  ap.details.use_11b = true;
+  ap.details.use_11g = true;
+  ap.details.use_11n = true;
+  ap.details.supports_wps = false;
+  ap.details.status = WL_DISCONNECTED;
+  ap.password = std::string(password.data(), password.size());
+  ap.association_failure_rate = 0;
+  ap.association_failure_reason = REASON_ASSOC_FAIL;
+  access_points_.push_back(std::move(ap));
+  return access_points_.size() - 1;
+}
+
+void SimulatedInterface::setAccessPointRssi(int idx, int8_t rssi) {
+  access_points_[idx].details.rssi = rssi;
+  checkRssiBand();
+}
+
+void SimulatedInterface::removeAccessPoint(int idx) {
+  bool lost = associated() &&
+              memcmp(access_points_[idx].details.bssid, target_.bssid, 6) == 0;
+  access_points_.erase(access_points_.begin() + idx);
+  if (lost) {
+    pending_.clear();
+    delivery_.cancel();
+    enqueue(EV_CONNECTION_LOST, REASON_BEACON_TIMEOUT);
+  }
+}
+
+void SimulatedInterface::clearAccessPoints() { access_points_.clear(); }
+
+void SimulatedInterface::completeScan() {
+  scan_timer_.cancel();
+  scan_results_.clear();
+  for (const AccessPoint& ap : access_points_) {
+    const char* ssid = (const char*)ap.details.ssid;
+    // Like hardware, full scans report APs on channels outside the set too.
+    if (!scan_options_.channels.isAll() &&
+        !scan_options_.channels.contains(ap.details.primary)) {
+      continue;
+    }
+    if (!scan_options_.ssid.empty() && scan_options_.ssid != ssid) continue;
+    if (!scan_options_.show_hidden && ssid[0] == 0) continue;
+    scan_results_.push_back(ap.details);
+  }
+  scanning_ = false;
+  scan_completed_ = true;
+  notify(EV_SCAN_COMPLETED);
+}
+
+void SimulatedInterface::emitEvent(EventType type, uint16_t reason) {
+  if (type == EV_SCAN_COMPLETED) {
+    completeScan();
+    return;
+  }
+  apply(type);
+  notify(type, reason);
+}
+
+void SimulatedInterface::addEventListener(EventListener* listener) {
+  listeners_.insert(listener);
+}
+
+void SimulatedInterface::removeEventListener(EventListener* listener) {
+  listeners_.erase(listener);
+}
+
+bool SimulatedInterface::getApInfo(NetworkDetails* info) const {
+  ++ap_info_count_;
+  if (!associated()) return false;
+  *info = target_;
+  info->rssi = targetRssi();
+  info->status = status_;
+  return true;
+}
+
+bool SimulatedInterface::getRssi(int8_t* rssi) const {
+  if (!associated()) return false;
+  *rssi = targetRssi();
+  return true;
+}
+
+bool SimulatedInterface::getChannel(uint8_t* channel) const {
+  if (!associated()) return false;
+  *channel = target_.primary;
+  return true;
+}
+
+bool SimulatedInterface::getBssid(uint8_t bssid[6]) const {
+  if (!associated()) return false;
+  memcpy(bssid, target_.bssid, 6);
+  return true;
+}
+
+bool SimulatedInterface::associated() const {
+  return has_target_ && (status_ == WL_IDLE_STATUS || status_ == WL_CONNECTED);
+}
+
+int8_t SimulatedInterface::targetRssi() const {
+  // Reflect signal drift of the associated AP, if it is still around.
+  for (const AccessPoint& ap : access_points_) {
+    if (memcmp(ap.details.bssid, target_.bssid, 6) == 0) {
+      return ap.details.rssi;
+    }
+  }
+  return target_.rssi;
+}
+
+void SimulatedInterface::bumpApGeneration() {
+  if (++ap_generation_ == 0) ap_generation_ = 1;
+}
+
+bool SimulatedInterface::startScan() { return startScan(ScanOptions()); }
+
+bool SimulatedInterface::startScan(const ScanOptions& options) {
+  if (scanning_) return true;
+  ++scan_count_;
+  if (options.partial()) ++partial_scan_count_;
+  scan_options_ = options;
+  scanning_ = true;
+  scan_completed_ = false;
+  // The dwell time per channel is what counts.
+  roo_time::Duration duration = roo_time::Micros(
+      scan_duration_.inMicros() * options.channels.count() *
+      options.max_dwell_ms / (14 * ScanOptions().max_dwell_ms));
+  scan_time_ += duration;
+  scan_timer_.scheduleAfter(duration);
+  return true;
+}
+
+bool SimulatedInterface::scanCompleted() const { return scan_completed_; }
+
+void SimulatedInterface::disconnect() {
+  pending_.clear();
+  delivery_.cancel();
+  if (!has_target_) return;
+  enqueue(EV_DISCONNECTED, REASON_ASSOC_LEAVE);
+}
+
+bool SimulatedInterface::connect(const std::string& ssid,
+                                 const std::string& passwd) {
+  ++connect_count_;
+  associate(findStrongest(ssid), passwd);
+  return true;
+}
+
+bool SimulatedInterface::connect(const std::string& ssid,
+                                 const std::string& passwd,
+                                 const ConnectionHint& hint) {
+  ++connect_count_;
+  ++hinted_connect_count_;
+  const AccessPoint* ap = findByBssid(ssid, hint.bssid);
+  if (ap != nullptr && ap->details.primary != hint.channel) ap = nullptr;
+  associate(ap, passwd);
+  return true;
+}
+
+void SimulatedInterface::associate(const AccessPoint* ap,
+                                   const std::string& passwd) {
+  pending_.clear();
+  delivery_.cancel();
+  bumpApGeneration();
+  status_ = WL_DISCONNECTED;
+  if (ap == nullptr) {
+    has_target_ = false;
+    status_ = WL_NO_SSID_AVAIL;
+    enqueue(EV_DISCONNECTED, REASON_NO_AP_FOUND);
+    return;
+  }
+  has_target_ = true;
+  target_ = ap->details;
+  if (ap->details.authmode != WIFI_AUTH_OPEN && ap->password != passwd) {
+    enqueue(EV_CONNECTION_FAILED, REASON_AUTH_FAIL);
+    return;
+  }
+  if (associationFails(*ap)) {
+    enqueue(EV_DISCONNECTED, ap->association_failure_reason);
+    return;
+  }
+  enqueue(EV_CONNECTED);
+  enqueue(EV_GOT_IP);
+}
+
+bool SimulatedInterface::associationFails(const AccessPoint& ap) {
+  if (ap.association_failure_rate <= 0) return false;
+  // Uses the raw generator output (rather than a distribution), so that the
+  // sequence is the same on all platforms.
+  return rng_() < ap.association_failure_rate * 4294967296.0;
+}
+
+ConnectionStatus SimulatedInterface::getStatus() { return status_; }
+
+bool SimulatedInterface::getScanResults(std::vector<NetworkDetails>* list,
+                                        int max_count) const {
+  if (!scan_completed_) return false;
+  list->clear();
+  int count = scan_results_.size();
+  if (max_count < count) count = max_count;
+  list->insert(list->end(), scan_results_.begin(),
+               scan_results_.begin() + count);
+  return true;
+}
+
+bool SimulatedInterface::forEachScanResult(ScanResultVisitor& visitor) const {
+  if (!scan_completed_) return false;
+  for (const NetworkDetails& result : scan_results_) {
+    if (!visitor.visit(result)) break;
+  }
+  return true;
+}
+
+Interface::RssiMonitoring SimulatedInterface::rssiMonitoring() const {
+  return RSSI_MONITORING_BAND;
+}
+
+void SimulatedInterface::setRssiBand(int8_t low, int8_t high) {
+  rssi_band_armed_ = true;
+  rssi_band_low_ = low;
+  rssi_band_high_ = high;
+  if (!rssi_poll_.is_scheduled()) {
+    rssi_poll_.scheduleAfter(roo_time::Seconds(1));
+  }
+  checkRssiBand();
+}
+
+void SimulatedInterface::checkRssiBand() {
+  if (!rssi_band_armed_) return;
+  int8_t rssi;
+  if (!getRssi(&rssi)) return;
+  if (rssi >= rssi_band_low_ && rssi <= rssi_band_high_) return;
+  rssi_band_armed_ = false;
+  rssi_poll_.cancel();
+  enqueue(EV_RSSI_CHANGED);
+}
+
+const SimulatedInterface::AccessPoint* SimulatedInterface::findStrongest(
+    roo::string_view ssid) const {
+  const AccessPoint* result = nullptr;
+  for (const AccessPoint& ap : access_points_) {
+    if (roo::string_view((const char*)ap.details.ssid) != ssid) continue;
+    if (result == nullptr || ap.details.rssi > result->details.rssi) {
+      result = &ap;
+    }
+  }
+  return result;
+}
+
+const SimulatedInterface::AccessPoint* SimulatedInterface::findByBssid(
+    roo::string_view ssid, const uint8_t* bssid) const {
+  for (const AccessPoint& ap : access_points_) {
+    if (memcmp(ap.details.bssid, bssid, 6) == 0 &&
+        roo::string_view((const char*)ap.details.ssid) == ssid) {
+      return &ap;
+    }
+  }
+  return nullptr;
+}
+
+void SimulatedInterface::enqueue(EventType type, uint16_t reason) {
+  pending_.push_back(
+      PendingEvent{roo_time::Uptime::Now() + event_latency_, type, reason});
+  scheduleDelivery();
+}
+
+void SimulatedInterface::scheduleDelivery() {
+  if (pending_.empty() || delivery_.is_scheduled()) return;
+  roo_time::Duration delay = pending_.front().due - roo_time::Uptime::Now();
+  if (delay < roo_time::Millis(0)) delay = roo_time::Millis(0);
+  delivery_.scheduleAfter(delay);
+}
+
+void SimulatedInterface::deliverDueEvents() {
+  roo_time::Uptime now = roo_time::Uptime::Now();
+  while (!pending_.empty() && pending_.front().due <= now) {
+    PendingEvent event = pending_.front();
+    pending_.pop_front();
+    apply(event.type);
+    notify(event.type, event.reason);
+  }
+  scheduleDelivery();
+}
+
+void SimulatedInterface::apply(EventType type) {
+  switch (type) {
+    case EV_CONNECTED: {
+      status_ = WL_IDLE_STATUS;
+      break;
+    }
+    case EV_GOT_IP: {
+      status_ = WL_CONNECTED;
+      break;
+    }
+    case EV_DISCONNECTED: {
+      has_target_ = false;
+      bumpApGeneration();
+      rssi_band_armed_ = false;
+      if (status_ != WL_NO_SSID_AVAIL) status_ = WL_DISCONNECTED;
+      break;
+    }
+    case EV_CONNECTION_LOST: {
+      has_target_ = false;
+      bumpApGeneration();
+      rssi_band_armed_ = false;
+      status_ = WL_CONNECTION_LOST;
+      break;
+    }
+    case EV_CONNECTION_FAILED: {
+      has_target_ = false;
+      bumpApGeneration();
+      rssi_band_armed_ = false;
+      status_ = WL_CONNECT_FAILED;
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+void SimulatedInterface::notify(EventType type, uint16_t reason) {
+  Event event{type, reason};
+  for (const auto& l : listeners_) {
+    l->handleEvent(event);
+  }
+}
+
+}  // namespace roo_wifi
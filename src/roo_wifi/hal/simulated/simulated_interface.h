@@ -0,0 +1,207 @@
+#pragma once
+
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_collections/flat_small_hash_set.h"
+#include "roo_scheduler.h"
+#include "roo_wifi/hal/interface.h"
+
+namespace roo_wifi {
+
+/// Scriptable, host-side implementation of the Wi-Fi interface.
+///
+/// Simulates a radio environment consisting of a configurable population of
+/// access points. Scans complete after a configurable duration, and
+/// connection events are delivered after a configurable latency, via the
+/// scheduler, so that they arrive asynchronously (like they do on real
+/// hardware). Tests and benchmarks can also complete scans and inject events
+/// synchronously.
+class SimulatedInterface final : public Interface {
+ public:
+  /// A simulated access point.
+  struct AccessPoint {
+    NetworkDetails details;
+
+    /// Password required to associate. Ignored for open networks.
+    std::string password;
+
+    /// Fraction of association attempts that fail (with EV_DISCONNECTED)
+    /// even though the credentials are right, e.g. because the AP is
+    /// overloaded. See setRandomSeed().
+    float association_failure_rate;
+
+    /// Disconnect reason reported by failed associations. Defaults to
+    /// REASON_ASSOC_FAIL.
+    uint16_t association_failure_reason;
+  };
+
+  SimulatedInterface(roo_scheduler::Scheduler& scheduler);
+
+  /// Sets how long it takes for a started full scan, with the default dwell
+  /// time, to complete automatically. Other scans take proportionally as
+  /// long, per the number of channels and the dwell time.
+  void setScanDuration(roo_time::Duration duration) {
+    scan_duration_ = duration;
+  }
+
+  /// Sets the delay between an action (e.g. connect) and the delivery of the
+  /// resulting events.
+  void setEventLatency(roo_time::Duration latency) { event_latency_ = latency; }
+
+  /// Seeds the pseudo-random sequence that decides which association
+  /// attempts fail (see AccessPoint::association_failure_rate).
+  void setRandomSeed(uint32_t seed) { rng_.seed(seed); }
+
+  /// Adds an access point to the simulated environment. Returns its index.
+  int addAccessPoint(roo::string_view ssid, int8_t rssi,
+                     AuthMode authmode = WIFI_AUTH_WPA2_PSK,
+                     roo::string_view password = "", uint8_t channel = 1);
+
+  /// Returns the number of access points in the simulated environment.
+  int accessPointCount() const { return access_points_.size(); }
+
+  /// Returns the access point at the specified index, e.g. to change its
+  /// signal strength.
+  AccessPoint& accessPoint(int idx) { return access_points_[idx]; }
+
+  /// Changes the signal strength of the access point at the specified index,
+  /// triggering EV_RSSI_CHANGED if it is the current AP and the signal leaves
+  /// the band set via setRssiBand(). (Changes made directly via
+  /// accessPoint() are picked up by a fallback poll, every second.)
+  void setAccessPointRssi(int idx, int8_t rssi);
+
+  /// Removes the access point at the specified index. If it is the AP that
+  /// the interface is associated with, the connection is lost.
+  void removeAccessPoint(int idx);
+
+  /// Removes all access points (without affecting the connection).
+  void clearAccessPoints();
+
+  /// Completes the pending scan immediately, capturing the current access
+  /// point population (on the scanned channels), and synchronously notifies
+  /// listeners.
+  void completeScan();
+
+  /// Synchronously delivers the specified event (with the specified
+  /// disconnect reason) to listeners, applying its effect on the simulated
+  /// connection state.
+  void emitEvent(EventType type, uint16_t reason = 0);
+
+  /// Returns the number of scans started so far.
+  int scanCount() const { return scan_count_; }
+
+  /// Returns the number of scans started so far that were limited to some
+  /// channels, or to an SSID.
+  int partialScanCount() const { return partial_scan_count_; }
+
+  /// Returns the total time spent scanning so far (i.e. off the home
+  /// channel).
+  roo_time::Duration scanTime() const { return scan_time_; }
+
+  /// Returns the number of connection attempts so far.
+  int connectCount() const { return connect_count_; }
+
+  /// Returns the number of connection attempts that used a hint.
+  int hintedConnectCount() const { return hinted_connect_count_; }
+
+  /// Returns the number of getApInfo() calls so far.
+  int apInfoCount() const { return ap_info_count_; }
+
+  // Interface implementation.
+
+  void addEventListener(EventListener* listener) override;
+  void removeEventListener(EventListener* listener) override;
+  bool getApInfo(NetworkDetails* info) const override;
+  bool getRssi(int8_t* rssi) const override;
+  bool getChannel(uint8_t* channel) const override;
+  bool getBssid(uint8_t bssid[6]) const override;
+  uint32_t apGeneration() const override { return ap_generation_; }
+  bool startScan() override;
+  bool startScan(const ScanOptions& options) override;
+  bool scanCompleted() const override;
+  void disconnect() override;
+  bool connect(const std::string& ssid, const std::string& passwd) override;
+  bool connect(const std::string& ssid, const std::string& passwd,
+               const ConnectionHint& hint) override;
+  ConnectionStatus getStatus() override;
+  bool getScanResults(std::vector<NetworkDetails>* list,
+                      int max_count) const override;
+  bool forEachScanResult(ScanResultVisitor& visitor) const override;
+  bool deliversEventsOnSchedulerThread() const override { return true; }
+  RssiMonitoring rssiMonitoring() const override;
+  void setRssiBand(int8_t low, int8_t high) override;
+
+ private:
+  struct PendingEvent {
+    roo_time::Uptime due;
+    EventType type;
+    uint16_t reason;
+  };
+
+  const AccessPoint* findStrongest(roo::string_view ssid) const;
+  const AccessPoint* findByBssid(roo::string_view ssid,
+                                 const uint8_t* bssid) const;
+
+  // Starts association with the specified AP (nullptr if not found).
+  void associate(const AccessPoint* ap, const std::string& passwd);
+
+  // Returns true if getApInfo() and friends report the target AP.
+  bool associated() const;
+
+  // Returns the current signal strength of the target AP.
+  int8_t targetRssi() const;
+
+  // Returns true if the specified association attempt should fail.
+  bool associationFails(const AccessPoint& ap);
+
+  void bumpApGeneration();
+
+  void enqueue(EventType type, uint16_t reason = 0);
+  void deliverDueEvents();
+  void scheduleDelivery();
+  void apply(EventType type);
+  void checkRssiBand();
+  void notify(EventType type, uint16_t reason = 0);
+
+  roo_time::Duration scan_duration_;
+  roo_time::Duration event_latency_;
+
+  std::vector<AccessPoint> access_points_;
+  std::vector<NetworkDetails> scan_results_;
+  ScanOptions scan_options_;
+  bool scanning_;
+  bool scan_completed_;
+
+  // The AP that we're associating with or are associated with.
+  bool has_target_;
+  NetworkDetails target_;
+  ConnectionStatus status_;
+  uint32_t ap_generation_;
+
+  bool rssi_band_armed_;
+  int8_t rssi_band_low_;
+  int8_t rssi_band_high_;
+
+  std::deque<PendingEvent> pending_;
+  roo_collections::FlatSmallHashSet<EventListener*> listeners_;
+
+  int scan_count_;
+  int partial_scan_count_;
+  roo_time::Duration scan_time_;
+  int connect_count_;
+  int hinted_connect_count_;
+  mutable int ap_info_count_;
+  uint32_t next_bssid_;
+  std::mt19937 rng_;
+
+  roo_scheduler::SingletonTask scan_timer_;
+  roo_scheduler::SingletonTask delivery_;
+  roo_scheduler::SingletonTask rssi_poll_;
+};
+
+}  // namespace roo_wifi
@@ -0,0 +1,114 @@
+#include "roo_wifi/hal/simulated/simulation.h"
+
+#ifdef ROO_TESTING
+
+#include <algorithm>
+
+namespace roo_wifi {
+
+roo_time::Duration Simulation::Report::meanTimeToConnect() const {
+  if (connections == 0) return roo_time::Millis(0);
+  return roo_time::Micros(total_time_to_connect.inMicros() / connections);
+}
+
+double Simulation::Report::availability() const {
+  if (elapsed.inMicros() <= 0) return 0;
+  return 1.0 - (double)downtime.inMicros() / elapsed.inMicros();
+}
+
+Simulation::Simulation(uint32_t seed)
+    : clock_(),
+      scheduler_(),
+      interface_(scheduler_),
+      store_(),
+      environment_(scheduler_, interface_, seed),
+      controller_(store_, interface_, scheduler_),
+      connected_(false),
+      state_since_(roo_time::Uptime::Now()),
+      report_(),
+      report_since_(roo_time::Uptime::Now()),
+      coverage_baseline_(roo_time::Millis(0)),
+      scan_baseline_(0),
+      scan_time_baseline_(roo_time::Millis(0)),
+      connect_baseline_(0),
+      monitor_(*this) {
+  // Use a different (but still reproducible) sequence for association
+  // failures than for the environment.
+  interface_.setRandomSeed(seed ^ 0x5EED5EED);
+  controller_.setRandomSeed(seed);
+  store_.setIsInterfaceEnabled(true);
+  controller_.setAutoJoin(true);
+  controller_.addListener(&monitor_, Controller::INTEREST_CONNECTION_STATE);
+}
+
+Simulation::~Simulation() { controller_.removeListener(&monitor_); }
+
+void Simulation::begin() {
+  resetReport();
+  controller_.begin();
+  controller_.resume();
+  environment_.start();
+}
+
+void Simulation::runFor(roo_time::Duration duration) {
+  roo_time::Uptime end = clock_.now() + duration;
+  while (true) {
+    while (scheduler_.executeEligibleTasks()) {
+    }
+    roo_time::Uptime next = scheduler_.getNearestExecutionTime();
+    if (next > end) break;
+    clock_.advanceTo(next);
+  }
+  clock_.advanceTo(end);
+}
+
+Simulation::Report Simulation::report() const {
+  Report report = report_;
+  roo_time::Uptime now = roo_time::Uptime::Now();
+  report.elapsed = now - report_since_;
+  if (!connected_) {
+    report.downtime += now - std::max(state_since_, report_since_);
+  }
+  report.time_without_coverage =
+      environment_.timeWithoutCoverage() - coverage_baseline_;
+  report.scans = interface_.scanCount() - scan_baseline_;
+  report.scan_time = interface_.scanTime() - scan_time_baseline_;
+  report.connect_attempts = interface_.connectCount() - connect_baseline_;
+  return report;
+}
+
+void Simulation::resetReport() {
+  report_ = Report();
+  report_.downtime = roo_time::Millis(0);
+  report_.connections = 0;
+  report_.disconnections = 0;
+  report_.total_time_to_connect = roo_time::Millis(0);
+  report_.max_time_to_connect = roo_time::Millis(0);
+  report_since_ = roo_time::Uptime::Now();
+  coverage_baseline_ = environment_.timeWithoutCoverage();
+  scan_baseline_ = interface_.scanCount();
+  scan_time_baseline_ = interface_.scanTime();
+  connect_baseline_ = interface_.connectCount();
+}
+
+void Simulation::onConnectionStateChanged() {
+  bool connected = controller_.currentNetworkStatus() == WL_CONNECTED;
+  if (connected == connected_) return;
+  roo_time::Uptime now = roo_time::Uptime::Now();
+  if (connected) {
+    report_.downtime += now - std::max(state_since_, report_since_);
+    roo_time::Duration time_to_connect = now - state_since_;
+    ++report_.connections;
+    report_.total_time_to_connect += time_to_connect;
+    report_.max_time_to_connect =
+        std::max(report_.max_time_to_connect, time_to_connect);
+  } else {
+    ++report_.disconnections;
+  }
+  connected_ = connected;
+  state_since_ = now;
+}
+
+}  // namespace roo_wifi
+
+#endif  // ROO_TESTING
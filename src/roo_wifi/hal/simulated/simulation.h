@@ -0,0 +1,136 @@
+#pragma once
+
+#ifdef ROO_TESTING
+
+#include "roo_scheduler.h"
+#include "roo_wifi/controller.h"
+#include "roo_wifi/hal/simulated/in_memory_store.h"
+#include "roo_wifi/hal/simulated/rf_environment.h"
+#include "roo_wifi/hal/simulated/simulated_interface.h"
+#include "roo_wifi/hal/simulated/virtual_clock.h"
+
+namespace roo_wifi {
+
+/// Runs a Controller against a simulated radio environment, in virtual time,
+/// and measures how well it keeps the device connected. Meant for comparing
+/// scanning and reconnection policies numerically: runs are deterministic for
+/// a given seed, and cover days of device time in well under a second.
+///
+/// Usage:
+///
+///   Simulation sim(seed);
+///   RfEnvironment::Site home("home", "secret", -60);
+///   home.mean_uptime = roo_time::Hours(4);
+///   home.mean_downtime = roo_time::Minutes(2);
+///   sim.environment().addSite(home);
+///   sim.controller().setPassword("home", "secret");
+///   sim.begin();
+///   sim.runFor(roo_time::Hours(24 * 30));
+///   Simulation::Report report = sim.report();
+///
+/// Only available in host builds (ROO_TESTING).
+class Simulation {
+ public:
+  /// Connectivity figures, since begin() (or the last resetReport()).
+  struct Report {
+    /// Simulated time covered by the report.
+    roo_time::Duration elapsed;
+
+    /// Time spent not connected (i.e. without an IP address).
+    roo_time::Duration downtime;
+
+    /// Part of the downtime during which no AP was up at all.
+    roo_time::Duration time_without_coverage;
+
+    /// Number of times that the connection was established.
+    uint32_t connections;
+
+    /// Number of times that an established connection was lost.
+    uint32_t disconnections;
+
+    /// Time from losing the connection (or from begin()) to getting it back,
+    /// summed over all connections, and the longest one.
+    roo_time::Duration total_time_to_connect;
+    roo_time::Duration max_time_to_connect;
+
+    /// Number of scans, and connection attempts, issued to the interface.
+    uint32_t scans;
+    uint32_t connect_attempts;
+
+    /// Time spent scanning.
+    roo_time::Duration scan_time;
+
+    /// Returns the average time to (re)connect.
+    roo_time::Duration meanTimeToConnect() const;
+
+    /// Returns the fraction of time spent connected.
+    double availability() const;
+  };
+
+  Simulation(uint32_t seed = 1);
+  ~Simulation();
+
+  VirtualClock& clock() { return clock_; }
+  roo_scheduler::Scheduler& scheduler() { return scheduler_; }
+  SimulatedInterface& interface() { return interface_; }
+  InMemoryStore& store() { return store_; }
+  RfEnvironment& environment() { return environment_; }
+
+  /// The controller under test. Wi-Fi is initially enabled, and so is
+  /// auto-join, since it is how the controller reconnects without user
+  /// interaction.
+  Controller& controller() { return controller_; }
+
+  /// Starts the controller (like an application would: begin(), then
+  /// resume()), and the environment.
+  void begin();
+
+  /// Runs the simulation for the specified (virtual) duration, executing
+  /// scheduled tasks in order, and skipping over idle time.
+  void runFor(roo_time::Duration duration);
+
+  /// Returns the figures collected so far.
+  Report report() const;
+
+  /// Restarts collection of the figures, e.g. after a warm-up period.
+  void resetReport();
+
+ private:
+  class Monitor : public Controller::Listener {
+   public:
+    Monitor(Simulation& simulation) : simulation_(simulation) {}
+
+    void onConnectionStateChanged(Interface::EventType /*type*/) override {
+      simulation_.onConnectionStateChanged();
+    }
+
+   private:
+    Simulation& simulation_;
+  };
+
+  void onConnectionStateChanged();
+
+  VirtualClock clock_;
+  roo_scheduler::Scheduler scheduler_;
+  SimulatedInterface interface_;
+  InMemoryStore store_;
+  RfEnvironment environment_;
+  Controller controller_;
+
+  // Tracks the connection state.
+  bool connected_;
+  roo_time::Uptime state_since_;
+
+  Report report_;
+  roo_time::Uptime report_since_;
+  roo_time::Duration coverage_baseline_;
+  int scan_baseline_;
+  roo_time::Duration scan_time_baseline_;
+  int connect_baseline_;
+
+  Monitor monitor_;
+};
+
+}  // namespace roo_wifi
+
+#endif  // ROO_TESTING
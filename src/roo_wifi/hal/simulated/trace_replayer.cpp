@@ -0,0 +1,257 @@
+#include "roo_wifi/hal/simulated/trace_replayer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace roo_wifi {
+
+namespace {
+
+NetworkDetails MakeNetwork(const std::string& ssid, int8_t rssi, bool open) {
+  NetworkDetails details;
+  memset(&details, 0, sizeof(details));
+  size_t len = std::min<size_t>(ssid.size(), 32);
+  memcpy(details.ssid, ssid.data(), len);
+  details.rssi = rssi;
+  details.authmode = open ? WIFI_AUTH_OPEN : WIFI_AUTH_WPA2_PSK;
+  return details;
+}
+
+// Whether the record is an input to the controller (an API call or an
+// interface event), as opposed to a reading of the interface state.
+bool IsInput(const TraceRecord& record) {
+  return record.kind != TRACE_EVENTS_DROPPED && record.kind != TRACE_SCAN &&
+         record.kind != TRACE_RSSI;
+}
+
+}  // namespace
+
+ReplayInterface::ReplayInterface()
+    : listeners_(),
+      scan_results_(),
+      scan_completed_(false),
+      ssid_(),
+      open_(false),
+      rssi_(-128),
+      associated_(false),
+      status_(WL_DISCONNECTED),
+      ap_generation_(1) {}
+
+void ReplayInterface::fire(const Event& event) {
+  switch (event.type) {
+    case EV_CONNECTED: {
+      associated_ = true;
+      status_ = WL_IDLE_STATUS;
+      ++ap_generation_;
+      break;
+    }
+    case EV_GOT_IP: {
+      associated_ = true;
+      status_ = WL_CONNECTED;
+      break;
+    }
+    case EV_DISCONNECTED:
+    case EV_CONNECTION_FAILED:
+    case EV_CONNECTION_LOST: {
+      associated_ = false;
+      status_ = (event.type == EV_DISCONNECTED)        ? WL_DISCONNECTED
+                : (event.type == EV_CONNECTION_FAILED) ? WL_CONNECT_FAILED
+                                                       : WL_CONNECTION_LOST;
+      ++ap_generation_;
+      break;
+    }
+    case EV_SCAN_COMPLETED: {
+      scan_completed_ = true;
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+  for (EventListener* l : listeners_) {
+    l->handleEvent(event);
+  }
+}
+
+void ReplayInterface::setScanResults(const TraceRecord& summary) {
+  scan_results_.clear();
+  int listed = summary.a;
+  if (summary.c != 0) {
+    scan_results_.push_back(MakeNetwork(TraceReplayer::SsidFor(summary.c),
+                                        (int8_t)(summary.d & 0xFF),
+                                        (summary.d & 0x100) != 0));
+    --listed;
+  }
+  for (int i = 0; i < listed; ++i) {
+    char ssid[33];
+    snprintf(ssid, sizeof(ssid), "filler-%d", i);
+    scan_results_.push_back(MakeNetwork(ssid, -95, false));
+  }
+  // The remaining raw results are weaker duplicates.
+  while (!scan_results_.empty() && scan_results_.size() < summary.b) {
+    NetworkDetails duplicate = scan_results_.back();
+    duplicate.rssi = -100;
+    scan_results_.push_back(duplicate);
+  }
+}
+
+void ReplayInterface::addEventListener(EventListener* listener) {
+  listeners_.insert(listener);
+}
+
+void ReplayInterface::removeEventListener(EventListener* listener) {
+  listeners_.erase(listener);
+}
+
+bool ReplayInterface::getApInfo(NetworkDetails* info) const {
+  if (!associated_) return false;
+  *info = MakeNetwork(ssid_, rssi_, open_);
+  info->status = status_;
+  return true;
+}
+
+bool ReplayInterface::startScan() {
+  scan_completed_ = false;
+  return true;
+}
+
+void ReplayInterface::disconnect() {
+  associated_ = false;
+  status_ = WL_DISCONNECTED;
+  ++ap_generation_;
+}
+
+bool ReplayInterface::connect(const std::string& ssid,
+                              const std::string& passwd) {
+  ssid_ = ssid;
+  open_ = passwd.empty();
+  associated_ = false;
+  status_ = WL_DISCONNECTED;
+  ++ap_generation_;
+  return true;
+}
+
+bool ReplayInterface::getScanResults(std::vector<NetworkDetails>* list,
+                                     int max_count) const {
+  size_t count = std::min<size_t>(scan_results_.size(), max_count);
+  list->assign(scan_results_.begin(), scan_results_.begin() + count);
+  return true;
+}
+
+bool ReplayInterface::forEachScanResult(ScanResultVisitor& visitor) const {
+  for (const NetworkDetails& result : scan_results_) {
+    if (!visitor.visit(result)) break;
+  }
+  return true;
+}
+
+TraceReplayer::TraceReplayer(roo_scheduler::Scheduler& scheduler,
+                             ReplayInterface& interface, InMemoryStore& store,
+                             Controller& controller,
+                             const std::vector<TraceRecord>& trace)
+    : scheduler_(scheduler),
+      interface_(interface),
+      store_(store),
+      controller_(controller),
+      trace_(trace),
+      position_(0) {}
+
+std::string TraceReplayer::SsidFor(uint32_t hash) {
+  char ssid[16];
+  snprintf(ssid, sizeof(ssid), "ssid-%08" PRIx32, hash);
+  return ssid;
+}
+
+bool TraceReplayer::step() {
+  if (position_ >= trace_.size()) return false;
+  if (position_ == 0 && trace_[0].kind != TRACE_BEGIN) {
+    // The trace has wrapped; we only know that the interface was in use.
+    store_.setIsInterfaceEnabled(true);
+    controller_.begin();
+    runPending();
+  }
+  if (IsInput(trace_[position_])) preloadState(position_);
+  apply(trace_[position_++]);
+  runPending();
+  return true;
+}
+
+void TraceReplayer::preloadState(size_t idx) {
+  for (++idx; idx < trace_.size() && !IsInput(trace_[idx]); ++idx) {
+    const TraceRecord& record = trace_[idx];
+    if (record.kind == TRACE_SCAN) {
+      interface_.setScanResults(record);
+    } else if (record.kind == TRACE_RSSI) {
+      interface_.setRssi((int8_t)record.a);
+    }
+  }
+}
+
+void TraceReplayer::apply(const TraceRecord& record) {
+  switch (record.kind) {
+    case TRACE_EVENT: {
+      interface_.fire(
+          Interface::Event{(Interface::EventType)record.a, record.b});
+      break;
+    }
+    case TRACE_SCAN: {
+      interface_.setScanResults(record);
+      break;
+    }
+    case TRACE_RSSI: {
+      // Possibly read by a periodic refresh, which does not happen on its
+      // own during replay.
+      interface_.setRssi((int8_t)record.a);
+      controller_.refreshCurrentNetwork();
+      break;
+    }
+    case TRACE_BEGIN: {
+      store_.setIsInterfaceEnabled(record.a != 0);
+      if (record.c != 0) {
+        std::string ssid = SsidFor(record.c);
+        store_.setDefaultSSID(ssid);
+        store_.setPassword(ssid, "password");
+      }
+      controller_.begin();
+      break;
+    }
+    case TRACE_TOGGLE_ENABLED: {
+      if (controller_.isEnabled() != (record.a != 0)) {
+        controller_.toggleEnabled();
+      }
+      break;
+    }
+    case TRACE_START_SCAN: {
+      controller_.startScan();
+      break;
+    }
+    case TRACE_CONNECT: {
+      if (record.a & 2) {
+        controller_.connect();
+      } else {
+        controller_.connect(SsidFor(record.c),
+                            (record.a & 1) ? "" : "password");
+      }
+      break;
+    }
+    case TRACE_DISCONNECT: {
+      controller_.disconnect();
+      break;
+    }
+    case TRACE_FORGET: {
+      controller_.forget(SsidFor(record.c));
+      break;
+    }
+    default: {
+      // TRACE_EVENTS_DROPPED, and unknown kinds: informational only.
+      break;
+    }
+  }
+}
+
+void TraceReplayer::runPending() {
+  while (scheduler_.executeEligibleTasks()) {
+  }
+}
+
+}  // namespace roo_wifi
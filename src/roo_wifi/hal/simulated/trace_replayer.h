@@ -0,0 +1,112 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "roo_scheduler.h"
+#include "roo_wifi/controller.h"
+#include "roo_wifi/hal/interface.h"
+#include "roo_wifi/hal/simulated/in_memory_store.h"
+#include "roo_wifi/trace.h"
+
+namespace roo_wifi {
+
+/// Stand-in interface, whose state is driven by a trace rather than by a
+/// radio. Scan results are synthesized from the recorded scan summaries:
+/// the current network (if it was listed), plus filler networks.
+class ReplayInterface : public Interface {
+ public:
+  ReplayInterface();
+
+  /// Delivers the event to the listeners, applying its effect on the
+  /// simulated connection state first.
+  void fire(const Event& event);
+
+  /// Replaces the scan results with ones that match the summary (see
+  /// TRACE_SCAN).
+  void setScanResults(const TraceRecord& summary);
+
+  /// Sets the signal strength of the current network.
+  void setRssi(int8_t rssi) { rssi_ = rssi; }
+
+  // Interface implementation.
+
+  void addEventListener(EventListener* listener) override;
+  void removeEventListener(EventListener* listener) override;
+  bool getApInfo(NetworkDetails* info) const override;
+  uint32_t apGeneration() const override { return ap_generation_; }
+  bool startScan() override;
+  bool scanCompleted() const override { return scan_completed_; }
+  void disconnect() override;
+  bool connect(const std::string& ssid, const std::string& passwd) override;
+  ConnectionStatus getStatus() override { return status_; }
+  bool getScanResults(std::vector<NetworkDetails>* list,
+                      int max_count) const override;
+  bool forEachScanResult(ScanResultVisitor& visitor) const override;
+  bool deliversEventsOnSchedulerThread() const override { return true; }
+
+ private:
+  std::set<EventListener*> listeners_;
+  std::vector<NetworkDetails> scan_results_;
+  bool scan_completed_;
+  std::string ssid_;
+  bool open_;
+  int8_t rssi_;
+  bool associated_;
+  ConnectionStatus status_;
+  uint32_t ap_generation_;
+};
+
+/// Feeds a trace (see TraceRecorder) back into a controller, re-creating the
+/// recorded sequence of API calls and interface events, so that it can be
+/// re-run on the host: debugged, profiled, or turned into a regression test.
+///
+/// SSIDs are only known by their hashes; they get replaced by synthetic
+/// names ("ssid-<hash>"), with "password" as the password. The store is
+/// seeded as recorded by TRACE_BEGIN. Timing is not reproduced: after each
+/// record, the controller gets to process everything that is due.
+class TraceReplayer {
+ public:
+  /// Creates a replayer of the trace, that drives the specified controller,
+  /// which must use the specified scheduler, interface and store. The trace
+  /// must outlive the replayer.
+  TraceReplayer(roo_scheduler::Scheduler& scheduler, ReplayInterface& interface,
+                InMemoryStore& store, Controller& controller,
+                const std::vector<TraceRecord>& trace);
+
+  /// Replays the next record. Returns false if there are none left. Calls
+  /// controller.begin() first, unless the trace starts with TRACE_BEGIN (as
+  /// it does if it has not wrapped).
+  bool step();
+
+  /// Replays all the remaining records.
+  void replay() {
+    while (step()) {
+    }
+  }
+
+  /// Returns the index of the next record to replay.
+  size_t position() const { return position_; }
+
+  /// Returns the synthetic SSID that stands for the specified hash.
+  static std::string SsidFor(uint32_t hash);
+
+ private:
+  // Applies the state records (scans, signal readings) that follow the
+  // input record at the specified index, so that the interface reports them
+  // while the controller processes that input.
+  void preloadState(size_t idx);
+
+  void apply(const TraceRecord& record);
+  void runPending();
+
+  roo_scheduler::Scheduler& scheduler_;
+  ReplayInterface& interface_;
+  InMemoryStore& store_;
+  Controller& controller_;
+  const std::vector<TraceRecord>& trace_;
+  size_t position_;
+};
+
+}  // namespace roo_wifi
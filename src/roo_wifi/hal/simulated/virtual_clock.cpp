@@ -0,0 +1,24 @@
+#include "roo_wifi/hal/simulated/virtual_clock.h"
+
+#ifdef ROO_TESTING
+
+#include "roo_testing/system/timer.h"
+
+namespace roo_wifi {
+
+VirtualClock::VirtualClock() { system_time_set_auto_sync(false); }
+
+VirtualClock::~VirtualClock() { system_time_set_auto_sync(true); }
+
+void VirtualClock::advance(roo_time::Duration duration) {
+  if (duration.inMicros() <= 0) return;
+  system_time_delay_micros(duration.inMicros());
+}
+
+void VirtualClock::advanceTo(roo_time::Uptime when) {
+  advance(when - now());
+}
+
+}  // namespace roo_wifi
+
+#endif  // ROO_TESTING
@@ -0,0 +1,37 @@
+#pragma once
+
+#ifdef ROO_TESTING
+
+#include "roo_time.h"
+
+namespace roo_wifi {
+
+/// Takes over the (emulated) system clock for the lifetime of the object, so
+/// that roo_time::Uptime::Now(), and therefore the scheduler, only move
+/// forward when told to. Lets simulations cover hours of device time in
+/// milliseconds, deterministically.
+///
+/// Only available in host builds (ROO_TESTING). At most one instance may
+/// exist at a time.
+class VirtualClock {
+ public:
+  VirtualClock();
+  ~VirtualClock();
+
+  VirtualClock(const VirtualClock&) = delete;
+  VirtualClock& operator=(const VirtualClock&) = delete;
+
+  /// Returns the current (virtual) time.
+  roo_time::Uptime now() const { return roo_time::Uptime::Now(); }
+
+  /// Moves the clock forward by the specified duration.
+  void advance(roo_time::Duration duration);
+
+  /// Moves the clock forward to the specified time. Does nothing if it is
+  /// already past it.
+  void advanceTo(roo_time::Uptime when);
+};
+
+}  // namespace roo_wifi
+
+#endif  // ROO_TESTING
@@ -0,0 +1,42 @@
+#include "roo_wifi/hal/store.h"
+
+namespace roo_wifi {
+
+namespace {
+
+class Exporter : public KnownNetworkVisitor {
+ public:
+  Exporter(std::vector<KnownNetwork>* networks) : networks_(networks) {}
+
+  bool visit(const KnownNetwork& network) override {
+    networks_->push_back(network);
+    return true;
+  }
+
+ private:
+  std::vector<KnownNetwork>* networks_;
+};
+
+}  // namespace
+
+void Store::importKnownNetworks(const std::vector<KnownNetwork>& networks) {
+  Batch batch(*this);
+  for (const KnownNetwork& network : networks) {
+    if (network.flags & KNOWN_NETWORK_PASSWORD) {
+      setPassword(network.ssid, network.password);
+    }
+    if (network.flags & KNOWN_NETWORK_HINT) {
+      setConnectionHint(network.ssid, network.hint);
+    }
+    if (network.flags & KNOWN_NETWORK_HISTORY) {
+      setConnectionHistory(network.ssid, network.history);
+    }
+  }
+}
+
+bool Store::exportKnownNetworks(std::vector<KnownNetwork>* networks) {
+  Exporter exporter(networks);
+  return forEachKnownNetwork(exporter);
+}
+
+}  // namespace roo_wifi
@@ -7,12 +7,69 @@
 
 #include "roo_backport.h"
 #include "roo_backport/string_view.h"
+#include "roo_wifi/hal/interface.h"
 
 namespace roo_wifi {
 
+/// Connection statistics of a network, used to rank auto-join candidates.
+/// Counts are aged (halved) periodically, so that they track recent behavior.
+struct ConnectionHistory {
+  uint16_t attempts;           ///< Connection attempts.
+  uint16_t successes;          ///< Attempts that obtained an IP address.
+  uint32_t avg_time_to_ip_ms;  ///< Mean time to IP of successful attempts.
+};
+
+/// Bits of KnownNetwork::flags, telling which fields are set.
+enum KnownNetworkFlags {
+  KNOWN_NETWORK_PASSWORD = 1,
+  KNOWN_NETWORK_HINT = 2,
+  KNOWN_NETWORK_HISTORY = 4,
+};
+
+/// Everything that a store knows about a network.
+struct KnownNetwork {
+  std::string ssid;
+  uint8_t flags;  ///< Combination of KnownNetworkFlags.
+  std::string password;
+  ConnectionHint hint;
+  ConnectionHistory history;
+};
+
+/// Callback for Store::forEachKnownNetwork().
+class KnownNetworkVisitor {
+ public:
+  virtual ~KnownNetworkVisitor() = default;
+
+  /// Called for each known network. Returns false to stop the iteration.
+  virtual bool visit(const KnownNetwork& network) = 0;
+};
+
+/// Groups the writes to the store issued during its lifetime into a single
+/// commit. With a concrete (final) store type, the calls to it are resolved at
+/// compile time.
+///
+/// Batches may nest; the writes are committed when the outermost batch ends.
+template <typename StoreT>
+class StoreBatch {
+ public:
+  StoreBatch(StoreT& store) : store_(store) { store_.beginBatch(); }
+  ~StoreBatch() { store_.endBatch(); }
+
+  StoreBatch(const StoreBatch&) = delete;
+  StoreBatch& operator=(const StoreBatch&) = delete;
+
+ private:
+  StoreT& store_;
+};
+
 /// Abstraction for persistently storing Wi-Fi controller data.
 class Store {
  public:
+  /// Batch of writes to any store. See StoreBatch.
+  using Batch = StoreBatch<Store>;
+
+  virtual ~Store() = default;
+
   /// Returns whether the Wi-Fi interface is enabled.
   virtual bool getIsInterfaceEnabled() = 0;
   /// Sets whether the Wi-Fi interface is enabled.
@@ -30,6 +87,54 @@ class Store {
                            roo::string_view password) = 0;
   /// Clears a stored password for an SSID.
   virtual void clearPassword(const std::string& ssid) = 0;
+
+  /// Retrieves the connection hint (BSSID and channel of the last successful
+  /// association) for an SSID. The default implementation stores no hints.
+  virtual bool getConnectionHint(const std::string& /*ssid*/,
+                                 ConnectionHint& /*hint*/) {
+    return false;
+  }
+  /// Stores the connection hint for an SSID.
+  virtual void setConnectionHint(const std::string& /*ssid*/,
+                                 const ConnectionHint& /*hint*/) {}
+  /// Clears the connection hint for an SSID.
+  virtual void clearConnectionHint(const std::string& /*ssid*/) {}
+
+  /// Retrieves the connection history of an SSID. The default
+  /// implementation stores no history.
+  virtual bool getConnectionHistory(const std::string& /*ssid*/,
+                                    ConnectionHistory& /*history*/) {
+    return false;
+  }
+  /// Stores the connection history of an SSID.
+  virtual void setConnectionHistory(const std::string& /*ssid*/,
+                                    const ConnectionHistory& /*history*/) {}
+  /// Clears the connection history of an SSID.
+  virtual void clearConnectionHistory(const std::string& /*ssid*/) {}
+
+  /// Calls the visitor for each known network, in unspecified order. Returns
+  /// false if the store does not support enumeration. The store must not be
+  /// modified during the iteration.
+  virtual bool forEachKnownNetwork(KnownNetworkVisitor& /*visitor*/) {
+    return false;
+  }
+
+  /// Stores the specified networks, replacing the fields that are set (per
+  /// flags) in the existing entries, in a single commit. Intended for bulk
+  /// provisioning.
+  virtual void importKnownNetworks(const std::vector<KnownNetwork>& networks);
+
+  /// Appends all known networks to the list. Returns false if the store does
+  /// not support enumeration.
+  bool exportKnownNetworks(std::vector<KnownNetwork>* networks);
+
+  /// Starts a batch of writes. Prefer using Batch.
+  virtual void beginBatch() {}
+  /// Ends a batch of writes, committing them if it is the outermost one.
+  virtual void endBatch() {}
+
+  /// Returns the number of commits issued to persistent storage so far.
+  virtual uint32_t commitCount() const { return 0; }
 };
 
 }  // namespace roo_wifi
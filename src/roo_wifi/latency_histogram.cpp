@@ -0,0 +1,78 @@
+#include "roo_wifi/latency_histogram.h"
+
+namespace roo_wifi {
+
+namespace {
+
+// Upper bound of the first bucket.
+constexpr uint32_t kFirstLimitMs = 16;
+
+int BucketOf(uint32_t ms) {
+  int idx = 0;
+  uint32_t limit = kFirstLimitMs;
+  while (idx < LatencyHistogram::kBuckets - 1 && ms >= limit) {
+    ++idx;
+    limit <<= 1;
+  }
+  return idx;
+}
+
+}  // namespace
+
+constexpr int LatencyHistogram::kBuckets;
+
+LatencyHistogram::LatencyHistogram() { reset(); }
+
+void LatencyHistogram::add(roo_time::Duration duration) {
+  int64_t ms = duration.inMillis();
+  if (ms < 0) ms = 0;
+  if (ms > UINT32_MAX) ms = UINT32_MAX;
+  ++buckets_[BucketOf((uint32_t)ms)];
+  if (count_ == 0 || ms < min_ms_) min_ms_ = ms;
+  if (ms > max_ms_) max_ms_ = ms;
+  sum_ms_ += ms;
+  ++count_;
+}
+
+void LatencyHistogram::reset() {
+  for (int i = 0; i < kBuckets; ++i) buckets_[i] = 0;
+  count_ = 0;
+  min_ms_ = 0;
+  max_ms_ = 0;
+  sum_ms_ = 0;
+}
+
+roo_time::Duration LatencyHistogram::bucketLimit(int idx) {
+  if (idx == kBuckets - 1) --idx;
+  return roo_time::Millis(kFirstLimitMs << idx);
+}
+
+roo_time::Duration LatencyHistogram::min() const {
+  return roo_time::Millis(min_ms_);
+}
+
+roo_time::Duration LatencyHistogram::max() const {
+  return roo_time::Millis(max_ms_);
+}
+
+roo_time::Duration LatencyHistogram::mean() const {
+  return roo_time::Millis(count_ == 0 ? 0 : sum_ms_ / count_);
+}
+
+roo_time::Duration LatencyHistogram::percentile(int p) const {
+  if (count_ == 0) return roo_time::Millis(0);
+  // The rank of the percentile, rounded up.
+  uint64_t rank = ((uint64_t)count_ * p + 99) / 100;
+  if (rank == 0) rank = 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < kBuckets - 1; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      roo_time::Duration limit = bucketLimit(i);
+      return limit < max() ? limit : max();
+    }
+  }
+  return max();
+}
+
+}  // namespace roo_wifi
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include "roo_time.h"
+
+namespace roo_wifi {
+
+/// Fixed-size histogram of durations, with millisecond resolution, and
+/// exponentially growing buckets: bucket 0 counts durations below 16 ms, and
+/// each next bucket covers twice the range of the previous one. The last
+/// bucket is unbounded. Never allocates.
+class LatencyHistogram {
+ public:
+  static constexpr int kBuckets = 12;
+
+  LatencyHistogram();
+
+  /// Records a duration. Negative durations are counted as zero.
+  void add(roo_time::Duration duration);
+
+  /// Clears all recorded durations.
+  void reset();
+
+  /// Returns the number of recorded durations.
+  uint32_t count() const { return count_; }
+
+  /// Returns the number of recorded durations that fall in the bucket.
+  uint32_t bucketCount(int idx) const { return buckets_[idx]; }
+
+  /// Returns the (exclusive) upper bound of the bucket. For the last bucket,
+  /// returns the lower bound instead.
+  static roo_time::Duration bucketLimit(int idx);
+
+  /// Returns the shortest recorded duration, or zero if none.
+  roo_time::Duration min() const;
+
+  /// Returns the longest recorded duration, or zero if none.
+  roo_time::Duration max() const;
+
+  /// Returns the mean of the recorded durations, or zero if none.
+  roo_time::Duration mean() const;
+
+  /// Returns an upper estimate of the specified percentile (0-100): the
+  /// limit of the bucket that contains it, capped at max().
+  roo_time::Duration percentile(int p) const;
+
+ private:
+  uint32_t buckets_[kBuckets];
+  uint32_t count_;
+  uint32_t min_ms_;
+  uint32_t max_ms_;
+  uint64_t sum_ms_;
+};
+
+}  // namespace roo_wifi
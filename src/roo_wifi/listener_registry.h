@@ -0,0 +1,176 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace roo_wifi {
+namespace internal {
+
+/// Set of listeners, each subscribed to a subset of (up to 16) kinds of
+/// notifications, given as a bit mask.
+///
+/// Keeps a separate dispatch list per kind, so that fan-out only touches the
+/// interested listeners. Listeners may be added and removed from within
+/// notifications: removed listeners are not notified anymore (even by the
+/// dispatch in progress), and added listeners start receiving notifications
+/// once all dispatches in progress have finished.
+///
+/// Usage:
+///
+///   for (Listener* l : registry.of(kSomeKind)) {
+///     l->onSomething();
+///   }
+template <typename ListenerT>
+class ListenerRegistry {
+ public:
+  static constexpr int kMaxKinds = 16;
+
+  class Range;
+
+  ListenerRegistry() : lists_(), pending_(), depth_(0), dirty_(false) {}
+
+  /// Subscribes the listener to the kinds of notifications in the mask. If
+  /// the listener is already registered, replaces its mask.
+  void add(ListenerT* listener, uint16_t mask) {
+    if (depth_ > 0) {
+      dropPending(listener);
+      pending_.push_back(Pending{listener, mask});
+      return;
+    }
+    erase(listener);
+    for (int kind = 0; kind < kMaxKinds; ++kind) {
+      if (mask & (1 << kind)) lists_[kind].push_back(listener);
+    }
+  }
+
+  /// Unsubscribes the listener from all notifications.
+  void remove(ListenerT* listener) {
+    dropPending(listener);
+    if (depth_ > 0) {
+      // Keep the lists stable for the dispatches in progress.
+      for (auto& list : lists_) {
+        std::replace(list.begin(), list.end(), listener, (ListenerT*)nullptr);
+      }
+      dirty_ = true;
+      return;
+    }
+    erase(listener);
+  }
+
+  /// Returns the number of listeners subscribed to the specified kind
+  /// (given as a single-bit mask).
+  size_t count(uint16_t kind) const {
+    const std::vector<ListenerT*>& list = lists_[index(kind)];
+    return list.size() - std::count(list.begin(), list.end(), nullptr);
+  }
+
+  /// Returns the listeners subscribed to the specified kind (given as a
+  /// single-bit mask), for iteration.
+  Range of(uint16_t kind) { return Range(*this, lists_[index(kind)]); }
+
+  /// Iterable view of a dispatch list, which defers structural changes to
+  /// the registry until it is destroyed.
+  class Range {
+   public:
+    class Iterator {
+     public:
+      Iterator(const std::vector<ListenerT*>& list, size_t pos)
+          : list_(list), pos_(pos) {
+        skipRemoved();
+      }
+
+      ListenerT* const& operator*() const { return list_[pos_]; }
+
+      Iterator& operator++() {
+        ++pos_;
+        skipRemoved();
+        return *this;
+      }
+
+      bool operator!=(const Iterator& other) const {
+        return pos_ != other.pos_;
+      }
+
+     private:
+      void skipRemoved() {
+        while (pos_ < list_.size() && list_[pos_] == nullptr) ++pos_;
+      }
+
+      const std::vector<ListenerT*>& list_;
+      size_t pos_;
+    };
+
+    Range(ListenerRegistry& registry, const std::vector<ListenerT*>& list)
+        : registry_(registry), list_(list), size_(list.size()) {
+      ++registry_.depth_;
+    }
+
+    Range(Range&& other)
+        : registry_(other.registry_), list_(other.list_), size_(other.size_) {
+      ++registry_.depth_;
+    }
+
+    ~Range() {
+      if (--registry_.depth_ == 0) registry_.applyPending();
+    }
+
+    Iterator begin() const { return Iterator(list_, 0); }
+    Iterator end() const { return Iterator(list_, size_); }
+
+   private:
+    ListenerRegistry& registry_;
+    const std::vector<ListenerT*>& list_;
+    size_t size_;
+  };
+
+ private:
+  struct Pending {
+    ListenerT* listener;
+    uint16_t mask;
+  };
+
+  static int index(uint16_t kind) {
+    int idx = 0;
+    while (kind > 1) {
+      kind >>= 1;
+      ++idx;
+    }
+    return idx;
+  }
+
+  void erase(ListenerT* listener) {
+    for (auto& list : lists_) {
+      list.erase(std::remove(list.begin(), list.end(), listener), list.end());
+    }
+  }
+
+  void dropPending(ListenerT* listener) {
+    for (size_t i = 0; i < pending_.size(); ++i) {
+      if (pending_[i].listener == listener) {
+        pending_.erase(pending_.begin() + i);
+        return;
+      }
+    }
+  }
+
+  void applyPending() {
+    if (dirty_) {
+      dirty_ = false;
+      erase(nullptr);
+    }
+    // Note: add() may not re-enter here, since depth_ is zero.
+    for (const Pending& p : pending_) add(p.listener, p.mask);
+    pending_.clear();
+  }
+
+  std::vector<ListenerT*> lists_[kMaxKinds];
+  std::vector<Pending> pending_;
+  int depth_;
+  bool dirty_;
+};
+
+}  // namespace internal
+}  // namespace roo_wifi
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace roo_wifi {
+namespace internal {
+
+/// Bounded, lock-free queue for any number of producer threads and exactly
+/// one consumer thread.
+///
+/// Used to hand over interface events to the scheduler thread. On ESP32,
+/// they come from more than one task (e.g. the Arduino event task, and the
+/// system event task). Items are copied in and out; T should be small and
+/// trivially copyable. Capacity must be a power of two.
+///
+/// Each slot carries a sequence number that tells whether it is free for the
+/// producer that claims its position (by advancing the tail with a CAS), or
+/// holds an item published for the consumer.
+template <typename T, size_t Capacity>
+class MpscQueue {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+ public:
+  MpscQueue() : slots_(), head_(0), tail_(0) {
+    for (size_t i = 0; i < Capacity; ++i) {
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /// Appends the item. Returns false (dropping the item) if the queue is
+  /// full. May be called by any thread except the consumer.
+  bool push(const T& item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[tail & (Capacity - 1)];
+      size_t seq = slot->seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)tail;
+      if (diff == 0) {
+        // The slot is free; claim it.
+        if (tail_.compare_exchange_weak(tail, tail + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The slot still holds an item from the previous lap.
+        return false;
+      } else {
+        // Another producer claimed it first.
+        tail = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->item = item;
+    slot->seq.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Removes the oldest item, storing it in `item`. Returns false if the
+  /// queue is empty, or if the oldest item is still being pushed. Must only
+  /// be called by the consumer.
+  bool pop(T& item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[head & (Capacity - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != head + 1) return false;
+    item = slot.item;
+    // Free the slot for the next lap.
+    slot.seq.store(head + Capacity, std::memory_order_release);
+    head_.store(head + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /// Returns true if there is no item ready to pop. Exact only when called
+  /// by the consumer, with no concurrent push().
+  bool empty() const {
+    size_t head = head_.load(std::memory_order_relaxed);
+    return slots_[head & (Capacity - 1)].seq.load(
+               std::memory_order_acquire) != head + 1;
+  }
+
+  /// Returns the maximum number of queued items.
+  static constexpr size_t capacity() { return Capacity; }
+
+ private:
+  struct Slot {
+    // Equal to the position when free for a producer; to the position + 1
+    // when holding an item for the consumer.
+    std::atomic<size_t> seq;
+    T item;
+  };
+
+  Slot slots_[Capacity];
+
+  // Position of the next item to pop; written only by the consumer.
+  // Positions grow monotonically, and are wrapped on access.
+  std::atomic<size_t> head_;
+
+  // Position of the next item to push; advanced by producers.
+  std::atomic<size_t> tail_;
+};
+
+}  // namespace internal
+}  // namespace roo_wifi
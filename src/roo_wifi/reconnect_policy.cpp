@@ -0,0 +1,105 @@
+#include "roo_wifi/reconnect_policy.h"
+
+namespace roo_wifi {
+
+namespace {
+
+// Returns base * 2^exponent, capped at max.
+roo_time::Duration Backoff(roo_time::Duration base, roo_time::Duration max,
+                           int exponent) {
+  roo_time::Duration result = base;
+  while (exponent-- > 0 && result < max) {
+    result = result + result;
+  }
+  return (result > max) ? max : result;
+}
+
+// Shortens the delay by a random fraction of up to `jitter`.
+roo_time::Duration Jitter(roo_time::Duration delay, float jitter,
+                          uint32_t random) {
+  int64_t spread = (int64_t)(delay.inMicros() * jitter);
+  if (spread <= 0) return delay;
+  return roo_time::Micros(delay.inMicros() -
+                          (int64_t)((uint64_t)random * spread >> 32));
+}
+
+}  // namespace
+
+bool IsHandshakeTimeout(uint16_t reason) {
+  return reason == Interface::REASON_4WAY_HANDSHAKE_TIMEOUT ||
+         reason == Interface::REASON_HANDSHAKE_TIMEOUT;
+}
+
+DisconnectKind ClassifyDisconnect(Interface::EventType type, uint16_t reason,
+                                  bool link_was_up,
+                                  uint16_t handshake_timeouts) {
+  switch (reason) {
+    case Interface::REASON_AUTH_FAIL:
+    case Interface::REASON_802_1X_AUTH_FAILED: {
+      return DISCONNECT_AUTH_FAILED;
+    }
+    case Interface::REASON_4WAY_HANDSHAKE_TIMEOUT:
+    case Interface::REASON_HANDSHAKE_TIMEOUT: {
+      if (link_was_up) return DISCONNECT_LINK_LOST;
+      return (handshake_timeouts >=
+              internal::kHandshakeTimeoutsBeforeAuthFailure)
+                 ? DISCONNECT_AUTH_FAILED
+                 : DISCONNECT_OTHER;
+    }
+    case Interface::REASON_BEACON_TIMEOUT: {
+      return DISCONNECT_LINK_LOST;
+    }
+    case Interface::REASON_NO_AP_FOUND: {
+      return DISCONNECT_NOT_FOUND;
+    }
+    case Interface::REASON_UNKNOWN: {
+      // Interfaces that do not report reasons still tell these apart.
+      if (type == Interface::EV_CONNECTION_FAILED) {
+        return DISCONNECT_AUTH_FAILED;
+      }
+      if (type == Interface::EV_CONNECTION_LOST) return DISCONNECT_LINK_LOST;
+      return DISCONNECT_OTHER;
+    }
+    default: {
+      return DISCONNECT_OTHER;
+    }
+  }
+}
+
+ReconnectPolicy::Action BackoffReconnectPolicy::nextAction(
+    const Inputs& inputs, roo_time::Duration& delay) const {
+  switch (inputs.kind) {
+    case DISCONNECT_AUTH_FAILED: {
+      return RECONNECT_NEVER;
+    }
+    case DISCONNECT_NOT_FOUND: {
+      if (inputs.scans_expected) return RECONNECT_AFTER_SCAN;
+      // Otherwise, we would wait forever; retry like after other failures.
+      delay = Jitter(Backoff(initial_delay_, max_delay_, inputs.failures - 1),
+                     jitter_, inputs.random);
+      return RECONNECT_AFTER_DELAY;
+    }
+    case DISCONNECT_LINK_LOST: {
+      if (inputs.failures <= fast_retries_) {
+        delay = Jitter(fast_retry_delay_, jitter_, inputs.random);
+        return RECONNECT_AFTER_DELAY;
+      }
+      delay = Jitter(Backoff(initial_delay_, max_delay_,
+                             inputs.failures - 1 - fast_retries_),
+                     jitter_, inputs.random);
+      return RECONNECT_AFTER_DELAY;
+    }
+    default: {
+      delay = Jitter(Backoff(initial_delay_, max_delay_, inputs.failures - 1),
+                     jitter_, inputs.random);
+      return RECONNECT_AFTER_DELAY;
+    }
+  }
+}
+
+ReconnectPolicy::Action NeverReconnectPolicy::nextAction(
+    const Inputs& /*inputs*/, roo_time::Duration& /*delay*/) const {
+  return RECONNECT_NEVER;
+}
+
+}  // namespace roo_wifi
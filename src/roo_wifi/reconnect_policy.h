@@ -0,0 +1,135 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include "roo_time.h"
+#include "roo_wifi/hal/interface.h"
+
+namespace roo_wifi {
+
+/// What a disconnect means for reconnecting.
+enum DisconnectKind {
+  /// Anything else, e.g. the AP refused the association.
+  DISCONNECT_OTHER = 0,
+
+  /// The credentials have been rejected. Retrying will not help.
+  DISCONNECT_AUTH_FAILED = 1,
+
+  /// An established link went down, e.g. because the AP stopped sending
+  /// beacons. Often transient (e.g. the AP is rebooting).
+  DISCONNECT_LINK_LOST = 2,
+
+  /// The AP was not found.
+  DISCONNECT_NOT_FOUND = 3,
+};
+
+namespace internal {
+
+// Number of consecutive handshake timeouts during connection setup after
+// which the credentials are considered rejected.
+constexpr uint16_t kHandshakeTimeoutsBeforeAuthFailure = 3;
+
+}  // namespace internal
+
+/// Returns whether the disconnect reason is a (4-way or group key)
+/// handshake timeout.
+bool IsHandshakeTimeout(uint16_t reason);
+
+/// Classifies a disconnect event (see Interface::Event). `link_was_up`
+/// tells whether the connection had been established: handshake timeouts
+/// afterwards mean a lost link. During connection setup, they usually mean
+/// a wrong password, but can also be caused by interference or a busy AP;
+/// so they are retried, until `handshake_timeouts` (the number of
+/// consecutive ones, including this one) reaches a few (3).
+DisconnectKind ClassifyDisconnect(Interface::EventType type, uint16_t reason,
+                                  bool link_was_up,
+                                  uint16_t handshake_timeouts);
+
+/// Decides whether, and when, the controller reconnects after a connection
+/// attempt fails or an established connection drops (other than via
+/// Controller::disconnect()).
+class ReconnectPolicy {
+ public:
+  /// What the controller knows about the disconnect.
+  struct Inputs {
+    DisconnectKind kind;
+
+    /// Reason code of the disconnect event (see Interface::DisconnectReason).
+    uint16_t reason;
+
+    /// Number of consecutive disconnects without getting an IP address in
+    /// between, including this one.
+    uint16_t failures;
+
+    /// Whether background scans are going to happen (per the scan policy),
+    /// i.e. whether RECONNECT_AFTER_SCAN can ever reconnect.
+    bool scans_expected;
+
+    /// Uniformly distributed random number, for jitter. Devices draw
+    /// different sequences, so that ones that lost the same AP at the same
+    /// time do not retry in lockstep.
+    uint32_t random;
+  };
+
+  enum Action {
+    /// Do not reconnect (until the application calls connect()).
+    RECONNECT_NEVER = 0,
+
+    /// Reconnect after the delay.
+    RECONNECT_AFTER_DELAY = 1,
+
+    /// Reconnect once a scan finds the network.
+    RECONNECT_AFTER_SCAN = 2,
+  };
+
+  virtual ~ReconnectPolicy() = default;
+
+  /// Determines the action after the disconnect, setting the delay if it is
+  /// RECONNECT_AFTER_DELAY.
+  virtual Action nextAction(const Inputs& inputs,
+                            roo_time::Duration& delay) const = 0;
+};
+
+/// Gives up when the credentials are rejected; waits for a scan to find the
+/// network when it is not around (unless no background scans are going to
+/// happen); otherwise, retries with exponential backoff, starting from the
+/// initial delay and doubling up to the maximum.
+/// The first few retries after losing an established link use the (short)
+/// fast retry delay instead, since the link often comes right back.
+///
+/// All delays are randomized by up to the jitter fraction (i.e. a delay d
+/// becomes one between d * (1 - jitter) and d), so that devices that lost
+/// the same AP spread their reconnects out.
+class BackoffReconnectPolicy : public ReconnectPolicy {
+ public:
+  BackoffReconnectPolicy(
+      roo_time::Duration initial_delay = roo_time::Seconds(2),
+      roo_time::Duration max_delay = roo_time::Minutes(5),
+      roo_time::Duration fast_retry_delay = roo_time::Millis(500),
+      uint16_t fast_retries = 2, float jitter = 0.5)
+      : initial_delay_(initial_delay),
+        max_delay_(max_delay),
+        fast_retry_delay_(fast_retry_delay),
+        fast_retries_(fast_retries),
+        jitter_(jitter) {}
+
+  Action nextAction(const Inputs& inputs,
+                    roo_time::Duration& delay) const override;
+
+ private:
+  roo_time::Duration initial_delay_;
+  roo_time::Duration max_delay_;
+  roo_time::Duration fast_retry_delay_;
+  uint16_t fast_retries_;
+  float jitter_;
+};
+
+/// Never reconnects on its own; leaves it to the application (or to
+/// auto-join).
+class NeverReconnectPolicy : public ReconnectPolicy {
+ public:
+  Action nextAction(const Inputs& inputs,
+                    roo_time::Duration& delay) const override;
+};
+
+}  // namespace roo_wifi
@@ -0,0 +1,76 @@
+#include "roo_wifi/scan_list_diff.h"
+
+#include <algorithm>
+
+namespace roo_wifi {
+namespace internal {
+
+namespace {
+
+constexpr uint8_t kAbsent = 0;
+constexpr uint8_t kMove = 1;
+constexpr uint8_t kStay = 2;
+
+}  // namespace
+
+void ScanListDiff::compute(const int16_t* new_positions, int old_count,
+                           int new_count, Sink& sink) {
+  // Removals, back to front, so that the indices of the ones that remain to
+  // be reported are not affected.
+  for (int j = old_count - 1; j >= 0; --j) {
+    if (new_positions[j] < 0) sink.removed(j);
+  }
+  work_.clear();
+  for (int j = 0; j < old_count; ++j) {
+    if (new_positions[j] >= 0) work_.push_back(new_positions[j]);
+  }
+  state_.assign(new_count, kAbsent);
+  for (int16_t pos : work_) state_[pos] = kMove;
+
+  // Find the longest increasing subsequence of new positions among the
+  // survivors (patience sorting, O(n log n)). Its elements stay put.
+  int survivors = work_.size();
+  tails_.clear();
+  prev_.resize(survivors);
+  for (int k = 0; k < survivors; ++k) {
+    int16_t pos = work_[k];
+    auto itr = std::lower_bound(
+        tails_.begin(), tails_.end(), pos,
+        [&](int16_t tail, int16_t p) { return work_[tail] < p; });
+    prev_[k] = (itr == tails_.begin()) ? -1 : *(itr - 1);
+    if (itr == tails_.end()) {
+      tails_.push_back(k);
+    } else {
+      *itr = k;
+    }
+  }
+  if (!tails_.empty()) {
+    for (int k = tails_.back(); k >= 0; k = prev_[k]) {
+      state_[work_[k]] = kStay;
+    }
+  }
+
+  // Walk the new list back to front, placing every element that is new or
+  // needs to move right before its successor (the anchor).
+  for (int i = new_count - 1; i >= 0; --i) {
+    if (state_[i] == kStay) continue;
+    int anchor = (i == new_count - 1) ? work_.size() : indexOf(i + 1);
+    if (state_[i] == kAbsent) {
+      work_.insert(work_.begin() + anchor, i);
+      sink.added(anchor, i);
+    } else {
+      int from = indexOf(i);
+      work_.erase(work_.begin() + from);
+      if (from < anchor) --anchor;
+      work_.insert(work_.begin() + anchor, i);
+      if (from != anchor) sink.moved(from, anchor);
+    }
+  }
+}
+
+int ScanListDiff::indexOf(int16_t new_pos) const {
+  return std::find(work_.begin(), work_.end(), new_pos) - work_.begin();
+}
+
+}  // namespace internal
+}  // namespace roo_wifi
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <vector>
+
+namespace roo_wifi {
+namespace internal {
+
+/// Computes a short sequence of edits (removals, insertions and moves) that
+/// transforms an old list into a new one.
+///
+/// Edits are reported with 'stable' indices: each index refers to the list as
+/// modified by all the preceding edits, so that a receiver can apply them, in
+/// order, to its own copy of the old list. Removals come first, followed by
+/// moves and insertions. Elements that keep their relative order (the longest
+/// increasing subsequence of their new positions) are never moved, so the
+/// number of moves is minimal.
+///
+/// Buffers are retained across calls, so that steady-state use does not
+/// allocate.
+class ScanListDiff {
+ public:
+  /// Receives the edits.
+  class Sink {
+   public:
+    virtual ~Sink() = default;
+
+    /// The element at `idx` has been removed.
+    virtual void removed(int idx) = 0;
+
+    /// The element at position `new_pos` in the new list has been inserted
+    /// at `idx`.
+    virtual void added(int idx, int new_pos) = 0;
+
+    /// The element at `from_idx` has been removed, and re-inserted so that it
+    /// ends up at `to_idx`.
+    virtual void moved(int from_idx, int to_idx) = 0;
+  };
+
+  ScanListDiff() = default;
+
+  /// Computes the edits. `new_positions[j]` is the position in the new list
+  /// of the j-th element of the old list, or -1 if it is not present in the
+  /// new list.
+  void compute(const int16_t* new_positions, int old_count, int new_count,
+               Sink& sink);
+
+ private:
+  int indexOf(int16_t new_pos) const;
+
+  // The list being transformed, as new positions of its elements.
+  std::vector<int16_t> work_;
+
+  // Indexed by new position: 0 = absent from the old list; 1 = survivor
+  // that needs to move; 2 = survivor that stays in place.
+  std::vector<uint8_t> state_;
+
+  // Longest increasing subsequence scratch space.
+  std::vector<int16_t> tails_;
+  std::vector<int16_t> prev_;
+};
+
+}  // namespace internal
+}  // namespace roo_wifi
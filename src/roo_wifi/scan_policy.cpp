@@ -0,0 +1,82 @@
+#include "roo_wifi/scan_policy.h"
+
+namespace roo_wifi {
+
+namespace {
+
+// Signal changes of at least this much (in dB) between refreshes make the
+// link count as unstable.
+constexpr int kRssiTrendThreshold = 3;
+
+// Returns base * 2^exponent, capped at max.
+roo_time::Duration Backoff(roo_time::Duration base, roo_time::Duration max,
+                           int exponent) {
+  roo_time::Duration result = base;
+  while (exponent-- > 0 && result < max) {
+    result = result + result;
+  }
+  return (result > max) ? max : result;
+}
+
+}  // namespace
+
+bool DefaultScanPolicy::nextScanDelay(const Inputs& /*inputs*/,
+                                      roo_time::Duration& delay) const {
+  delay = roo_time::Seconds(15);
+  return true;
+}
+
+bool DefaultScanPolicy::nextRefreshDelay(const Inputs& /*inputs*/,
+                                         roo_time::Duration& delay) const {
+  delay = roo_time::Seconds(2);
+  return true;
+}
+
+bool AggressiveScanPolicy::nextScanDelay(const Inputs& /*inputs*/,
+                                         roo_time::Duration& delay) const {
+  delay = scan_interval_;
+  return true;
+}
+
+bool AggressiveScanPolicy::nextRefreshDelay(const Inputs& /*inputs*/,
+                                            roo_time::Duration& delay) const {
+  delay = refresh_interval_;
+  return true;
+}
+
+bool BackoffScanPolicy::nextScanDelay(const Inputs& inputs,
+                                      roo_time::Duration& delay) const {
+  if (inputs.scan_results_needed || inputs.status != WL_CONNECTED) {
+    delay = min_scan_interval_;
+  } else {
+    delay = Backoff(min_scan_interval_, max_scan_interval_,
+                    inputs.quiet_scans);
+  }
+  return true;
+}
+
+bool BackoffScanPolicy::nextRefreshDelay(const Inputs& inputs,
+                                         roo_time::Duration& delay) const {
+  int trend = inputs.rssi_trend;
+  if (inputs.scan_results_needed || inputs.status != WL_CONNECTED ||
+      trend >= kRssiTrendThreshold || trend <= -kRssiTrendThreshold) {
+    delay = min_refresh_interval_;
+  } else {
+    delay = Backoff(min_refresh_interval_, max_refresh_interval_,
+                    inputs.quiet_scans);
+  }
+  return true;
+}
+
+bool NeverScanPolicy::nextScanDelay(const Inputs& /*inputs*/,
+                                    roo_time::Duration& /*delay*/) const {
+  return false;
+}
+
+bool NeverScanPolicy::nextRefreshDelay(const Inputs& /*inputs*/,
+                                       roo_time::Duration& delay) const {
+  delay = roo_time::Seconds(2);
+  return true;
+}
+
+}  // namespace roo_wifi
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include "roo_time.h"
+#include "roo_wifi/hal/interface.h"
+
+namespace roo_wifi {
+
+/// Decides when the controller scans for networks, and when it refreshes the
+/// state of the current network.
+///
+/// Background scans cost throughput and power, so policies can trade
+/// freshness of the scan list against those, based on what the controller
+/// reports about its state.
+class ScanPolicy {
+ public:
+  /// Controller state that policies base their decisions on.
+  struct Inputs {
+    /// Status of the current network.
+    ConnectionStatus status;
+
+    /// Whether any listener needs up-to-date scan results (e.g. a UI showing
+    /// the list of networks is open).
+    bool scan_results_needed;
+
+    /// Signal strength of the current network; -128 if unknown.
+    int8_t rssi;
+
+    /// Change of the signal strength of the current network since the
+    /// previous refresh, in dB.
+    int8_t rssi_trend;
+
+    /// Number of networks that appeared or disappeared in the last scan.
+    uint16_t list_churn;
+
+    /// Number of consecutive scans during which the controller stayed
+    /// connected, no listener needed scan results, and the list did not
+    /// churn.
+    uint16_t quiet_scans;
+  };
+
+  virtual ~ScanPolicy() = default;
+
+  /// Determines the delay until the next scan, after a scan has completed
+  /// (or scanning has been resumed). Returns false to not scan at all.
+  virtual bool nextScanDelay(const Inputs& inputs,
+                             roo_time::Duration& delay) const = 0;
+
+  /// Determines the delay until the next refresh of the current network.
+  /// Returns false to not refresh periodically.
+  virtual bool nextRefreshDelay(const Inputs& inputs,
+                                roo_time::Duration& delay) const = 0;
+};
+
+/// Scans every 15 seconds and refreshes every 2 seconds, regardless of state.
+class DefaultScanPolicy : public ScanPolicy {
+ public:
+  bool nextScanDelay(const Inputs& inputs,
+                     roo_time::Duration& delay) const override;
+
+  bool nextRefreshDelay(const Inputs& inputs,
+                        roo_time::Duration& delay) const override;
+};
+
+/// Keeps the scan list as fresh as possible, e.g. while the user is picking
+/// a network.
+class AggressiveScanPolicy : public ScanPolicy {
+ public:
+  AggressiveScanPolicy(
+      roo_time::Duration scan_interval = roo_time::Seconds(3),
+      roo_time::Duration refresh_interval = roo_time::Seconds(1))
+      : scan_interval_(scan_interval), refresh_interval_(refresh_interval) {}
+
+  bool nextScanDelay(const Inputs& inputs,
+                     roo_time::Duration& delay) const override;
+
+  bool nextRefreshDelay(const Inputs& inputs,
+                        roo_time::Duration& delay) const override;
+
+ private:
+  roo_time::Duration scan_interval_;
+  roo_time::Duration refresh_interval_;
+};
+
+/// Scans at the minimum interval when scan results are needed, or when the
+/// device is not connected; then backs off exponentially, up to the maximum
+/// interval, while the link and the network list stay quiet. Refreshes back
+/// off in the same way, while the signal is stable.
+class BackoffScanPolicy : public ScanPolicy {
+ public:
+  BackoffScanPolicy(
+      roo_time::Duration min_scan_interval = roo_time::Seconds(15),
+      roo_time::Duration max_scan_interval = roo_time::Minutes(10),
+      roo_time::Duration min_refresh_interval = roo_time::Seconds(2),
+      roo_time::Duration max_refresh_interval = roo_time::Seconds(30))
+      : min_scan_interval_(min_scan_interval),
+        max_scan_interval_(max_scan_interval),
+        min_refresh_interval_(min_refresh_interval),
+        max_refresh_interval_(max_refresh_interval) {}
+
+  bool nextScanDelay(const Inputs& inputs,
+                     roo_time::Duration& delay) const override;
+
+  bool nextRefreshDelay(const Inputs& inputs,
+                        roo_time::Duration& delay) const override;
+
+ private:
+  roo_time::Duration min_scan_interval_;
+  roo_time::Duration max_scan_interval_;
+  roo_time::Duration min_refresh_interval_;
+  roo_time::Duration max_refresh_interval_;
+};
+
+/// Never scans in the background; scans only happen when explicitly
+/// requested. Refreshes every 2 seconds.
+class NeverScanPolicy : public ScanPolicy {
+ public:
+  bool nextScanDelay(const Inputs& inputs,
+                     roo_time::Duration& delay) const override;
+
+  bool nextRefreshDelay(const Inputs& inputs,
+                        roo_time::Duration& delay) const override;
+};
+
+}  // namespace roo_wifi
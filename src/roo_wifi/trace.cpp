@@ -0,0 +1,154 @@
+#include "roo_wifi/trace.h"
+
+#include <string.h>
+
+#include "roo_time.h"
+
+namespace roo_wifi {
+
+namespace {
+
+const char kHeader[] = "roo_wifi trace v1";
+const char kFooter[] = "end";
+const char kHexDigits[] = "0123456789abcdef";
+
+constexpr size_t kRecordBytes = 16;
+
+void Serialize(const TraceRecord& record, uint8_t* out) {
+  uint32_t header =
+      record.kind | (record.a << 8) | ((uint32_t)record.b << 16);
+  uint32_t words[] = {record.time_ms, header, record.c, record.d};
+  for (int w = 0; w < 4; ++w) {
+    for (int i = 0; i < 4; ++i) {
+      *out++ = (words[w] >> (8 * i)) & 0xFF;
+    }
+  }
+}
+
+void Deserialize(const uint8_t* in, TraceRecord& record) {
+  uint32_t words[4];
+  for (int w = 0; w < 4; ++w) {
+    words[w] = in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+    in += 4;
+  }
+  record.time_ms = words[0];
+  record.kind = words[1] & 0xFF;
+  record.a = (words[1] >> 8) & 0xFF;
+  record.b = words[1] >> 16;
+  record.c = words[2];
+  record.d = words[3];
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Returns the line (without the line terminator) that starts at `pos`, and
+// advances `pos` past it.
+roo::string_view NextLine(roo::string_view text, size_t& pos) {
+  size_t start = pos;
+  while (pos < text.size() && text[pos] != '\n') ++pos;
+  size_t end = pos;
+  if (pos < text.size()) ++pos;
+  if (end > start && text[end - 1] == '\r') --end;
+  return roo::string_view(text.data() + start, end - start);
+}
+
+}  // namespace
+
+constexpr size_t TraceRecorder::kDumpLineSize;
+
+uint32_t TraceSsidHash(roo::string_view ssid) {
+  if (ssid.empty()) return 0;
+  // FNV-1a.
+  uint32_t h = 2166136261u;
+  for (char c : ssid) {
+    h ^= (uint8_t)c;
+    h *= 16777619u;
+  }
+  return h == 0 ? 1 : h;
+}
+
+TraceRecorder::TraceRecorder(TraceRecord* buffer, size_t capacity)
+    : buffer_(buffer),
+      capacity_(capacity),
+      head_(0),
+      size_(0),
+      overwritten_(0) {}
+
+void TraceRecorder::record(TraceKind kind, uint8_t a, uint16_t b, uint32_t c,
+                           uint32_t d) {
+  if (capacity_ == 0) return;
+  size_t idx = head_ + size_;
+  if (idx >= capacity_) idx -= capacity_;
+  if (size_ == capacity_) {
+    if (++head_ == capacity_) head_ = 0;
+    ++overwritten_;
+  } else {
+    ++size_;
+  }
+  TraceRecord& r = buffer_[idx];
+  r.time_ms = (uint32_t)roo_time::Uptime::Now().inMillis();
+  r.kind = kind;
+  r.a = a;
+  r.b = b;
+  r.c = c;
+  r.d = d;
+}
+
+const TraceRecord& TraceRecorder::at(size_t idx) const {
+  idx += head_;
+  if (idx >= capacity_) idx -= capacity_;
+  return buffer_[idx];
+}
+
+void TraceRecorder::clear() {
+  head_ = 0;
+  size_ = 0;
+  overwritten_ = 0;
+}
+
+void TraceRecorder::formatHeader(char line[kDumpLineSize]) const {
+  strcpy(line, kHeader);
+  strcat(line, "\n");
+}
+
+void TraceRecorder::FormatRecord(const TraceRecord& record,
+                                 char line[kDumpLineSize]) {
+  uint8_t bytes[kRecordBytes];
+  Serialize(record, bytes);
+  for (size_t i = 0; i < kRecordBytes; ++i) {
+    *line++ = kHexDigits[bytes[i] >> 4];
+    *line++ = kHexDigits[bytes[i] & 0xF];
+  }
+  *line++ = '\n';
+  *line = '\0';
+}
+
+bool TraceRecorder::ParseDump(roo::string_view dump,
+                              std::vector<TraceRecord>* records) {
+  size_t pos = 0;
+  while (pos < dump.size() && NextLine(dump, pos) != kHeader) {
+  }
+  while (pos < dump.size()) {
+    roo::string_view line = NextLine(dump, pos);
+    if (line == kFooter) return true;
+    if (line.size() != 2 * kRecordBytes) return false;
+    uint8_t bytes[kRecordBytes];
+    for (size_t i = 0; i < kRecordBytes; ++i) {
+      int hi = HexValue(line[2 * i]);
+      int lo = HexValue(line[2 * i + 1]);
+      if (hi < 0 || lo < 0) return false;
+      bytes[i] = (hi << 4) | lo;
+    }
+    TraceRecord record;
+    Deserialize(bytes, record);
+    records->push_back(record);
+  }
+  return false;
+}
+
+}  // namespace roo_wifi
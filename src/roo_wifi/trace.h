@@ -0,0 +1,140 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+
+namespace roo_wifi {
+
+/// Kinds of trace records. The meaning of the record arguments (a, b, c, d)
+/// is given for each kind.
+enum TraceKind {
+  /// Interface event processed. a: EventType, b: reason.
+  TRACE_EVENT = 1,
+  /// Interface events dropped (see Controller::droppedEventCount()).
+  /// c: number of events dropped since the previous such record.
+  TRACE_EVENTS_DROPPED = 2,
+  /// Scan results processed. a: networks listed (capped at 255), b: raw
+  /// results, c: SSID hash of the current network if listed, or 0,
+  /// d: its RSSI (low byte) and whether it is open (bit 8).
+  TRACE_SCAN = 3,
+  /// Signal strength of the current network read from the interface, when
+  /// different from the previous reading. a: RSSI.
+  TRACE_RSSI = 4,
+
+  // Controller API calls.
+
+  /// begin(). a: whether enabled, c: SSID hash of the default network.
+  TRACE_BEGIN = 16,
+  /// toggleEnabled(). a: whether enabled after the call.
+  TRACE_TOGGLE_ENABLED = 17,
+  /// startScan(). a: whether started.
+  TRACE_START_SCAN = 18,
+  /// connect(). a: bit 0: no password, bit 1: the default network (the
+  /// no-argument overload), c: SSID hash.
+  TRACE_CONNECT = 19,
+  /// disconnect().
+  TRACE_DISCONNECT = 20,
+  /// forget(). c: SSID hash.
+  TRACE_FORGET = 21,
+};
+
+/// A single trace record. Fixed-size (16 bytes), so that a trace buffer
+/// holds a predictable number of them.
+struct TraceRecord {
+  uint32_t time_ms;  ///< Uptime, in milliseconds (wraps after ~49 days).
+  uint8_t kind;      ///< TraceKind.
+  uint8_t a;
+  uint16_t b;
+  uint32_t c;
+  uint32_t d;
+};
+
+/// Returns the hash used to identify SSIDs in traces, without recording the
+/// SSIDs themselves. The empty SSID hashes to zero.
+uint32_t TraceSsidHash(roo::string_view ssid);
+
+/// Fixed-size ring buffer of trace records; once full, the oldest records
+/// get overwritten. Does not allocate, and is cheap enough to stay enabled
+/// in production. Not thread-safe; the controller records on the scheduler
+/// thread.
+///
+/// The trace can be dumped as text, e.g. over serial, and parsed back on the
+/// host, e.g. to be replayed (see TraceReplayer).
+class TraceRecorder {
+ public:
+  /// Length of the dump lines, including the newline and the terminator.
+  static constexpr size_t kDumpLineSize = 34;
+
+  /// Creates a recorder that writes to the specified buffer.
+  TraceRecorder(TraceRecord* buffer, size_t capacity);
+
+  /// Appends a record, timestamped with the current uptime.
+  void record(TraceKind kind, uint8_t a = 0, uint16_t b = 0, uint32_t c = 0,
+              uint32_t d = 0);
+
+  /// Returns the number of records held.
+  size_t size() const { return size_; }
+
+  /// Returns the maximum number of records held.
+  size_t capacity() const { return capacity_; }
+
+  /// Returns the number of records that have been overwritten.
+  uint32_t overwritten() const { return overwritten_; }
+
+  /// Returns the record at the specified index, where 0 is the oldest.
+  const TraceRecord& at(size_t idx) const;
+
+  /// Removes all records.
+  void clear();
+
+  /// Writes the trace as text to `out`, which must have print(const char*)
+  /// (e.g. Serial). The dump is a header line, then one line of hex per
+  /// record (oldest first), then "end".
+  template <typename Out>
+  void dump(Out& out) const {
+    char line[kDumpLineSize];
+    formatHeader(line);
+    out.print(line);
+    for (size_t i = 0; i < size_; ++i) {
+      FormatRecord(at(i), line);
+      out.print(line);
+    }
+    out.print("end\n");
+  }
+
+  /// Formats the record as a dump line.
+  static void FormatRecord(const TraceRecord& record,
+                           char line[kDumpLineSize]);
+
+  /// Parses a dump, appending the records to the list. Lines that precede
+  /// the header (e.g. other serial output) are ignored. Returns false if the
+  /// dump is malformed or truncated.
+  static bool ParseDump(roo::string_view dump,
+                        std::vector<TraceRecord>* records);
+
+ private:
+  void formatHeader(char line[kDumpLineSize]) const;
+
+  TraceRecord* buffer_;
+  size_t capacity_;
+  size_t head_;  // Index of the oldest record.
+  size_t size_;
+  uint32_t overwritten_;
+};
+
+/// Trace recorder with an embedded buffer.
+template <size_t Capacity>
+class StaticTraceRecorder : public TraceRecorder {
+ public:
+  StaticTraceRecorder() : TraceRecorder(storage_, Capacity) {}
+
+ private:
+  TraceRecord storage_[Capacity];
+};
+
+}  // namespace roo_wifi
@@ -0,0 +1,57 @@
+#include "roo_wifi/auto_join.h"
+
+#include "gtest/gtest.h"
+
+namespace roo_wifi {
+
+TEST(AutoJoin, StrongerSignalWinsWithoutHistory) {
+  EXPECT_GT(AutoJoinScore(-50, nullptr), AutoJoinScore(-60, nullptr));
+}
+
+TEST(AutoJoin, ReliableNetworkBeatsSlightlyStrongerFlakyOne) {
+  ConnectionHistory reliable{10, 10, 1500};
+  ConnectionHistory flaky{10, 2, 1500};
+  EXPECT_GT(AutoJoinScore(-65, &reliable), AutoJoinScore(-55, &flaky));
+  // But not over a much stronger one.
+  EXPECT_LT(AutoJoinScore(-85, &reliable), AutoJoinScore(-55, &flaky));
+}
+
+TEST(AutoJoin, FastNetworkBeatsSlowOne) {
+  ConnectionHistory fast{5, 5, 800};
+  ConnectionHistory slow{5, 5, 8000};
+  EXPECT_GT(AutoJoinScore(-60, &fast), AutoJoinScore(-55, &slow));
+}
+
+TEST(AutoJoin, KnownGoodNetworkBeatsUntriedOne) {
+  ConnectionHistory good{3, 3, 1000};
+  EXPECT_GT(AutoJoinScore(-60, &good), AutoJoinScore(-60, nullptr));
+}
+
+TEST(AutoJoin, RecordsAttemptsAndSuccesses) {
+  ConnectionHistory history{0, 0, 0};
+  RecordConnectionAttempt(history);
+  RecordConnectionSuccess(history, 2000);
+  RecordConnectionAttempt(history);
+  RecordConnectionSuccess(history, 1000);
+  RecordConnectionAttempt(history);
+  EXPECT_EQ(3, history.attempts);
+  EXPECT_EQ(2, history.successes);
+  EXPECT_EQ(1500u, history.avg_time_to_ip_ms);
+  // Successes never exceed attempts.
+  RecordConnectionSuccess(history, 1000);
+  RecordConnectionSuccess(history, 1000);
+  EXPECT_EQ(3, history.successes);
+}
+
+TEST(AutoJoin, AgesHistory) {
+  ConnectionHistory history{0, 0, 0};
+  for (int i = 0; i < 100; ++i) {
+    RecordConnectionAttempt(history);
+    if (i < 50) RecordConnectionSuccess(history, 1000);
+  }
+  EXPECT_LE(history.attempts, 64);
+  // Recent failures weigh in more than the early successes.
+  EXPECT_LT(history.successes * 2, history.attempts);
+}
+
+}  // namespace roo_wifi
@@ -0,0 +1,148 @@
+#include "roo_wifi/hal/caching_store.h"
+
+#include "gtest/gtest.h"
+#include "roo_wifi/hal/simulated/in_memory_store.h"
+
+namespace roo_wifi {
+
+namespace {
+
+TEST(CachingStore, LoadsOnceAndServesReadsFromMemory) {
+  InMemoryStore backing;
+  backing.setIsInterfaceEnabled(true);
+  backing.setDefaultSSID("home");
+  backing.setPassword("home", "secret");
+  CachingStore store(backing);
+  store.begin();
+  int reads = backing.readCount();
+  std::string passwd;
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(store.getIsInterfaceEnabled());
+    EXPECT_EQ("home", store.getDefaultSSID());
+    EXPECT_TRUE(store.getPassword("home", passwd));
+    EXPECT_EQ("secret", passwd);
+  }
+  EXPECT_EQ(reads, backing.readCount());
+}
+
+TEST(CachingStore, CachesOtherPasswordsOnFirstUse) {
+  InMemoryStore backing;
+  backing.setPassword("office", "1234");
+  CachingStore store(backing);
+  store.begin();
+  std::string passwd;
+  EXPECT_TRUE(store.getPassword("office", passwd));
+  EXPECT_FALSE(store.getPassword("cafe", passwd));
+  int reads = backing.readCount();
+  EXPECT_TRUE(store.getPassword("office", passwd));
+  EXPECT_EQ("1234", passwd);
+  EXPECT_FALSE(store.getPassword("cafe", passwd));
+  EXPECT_EQ(reads, backing.readCount());
+}
+
+TEST(CachingStore, WritesThrough) {
+  InMemoryStore backing;
+  CachingStore store(backing);
+  store.begin();
+  store.setIsInterfaceEnabled(true);
+  store.setDefaultSSID("home");
+  store.setPassword("home", "secret");
+  EXPECT_TRUE(backing.getIsInterfaceEnabled());
+  EXPECT_EQ("home", backing.getDefaultSSID());
+  std::string passwd;
+  EXPECT_TRUE(backing.getPassword("home", passwd));
+  EXPECT_EQ("secret", passwd);
+
+  // Unchanged values are not re-written.
+  int writes = backing.writeCount();
+  store.setIsInterfaceEnabled(true);
+  store.setDefaultSSID("home");
+  store.setPassword("home", "secret");
+  EXPECT_EQ(writes, backing.writeCount());
+
+  store.clearPassword("home");
+  store.clearDefaultSSID();
+  EXPECT_FALSE(store.getPassword("home", passwd));
+  EXPECT_FALSE(backing.getPassword("home", passwd));
+  EXPECT_EQ("", store.getDefaultSSID());
+  EXPECT_EQ("", backing.getDefaultSSID());
+
+  // Neither are clears of values known to be absent.
+  writes = backing.writeCount();
+  store.clearPassword("home");
+  EXPECT_FALSE(store.getPassword("office", passwd));
+  store.clearPassword("office");
+  EXPECT_EQ(writes, backing.writeCount());
+}
+
+TEST(CachingStore, EvictsLeastRecentlyUsedNetworks) {
+  InMemoryStore backing;
+  backing.setDefaultSSID("home");
+  backing.setPassword("home", "secret");
+  backing.setPassword("office", "1234");
+  CachingStore store(backing, 4);
+  store.begin();
+  std::string passwd;
+  EXPECT_TRUE(store.getPassword("office", passwd));
+  // Lots of unknown SSIDs, e.g. from scans in a dense environment.
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_FALSE(store.getPassword("unknown-" + std::to_string(i), passwd));
+    // Keep the office network recently used.
+    EXPECT_TRUE(store.getPassword("office", passwd));
+    EXPECT_LE(store.cachedNetworkCount(), 5u);
+  }
+  int reads = backing.readCount();
+  EXPECT_TRUE(store.getPassword("home", passwd));
+  EXPECT_EQ("secret", passwd);
+  EXPECT_TRUE(store.getPassword("office", passwd));
+  EXPECT_EQ("1234", passwd);
+  EXPECT_EQ(reads, backing.readCount());
+
+  // Evicted networks get reloaded.
+  EXPECT_FALSE(store.getPassword("unknown-0", passwd));
+  EXPECT_EQ(reads + 1, backing.readCount());
+}
+
+TEST(CachingStore, BulkImportCommitsOnceAndExports) {
+  InMemoryStore backing;
+  CachingStore store(backing);
+  store.begin();
+  std::vector<KnownNetwork> networks(300);
+  for (size_t i = 0; i < networks.size(); ++i) {
+    networks[i].ssid = "net-" + std::to_string(i);
+    networks[i].flags = KNOWN_NETWORK_PASSWORD;
+    networks[i].password = "pw-" + std::to_string(i);
+  }
+  uint32_t commits = store.commitCount();
+  store.importKnownNetworks(networks);
+  EXPECT_EQ(commits + 1, store.commitCount());
+  std::string passwd;
+  EXPECT_TRUE(store.getPassword("net-123", passwd));
+  EXPECT_EQ("pw-123", passwd);
+
+  std::vector<KnownNetwork> exported;
+  ASSERT_TRUE(store.exportKnownNetworks(&exported));
+  EXPECT_EQ(300u, exported.size());
+}
+
+TEST(CachingStore, WorksOnConcreteStore) {
+  InMemoryStore backing;
+  BasicCachingStore<InMemoryStore> store(backing);
+  store.begin();
+  uint32_t commits = store.commitCount();
+  {
+    StoreBatch<BasicCachingStore<InMemoryStore>> batch(store);
+    store.setDefaultSSID("home");
+    store.setPassword("home", "secret");
+  }
+  EXPECT_EQ(commits + 1, backing.commitCount());
+  int reads = backing.readCount();
+  std::string passwd;
+  EXPECT_TRUE(store.getPassword("home", passwd));
+  EXPECT_EQ("secret", passwd);
+  EXPECT_EQ(reads, backing.readCount());
+}
+
+}  // namespace
+
+}  // namespace roo_wifi
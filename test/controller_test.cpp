@@ -0,0 +1,668 @@
+#include "roo_wifi/controller.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "roo_scheduler.h"
+#include "roo_wifi/hal/simulated/in_memory_store.h"
+#include "roo_wifi/hal/simulated/simulated_interface.h"
+
+namespace roo_wifi {
+
+namespace {
+
+class RecordingListener : public Controller::Listener {
+ public:
+  void onEnableChanged(bool /*enabled*/) override { ++enable_changed; }
+  void onScanStarted() override { ++scan_started; }
+  void onScanCompleted() override { ++scan_completed; }
+  void onCurrentNetworkChanged() override { ++current_network_changed; }
+  void onConnectionStateChanged(Interface::EventType type) override {
+    events.push_back(type);
+  }
+
+  int enable_changed = 0;
+  int scan_started = 0;
+  int scan_completed = 0;
+  int current_network_changed = 0;
+  std::vector<Interface::EventType> events;
+};
+
+// Maintains a copy of the scan list by applying incremental updates.
+class MirroringListener : public Controller::Listener {
+ public:
+  void onScannedNetworkRemoved(int idx) override {
+    list.erase(list.begin() + idx);
+    ++edits;
+  }
+
+  void onScannedNetworkAdded(int idx,
+                             const Controller::Network& network) override {
+    list.insert(list.begin() + idx, network);
+    ++edits;
+  }
+
+  void onScannedNetworkMoved(int from_idx, int to_idx) override {
+    Controller::Network network = list[from_idx];
+    list.erase(list.begin() + from_idx);
+    list.insert(list.begin() + to_idx, network);
+    ++edits;
+  }
+
+  void onScannedNetworkChanged(int idx,
+                               const Controller::Network& network) override {
+    list[idx] = network;
+    ++edits;
+  }
+
+  std::vector<Controller::Network> list;
+  int edits = 0;
+};
+
+class ControllerTest : public ::testing::Test {
+ protected:
+  ControllerTest()
+      : scheduler_(), interface_(scheduler_), store_(),
+        controller_(store_, interface_, scheduler_) {
+    controller_.begin();
+    controller_.addListener(&listener_);
+  }
+
+  void runPending() {
+    while (scheduler_.executeEligibleTasks()) {
+    }
+  }
+
+  // Makes the controller re-read the current network, as it does when the
+  // interface reports a signal change.
+  void refresh() {
+    interface_.emitEvent(Interface::EV_RSSI_CHANGED);
+    runPending();
+  }
+
+  // Completes the scan, and lets the controller process it.
+  void scan() {
+    interface_.completeScan();
+    runPending();
+  }
+
+  roo_scheduler::Scheduler scheduler_;
+  SimulatedInterface interface_;
+  InMemoryStore store_;
+  Controller controller_;
+  RecordingListener listener_;
+};
+
+TEST_F(ControllerTest, ScanDeduplicatesAndSortsBySignal) {
+  interface_.addAccessPoint("beta", -70);
+  interface_.addAccessPoint("alpha", -80);
+  interface_.addAccessPoint("beta", -50);
+  interface_.addAccessPoint("gamma", -60, WIFI_AUTH_OPEN);
+  interface_.addAccessPoint("alpha", -40);
+  ASSERT_TRUE(controller_.startScan());
+  EXPECT_EQ(1, listener_.scan_started);
+  scan();
+  EXPECT_EQ(1, listener_.scan_completed);
+  ASSERT_EQ(3, controller_.otherScannedNetworksCount());
+  EXPECT_EQ("alpha", controller_.otherNetwork(0).ssid());
+  EXPECT_EQ(-40, controller_.otherNetwork(0).rssi);
+  EXPECT_EQ("beta", controller_.otherNetwork(1).ssid());
+  EXPECT_EQ(-50, controller_.otherNetwork(1).rssi);
+  EXPECT_EQ("gamma", controller_.otherNetwork(2).ssid());
+  EXPECT_TRUE(controller_.otherNetwork(2).open);
+  EXPECT_FALSE(controller_.otherNetwork(0).open);
+}
+
+TEST_F(ControllerTest, ScanKeepsAccessPointsOfEachNetwork) {
+  interface_.addAccessPoint("beta", -70, WIFI_AUTH_WPA2_PSK, "", 1);
+  interface_.addAccessPoint("alpha", -80, WIFI_AUTH_WPA2_PSK, "", 6);
+  interface_.addAccessPoint("beta", -50, WIFI_AUTH_WPA2_PSK, "", 11);
+  interface_.addAccessPoint("beta", -60, WIFI_AUTH_WPA2_PSK, "", 6);
+  interface_.startScan();
+  scan();
+  ASSERT_EQ(2, controller_.otherScannedNetworksCount());
+  const Controller::Network& beta = controller_.otherNetwork(0);
+  EXPECT_EQ("beta", beta.ssid());
+  EXPECT_EQ(11, beta.channel);
+  EXPECT_EQ(0, memcmp(interface_.accessPoint(2).details.bssid, beta.bssid, 6));
+  ASSERT_EQ(3, controller_.accessPointCount(beta));
+  EXPECT_EQ(-50, controller_.accessPoint(beta, 0).rssi);
+  EXPECT_EQ(-60, controller_.accessPoint(beta, 1).rssi);
+  EXPECT_EQ(6, controller_.accessPoint(beta, 1).channel);
+  EXPECT_EQ(-70, controller_.accessPoint(beta, 2).rssi);
+  EXPECT_EQ(0, memcmp(interface_.accessPoint(0).details.bssid,
+                      controller_.accessPoint(beta, 2).bssid, 6));
+  const Controller::Network& alpha = controller_.otherNetwork(1);
+  ASSERT_EQ(1, controller_.accessPointCount(alpha));
+  EXPECT_EQ(-80, controller_.accessPoint(alpha, 0).rssi);
+}
+
+TEST_F(ControllerTest, ScanHandlesManyResults) {
+  // 600 BSSIDs over 300 SSIDs; the strongest ones come last. Ties are
+  // broken by the scan order.
+  for (int i = 0; i < 600; ++i) {
+    char ssid[33];
+    snprintf(ssid, sizeof(ssid), "net-%d", i % 300);
+    interface_.addAccessPoint(ssid, -100 + i / 8);
+  }
+  interface_.startScan();
+  scan();
+  ASSERT_EQ(100, controller_.otherScannedNetworksCount());
+  EXPECT_EQ("net-292", controller_.otherNetwork(0).ssid());
+  EXPECT_EQ(-100 + 599 / 8, controller_.otherNetwork(0).rssi);
+  for (int i = 1; i < 100; ++i) {
+    EXPECT_GE(controller_.otherNetwork(i - 1).rssi,
+              controller_.otherNetwork(i).rssi);
+  }
+}
+
+TEST_F(ControllerTest, ScanOptionsLimitScanList) {
+  for (int i = 0; i < 10; ++i) {
+    char ssid[33];
+    snprintf(ssid, sizeof(ssid), "net-%d", i);
+    interface_.addAccessPoint(ssid, -90 + i);
+  }
+  ScanOptions options;
+  options.max_results = 4;
+  controller_.setScanOptions(options);
+  ASSERT_TRUE(controller_.startScan());
+  scan();
+  ASSERT_EQ(4, controller_.otherScannedNetworksCount());
+  EXPECT_EQ("net-9", controller_.otherNetwork(0).ssid());
+  EXPECT_EQ("net-6", controller_.otherNetwork(3).ssid());
+}
+
+TEST_F(ControllerTest, FullScanKeepsResultsOnAnyChannel) {
+  // E.g. from interfaces that do not report the channel, or 5 GHz ones.
+  interface_.addAccessPoint("alpha", -50, WIFI_AUTH_OPEN, "", 0);
+  interface_.addAccessPoint("beta", -60, WIFI_AUTH_OPEN, "", 36);
+  ASSERT_TRUE(controller_.startScan());
+  scan();
+  ASSERT_EQ(2, controller_.otherScannedNetworksCount());
+  EXPECT_EQ("alpha", controller_.otherNetwork(0).ssid());
+  EXPECT_EQ(0, controller_.otherNetwork(0).channel);
+  EXPECT_EQ("beta", controller_.otherNetwork(1).ssid());
+}
+
+TEST_F(ControllerTest, PartialScanKeepsNetworksOutOfScope) {
+  int a = interface_.addAccessPoint("alpha", -50, WIFI_AUTH_OPEN, "", 1);
+  int b = interface_.addAccessPoint("beta", -60, WIFI_AUTH_OPEN, "", 6);
+  interface_.addAccessPoint("gamma", -70, WIFI_AUTH_OPEN, "", 6);
+  ASSERT_TRUE(controller_.startScan());
+  scan();
+  ASSERT_EQ(3, controller_.otherScannedNetworksCount());
+  interface_.accessPoint(a).details.rssi = -80;
+  interface_.accessPoint(b).details.rssi = -40;
+  interface_.removeAccessPoint(2);
+  ScanOptions options;
+  options.channels = ChannelSet();
+  options.channels.add(6);
+  ASSERT_TRUE(controller_.startScan(options));
+  scan();
+  // Channel 1 was not scanned: alpha is as before. Channel 6 is up to date.
+  ASSERT_EQ(2, controller_.otherScannedNetworksCount());
+  EXPECT_EQ("beta", controller_.otherNetwork(0).ssid());
+  EXPECT_EQ(-40, controller_.otherNetwork(0).rssi);
+  EXPECT_EQ("alpha", controller_.otherNetwork(1).ssid());
+  EXPECT_EQ(-50, controller_.otherNetwork(1).rssi);
+  EXPECT_EQ(1u, controller_.stats().partial_scans);
+}
+
+TEST_F(ControllerTest, ScanDeltasReproduceScanList) {
+  MirroringListener mirror;
+  controller_.addListener(&mirror);
+  std::mt19937 rng(42);
+  for (int i = 0; i < 30; ++i) {
+    char ssid[33];
+    snprintf(ssid, sizeof(ssid), "net-%d", i);
+    interface_.addAccessPoint(ssid, -40 - (int)(rng() % 50));
+  }
+  for (int round = 0; round < 50; ++round) {
+    // Perturb the environment: drift, and occasional (dis)appearances.
+    for (int i = 0; i < interface_.accessPointCount(); ++i) {
+      int8_t& rssi = interface_.accessPoint(i).details.rssi;
+      rssi = std::max(-95, std::min(-30, rssi + (int)(rng() % 7) - 3));
+    }
+    if (rng() % 3 == 0) {
+      interface_.removeAccessPoint(rng() % interface_.accessPointCount());
+    }
+    if (rng() % 3 == 0) {
+      char ssid[33];
+      snprintf(ssid, sizeof(ssid), "new-%d", round);
+      interface_.addAccessPoint(ssid, -40 - (int)(rng() % 50));
+    }
+    scan();
+    ASSERT_EQ(controller_.scannedNetworksCount(), (int)mirror.list.size());
+    for (int i = 0; i < controller_.scannedNetworksCount(); ++i) {
+      EXPECT_EQ(controller_.scannedNetwork(i).ssid(), mirror.list[i].ssid());
+      EXPECT_EQ(controller_.scannedNetwork(i).rssi, mirror.list[i].rssi);
+    }
+  }
+  // An identical scan yields no updates.
+  int edits = mirror.edits;
+  scan();
+  EXPECT_EQ(edits, mirror.edits);
+  controller_.removeListener(&mirror);
+}
+
+TEST_F(ControllerTest, AggregationKeepsMissedNetworks) {
+  Controller::ScanAggregation aggregation;
+  aggregation.max_missed_scans = 2;
+  controller_.setScanAggregation(aggregation);
+  interface_.addAccessPoint("strong", -50);
+  interface_.addAccessPoint("weak", -90);
+  interface_.startScan();
+  scan();
+  ASSERT_EQ(2, controller_.otherScannedNetworksCount());
+  interface_.removeAccessPoint(1);
+  for (int i = 0; i < 2; ++i) {
+    scan();
+    ASSERT_EQ(2, controller_.otherScannedNetworksCount());
+    EXPECT_EQ("weak", controller_.otherNetwork(1).ssid());
+    EXPECT_EQ(-90, controller_.otherNetwork(1).rssi);
+  }
+  scan();
+  EXPECT_EQ(1, controller_.otherScannedNetworksCount());
+}
+
+TEST_F(ControllerTest, AggregationSmoothsSignalAndHoldsOrder) {
+  Controller::ScanAggregation aggregation;
+  aggregation.rssi_weight = 0.5;
+  aggregation.reorder_hysteresis = 4;
+  controller_.setScanAggregation(aggregation);
+  int a = interface_.addAccessPoint("alpha", -60);
+  int b = interface_.addAccessPoint("beta", -62);
+  interface_.startScan();
+  scan();
+  // Jitter: smoothed, and not enough to swap the networks.
+  interface_.accessPoint(a).details.rssi = -64;
+  interface_.accessPoint(b).details.rssi = -60;
+  scan();
+  ASSERT_EQ(2, controller_.otherScannedNetworksCount());
+  EXPECT_EQ("alpha", controller_.otherNetwork(0).ssid());
+  EXPECT_EQ(-62, controller_.otherNetwork(0).rssi);
+  EXPECT_EQ("beta", controller_.otherNetwork(1).ssid());
+  EXPECT_EQ(-61, controller_.otherNetwork(1).rssi);
+  // A real change gets through.
+  interface_.accessPoint(b).details.rssi = -50;
+  scan();
+  EXPECT_EQ("beta", controller_.otherNetwork(0).ssid());
+  EXPECT_EQ("alpha", controller_.otherNetwork(1).ssid());
+}
+
+TEST_F(ControllerTest, AggregatedScanDeltasReproduceScanList) {
+  Controller::ScanAggregation aggregation;
+  aggregation.rssi_weight = 0.3;
+  aggregation.max_missed_scans = 3;
+  aggregation.reorder_hysteresis = 5;
+  controller_.setScanAggregation(aggregation);
+  MirroringListener mirror;
+  controller_.addListener(&mirror);
+  std::mt19937 rng(7);
+  for (int i = 0; i < 30; ++i) {
+    char ssid[33];
+    snprintf(ssid, sizeof(ssid), "net-%d", i);
+    interface_.addAccessPoint(ssid, -40 - (int)(rng() % 50));
+  }
+  for (int round = 0; round < 50; ++round) {
+    for (int i = 0; i < interface_.accessPointCount(); ++i) {
+      int8_t& rssi = interface_.accessPoint(i).details.rssi;
+      rssi = std::max(-95, std::min(-30, rssi + (int)(rng() % 11) - 5));
+    }
+    if (rng() % 3 == 0) {
+      interface_.removeAccessPoint(rng() % interface_.accessPointCount());
+    }
+    if (rng() % 3 == 0) {
+      char ssid[33];
+      snprintf(ssid, sizeof(ssid), "new-%d", round);
+      interface_.addAccessPoint(ssid, -40 - (int)(rng() % 50));
+    }
+    scan();
+    ASSERT_EQ(controller_.scannedNetworksCount(), (int)mirror.list.size());
+    for (int i = 0; i < controller_.scannedNetworksCount(); ++i) {
+      EXPECT_EQ(controller_.scannedNetwork(i).ssid(), mirror.list[i].ssid());
+      EXPECT_EQ(controller_.scannedNetwork(i).rssi, mirror.list[i].rssi);
+    }
+  }
+  controller_.removeListener(&mirror);
+}
+
+TEST_F(ControllerTest, ConnectReachesConnectedState) {
+  interface_.addAccessPoint("home", -55, WIFI_AUTH_WPA2_PSK, "secret");
+  interface_.startScan();
+  scan();
+  ASSERT_TRUE(controller_.connect("home", "secret"));
+  EXPECT_TRUE(controller_.isConnecting());
+  runPending();
+  EXPECT_EQ(WL_CONNECTED, controller_.currentNetworkStatus());
+  EXPECT_EQ("home", controller_.currentNetwork().ssid());
+  EXPECT_EQ(0, controller_.otherScannedNetworksCount());
+  ASSERT_EQ(2u, listener_.events.size());
+  EXPECT_EQ(Interface::EV_CONNECTED, listener_.events[0]);
+  EXPECT_EQ(Interface::EV_GOT_IP, listener_.events[1]);
+  EXPECT_EQ("home", store_.getDefaultSSID());
+  std::string passwd;
+  EXPECT_TRUE(controller_.getStoredPassword("home", passwd));
+  EXPECT_EQ("secret", passwd);
+}
+
+TEST_F(ControllerTest, ConnectAndForgetCommitOnce) {
+  interface_.addAccessPoint("home", -55, WIFI_AUTH_WPA2_PSK, "secret");
+  uint32_t commits = store_.commitCount();
+  ASSERT_TRUE(controller_.connect("home", "secret"));
+  EXPECT_EQ(commits + 1, store_.commitCount());
+  controller_.forget("home");
+  EXPECT_EQ(commits + 2, store_.commitCount());
+}
+
+TEST_F(ControllerTest, ReconnectUsesHint) {
+  interface_.addAccessPoint("home", -70, WIFI_AUTH_WPA2_PSK, "secret", 1);
+  interface_.addAccessPoint("home", -50, WIFI_AUTH_WPA2_PSK, "secret", 6);
+  ASSERT_TRUE(controller_.connect("home", "secret"));
+  runPending();
+  EXPECT_EQ(0, interface_.hintedConnectCount());
+  ConnectionHint hint;
+  ASSERT_TRUE(store_.getConnectionHint("home", hint));
+  EXPECT_EQ(6, hint.channel);
+  EXPECT_EQ(0, memcmp(interface_.accessPoint(1).details.bssid, hint.bssid, 6));
+
+  controller_.disconnect();
+  runPending();
+  ASSERT_TRUE(controller_.connect());
+  runPending();
+  EXPECT_EQ(1, interface_.hintedConnectCount());
+  EXPECT_EQ(WL_CONNECTED, controller_.currentNetworkStatus());
+}
+
+TEST_F(ControllerTest, StaleHintFallsBackToPlainConnect) {
+  interface_.addAccessPoint("home", -50, WIFI_AUTH_WPA2_PSK, "secret", 6);
+  ASSERT_TRUE(controller_.connect("home", "secret"));
+  runPending();
+  controller_.disconnect();
+  runPending();
+  // The AP gets replaced.
+  interface_.clearAccessPoints();
+  interface_.addAccessPoint("home", -60, WIFI_AUTH_WPA2_PSK, "secret", 11);
+  RecordingListener events;
+  controller_.addListener(&events);
+  ASSERT_TRUE(controller_.connect());
+  runPending();
+  controller_.removeListener(&events);
+  EXPECT_EQ(1, interface_.hintedConnectCount());
+  EXPECT_EQ(3, interface_.connectCount());
+  EXPECT_EQ(WL_CONNECTED, controller_.currentNetworkStatus());
+  // The failed hinted attempt is invisible to listeners.
+  ASSERT_EQ(2u, events.events.size());
+  EXPECT_EQ(Interface::EV_CONNECTED, events.events[0]);
+  EXPECT_EQ(Interface::EV_GOT_IP, events.events[1]);
+  ConnectionHint hint;
+  ASSERT_TRUE(store_.getConnectionHint("home", hint));
+  EXPECT_EQ(11, hint.channel);
+}
+
+TEST_F(ControllerTest, WrongPasswordFails) {
+  interface_.addAccessPoint("home", -55, WIFI_AUTH_WPA2_PSK, "secret");
+  ASSERT_TRUE(controller_.connect("home", "guess"));
+  runPending();
+  EXPECT_FALSE(controller_.isConnecting());
+  EXPECT_EQ(WL_CONNECT_FAILED, controller_.currentNetworkStatus());
+}
+
+TEST_F(ControllerTest, RefreshTracksSignalStrength) {
+  int ap = interface_.addAccessPoint("home", -55, WIFI_AUTH_OPEN);
+  ASSERT_TRUE(controller_.connect("home", ""));
+  runPending();
+  refresh();
+  EXPECT_EQ(-55, controller_.currentNetwork().rssi);
+  int notified = listener_.current_network_changed;
+  refresh();
+  EXPECT_EQ(notified, listener_.current_network_changed);
+  interface_.accessPoint(ap).details.rssi = -75;
+  refresh();
+  EXPECT_EQ(notified + 1, listener_.current_network_changed);
+  EXPECT_EQ(-75, controller_.currentNetwork().rssi);
+}
+
+TEST_F(ControllerTest, RssiEventsReplacePolling) {
+  int ap = interface_.addAccessPoint("home", -55, WIFI_AUTH_OPEN);
+  ASSERT_TRUE(controller_.connect("home", ""));
+  runPending();
+  EXPECT_EQ(-55, controller_.currentNetwork().rssi);
+  int notified = listener_.current_network_changed;
+  // Within the hysteresis band: no event.
+  interface_.setAccessPointRssi(ap, -58);
+  runPending();
+  EXPECT_EQ(notified, listener_.current_network_changed);
+  EXPECT_EQ(-55, controller_.currentNetwork().rssi);
+  // Outside: the controller re-queries, and re-arms around the new value.
+  interface_.setAccessPointRssi(ap, -70);
+  runPending();
+  EXPECT_EQ(notified + 1, listener_.current_network_changed);
+  EXPECT_EQ(-70, controller_.currentNetwork().rssi);
+  interface_.setAccessPointRssi(ap, -62);
+  runPending();
+  EXPECT_EQ(notified + 2, listener_.current_network_changed);
+  EXPECT_EQ(-62, controller_.currentNetwork().rssi);
+}
+
+TEST_F(ControllerTest, RefreshUsesCheapQueriesWhileAssociated) {
+  int ap = interface_.addAccessPoint("home", -55, WIFI_AUTH_OPEN);
+  ASSERT_TRUE(controller_.connect("home", ""));
+  runPending();
+  refresh();
+  int full_queries = interface_.apInfoCount();
+  interface_.accessPoint(ap).details.rssi = -75;
+  refresh();
+  refresh();
+  EXPECT_EQ(full_queries, interface_.apInfoCount());
+  EXPECT_EQ("home", controller_.currentNetwork().ssid());
+  EXPECT_EQ(-75, controller_.currentNetwork().rssi);
+  // Re-association invalidates the cached SSID.
+  interface_.addAccessPoint("work", -40, WIFI_AUTH_OPEN);
+  ASSERT_TRUE(controller_.connect("work", ""));
+  runPending();
+  refresh();
+  EXPECT_LT(full_queries, interface_.apInfoCount());
+  EXPECT_EQ("work", controller_.currentNetwork().ssid());
+}
+
+TEST_F(ControllerTest, CoalescesConnectionStateBursts) {
+  interface_.addAccessPoint("home", -55, WIFI_AUTH_OPEN);
+  ASSERT_TRUE(controller_.connect("home", ""));
+  runPending();
+  ASSERT_EQ(WL_CONNECTED, controller_.currentNetworkStatus());
+  controller_.setEventCoalescing(true);
+  size_t notified = listener_.events.size();
+  // A flap that ends where it started is absorbed entirely.
+  interface_.emitEvent(Interface::EV_DISCONNECTED);
+  interface_.emitEvent(Interface::EV_CONNECTED);
+  interface_.emitEvent(Interface::EV_GOT_IP);
+  runPending();
+  EXPECT_EQ(notified, listener_.events.size());
+  EXPECT_EQ(3u, controller_.coalescedEventCount());
+  EXPECT_EQ(WL_CONNECTED, controller_.currentNetworkStatus());
+  // Otherwise, listeners see the net transition once.
+  interface_.emitEvent(Interface::EV_DISCONNECTED);
+  interface_.emitEvent(Interface::EV_CONNECTION_LOST);
+  runPending();
+  ASSERT_EQ(notified + 1, listener_.events.size());
+  EXPECT_EQ(Interface::EV_CONNECTION_LOST, listener_.events.back());
+  EXPECT_EQ(4u, controller_.coalescedEventCount());
+  EXPECT_EQ(WL_CONNECTION_LOST, controller_.currentNetworkStatus());
+}
+
+TEST_F(ControllerTest, RecoversOnlyPendingScansAfterDroppedEvents) {
+  interface_.addAccessPoint("home", -55, WIFI_AUTH_OPEN);
+  ASSERT_TRUE(controller_.startScan());
+  scan();
+  ASSERT_EQ(1, listener_.scan_completed);
+  // Overflow the event queue; the processed scan is not reported again.
+  for (int i = 0; i < 40; ++i) {
+    interface_.emitEvent(Interface::EV_RSSI_CHANGED);
+  }
+  runPending();
+  ASSERT_LT(0u, controller_.droppedEventCount());
+  EXPECT_EQ(1, listener_.scan_completed);
+  // A scan whose completion got dropped is picked up, though.
+  ASSERT_TRUE(controller_.startScan());
+  for (int i = 0; i < 40; ++i) {
+    interface_.emitEvent(Interface::EV_RSSI_CHANGED);
+  }
+  interface_.completeScan();
+  runPending();
+  EXPECT_EQ(2, listener_.scan_completed);
+}
+
+TEST_F(ControllerTest, InterestMaskFiltersNotifications) {
+  int ap = interface_.addAccessPoint("home", -55, WIFI_AUTH_OPEN);
+  RecordingListener quiet;
+  controller_.addListener(&quiet, Controller::INTEREST_CURRENT_NETWORK |
+                                      Controller::INTEREST_CONNECTION_STATE);
+  scan();
+  EXPECT_EQ(0, quiet.scan_completed);
+  EXPECT_EQ(1, listener_.scan_completed);
+  ASSERT_TRUE(controller_.connect("home", ""));
+  runPending();
+  EXPECT_EQ(listener_.events, quiet.events);
+  // Signal strength churn only goes to listeners interested in it.
+  int quiet_changes = quiet.current_network_changed;
+  int changes = listener_.current_network_changed;
+  interface_.setAccessPointRssi(ap, -75);
+  runPending();
+  refresh();
+  EXPECT_EQ(quiet_changes, quiet.current_network_changed);
+  EXPECT_EQ(changes + 1, listener_.current_network_changed);
+  controller_.removeListener(&quiet);
+}
+
+TEST_F(ControllerTest, AutoJoinPicksStrongestKnownNetwork) {
+  store_.setPassword("office", "secret");
+  store_.setPassword("cafe", "latte");
+  interface_.addAccessPoint("office", -75, WIFI_AUTH_WPA2_PSK, "secret");
+  interface_.addAccessPoint("cafe", -55, WIFI_AUTH_WPA2_PSK, "latte");
+  interface_.addAccessPoint("stranger", -40, WIFI_AUTH_OPEN);
+  controller_.setAutoJoin(true);
+  controller_.toggleEnabled();
+  runPending();
+  scan();
+  EXPECT_EQ(WL_CONNECTED, controller_.currentNetworkStatus());
+  EXPECT_EQ("cafe", controller_.currentNetwork().ssid());
+  EXPECT_EQ("cafe", store_.getDefaultSSID());
+  ConnectionHistory history;
+  ASSERT_TRUE(store_.getConnectionHistory("cafe", history));
+  EXPECT_EQ(1, history.attempts);
+  EXPECT_EQ(1, history.successes);
+}
+
+TEST_F(ControllerTest, FailedAutoJoinKeepsDefaultNetwork) {
+  store_.setDefaultSSID("home");
+  store_.setPassword("home", "secret");
+  store_.setPassword("cafe", "stale");
+  interface_.addAccessPoint("cafe", -55, WIFI_AUTH_WPA2_PSK, "latte");
+  controller_.setAutoJoin(true);
+  controller_.toggleEnabled();
+  runPending();
+  int writes = store_.writeCount();
+  scan();
+  EXPECT_EQ(WL_CONNECT_FAILED, controller_.currentNetworkStatus());
+  EXPECT_EQ("cafe", controller_.currentNetwork().ssid());
+  EXPECT_EQ("home", store_.getDefaultSSID());
+  // Nor is anything written just for the attempt.
+  EXPECT_EQ(writes, store_.writeCount());
+}
+
+TEST_F(ControllerTest, AutoJoinPrefersReliableNetwork) {
+  store_.setPassword("office", "secret");
+  store_.setPassword("cafe", "latte");
+  store_.setConnectionHistory("office", ConnectionHistory{10, 10, 1000});
+  store_.setConnectionHistory("cafe", ConnectionHistory{10, 1, 6000});
+  interface_.addAccessPoint("office", -65, WIFI_AUTH_WPA2_PSK, "secret");
+  interface_.addAccessPoint("cafe", -55, WIFI_AUTH_WPA2_PSK, "latte");
+  controller_.setAutoJoin(true);
+  controller_.toggleEnabled();
+  runPending();
+  scan();
+  EXPECT_EQ(WL_CONNECTED, controller_.currentNetworkStatus());
+  EXPECT_EQ("office", controller_.currentNetwork().ssid());
+}
+
+TEST_F(ControllerTest, DisconnectSuspendsAutoJoin) {
+  store_.setPassword("home", "secret");
+  interface_.addAccessPoint("home", -55, WIFI_AUTH_WPA2_PSK, "secret");
+  controller_.setAutoJoin(true);
+  controller_.toggleEnabled();
+  runPending();
+  scan();
+  ASSERT_EQ(WL_CONNECTED, controller_.currentNetworkStatus());
+  controller_.disconnect();
+  runPending();
+  ASSERT_TRUE(controller_.startScan());
+  scan();
+  EXPECT_NE(WL_CONNECTED, controller_.currentNetworkStatus());
+  EXPECT_FALSE(controller_.isConnecting());
+}
+
+TEST_F(ControllerTest, StatsTrackConnectionsAndScans) {
+  interface_.addAccessPoint("home", -55, WIFI_AUTH_WPA2_PSK, "secret");
+  interface_.addAccessPoint("home", -75, WIFI_AUTH_WPA2_PSK, "secret");
+  interface_.addAccessPoint("cafe", -65, WIFI_AUTH_OPEN);
+  controller_.resetStats();
+  ASSERT_TRUE(controller_.startScan());
+  scan();
+  ASSERT_TRUE(controller_.connect("home", "secret"));
+  runPending();
+  ASSERT_EQ(WL_CONNECTED, controller_.currentNetworkStatus());
+
+  // The AP goes away for a while.
+  interface_.emitEvent(Interface::EV_CONNECTION_LOST, 200);
+  runPending();
+  ASSERT_TRUE(controller_.connect());
+  runPending();
+  interface_.emitEvent(Interface::EV_DISCONNECTED, 8);
+  interface_.emitEvent(Interface::EV_DISCONNECTED, 8);
+  runPending();
+
+  Controller::Stats stats = controller_.stats();
+  EXPECT_EQ(1u, stats.scans);
+  EXPECT_EQ(3u, stats.scan_results);
+  EXPECT_EQ(3, stats.last_scan_results);
+  EXPECT_EQ(1u, stats.scan_duration.count());
+  EXPECT_EQ(2u, stats.connect_attempts);
+  EXPECT_EQ(1u, stats.reconnect_attempts);
+  EXPECT_EQ(2u, stats.connect_latency.count());
+  EXPECT_EQ(2u, stats.got_ip_latency.count());
+  EXPECT_EQ(3u, stats.disconnects);
+  ASSERT_EQ(2, stats.disconnect_reasons);
+  EXPECT_EQ(200, stats.disconnects_by_reason[0].reason);
+  EXPECT_EQ(1u, stats.disconnects_by_reason[0].count);
+  EXPECT_EQ(8, stats.disconnects_by_reason[1].reason);
+  EXPECT_EQ(2u, stats.disconnects_by_reason[1].count);
+  EXPECT_EQ(0u, stats.other_disconnects);
+  roo_time::Duration total;
+  for (roo_time::Duration spent : stats.time_in_status) total += spent;
+  EXPECT_LE(total, stats.taken - stats.since);
+
+  controller_.resetStats();
+  stats = controller_.stats();
+  EXPECT_EQ(0u, stats.scans);
+  EXPECT_EQ(0u, stats.connect_latency.count());
+  EXPECT_EQ(0u, stats.disconnects);
+}
+
+TEST_F(ControllerTest, ForgetClearsCredentials) {
+  interface_.addAccessPoint("home", -55, WIFI_AUTH_WPA2_PSK, "secret");
+  ASSERT_TRUE(controller_.connect("home", "secret"));
+  runPending();
+  controller_.forget("home");
+  std::string passwd;
+  EXPECT_FALSE(controller_.getStoredPassword("home", passwd));
+  EXPECT_EQ("", store_.getDefaultSSID());
+}
+
+}  // namespace
+
+}  // namespace roo_wifi
@@ -0,0 +1,136 @@
+#include "roo_wifi/hal/known_network_table.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+namespace roo_wifi {
+
+namespace {
+
+class Collector : public KnownNetworkVisitor {
+ public:
+  bool visit(const KnownNetwork& network) override {
+    ssids.push_back(network.ssid);
+    return true;
+  }
+
+  std::vector<std::string> ssids;
+};
+
+void Fill(KnownNetworkTable& table) {
+  table.insert("office").flags = KNOWN_NETWORK_PASSWORD;
+  table.insert("office").password = "secret";
+  KnownNetwork& cafe = table.insert("cafe");
+  cafe.flags = KNOWN_NETWORK_HINT | KNOWN_NETWORK_HISTORY;
+  cafe.hint = ConnectionHint{{1, 2, 3, 4, 5, 6}, 11};
+  cafe.history = ConnectionHistory{7, 5, 2300};
+  KnownNetwork& home = table.insert("home");
+  home.flags = KNOWN_NETWORK_PASSWORD | KNOWN_NETWORK_HISTORY;
+  home.password = "";
+  home.history = ConnectionHistory{60000, 59999, 100000};
+}
+
+}  // namespace
+
+TEST(KnownNetworkTable, KeepsEntriesSortedAndUnique) {
+  KnownNetworkTable table;
+  Fill(table);
+  EXPECT_EQ(3u, table.size());
+  table.insert("home").flags |= KNOWN_NETWORK_HINT;
+  EXPECT_EQ(3u, table.size());
+  Collector collector;
+  table.forEach(collector);
+  EXPECT_EQ((std::vector<std::string>{"cafe", "home", "office"}),
+            collector.ssids);
+  EXPECT_EQ(nullptr, table.find("nowhere"));
+  ASSERT_NE(nullptr, table.find("office"));
+  EXPECT_EQ("secret", table.find("office")->password);
+}
+
+TEST(KnownNetworkTable, ClearRemovesEmptyEntries) {
+  KnownNetworkTable table;
+  Fill(table);
+  EXPECT_FALSE(table.clear("office", KNOWN_NETWORK_HINT));
+  EXPECT_TRUE(table.clear("cafe", KNOWN_NETWORK_HINT));
+  ASSERT_NE(nullptr, table.find("cafe"));
+  EXPECT_EQ(KNOWN_NETWORK_HISTORY, table.find("cafe")->flags);
+  EXPECT_TRUE(table.clear("cafe", KNOWN_NETWORK_HISTORY));
+  EXPECT_EQ(nullptr, table.find("cafe"));
+  EXPECT_FALSE(table.clear("cafe", KNOWN_NETWORK_HISTORY));
+  EXPECT_EQ(2u, table.size());
+}
+
+TEST(KnownNetworkTable, EncodingRoundTrips) {
+  KnownNetworkTable table;
+  Fill(table);
+  std::vector<uint8_t> data;
+  table.encode(&data);
+  KnownNetworkTable decoded;
+  ASSERT_TRUE(decoded.decode(data.data(), data.size()));
+  ASSERT_EQ(3u, decoded.size());
+  const KnownNetwork* cafe = decoded.find("cafe");
+  ASSERT_NE(nullptr, cafe);
+  EXPECT_EQ(KNOWN_NETWORK_HINT | KNOWN_NETWORK_HISTORY, cafe->flags);
+  EXPECT_EQ(0, memcmp(table.find("cafe")->hint.bssid, cafe->hint.bssid, 6));
+  EXPECT_EQ(11, cafe->hint.channel);
+  EXPECT_EQ(7, cafe->history.attempts);
+  EXPECT_EQ(5, cafe->history.successes);
+  EXPECT_EQ(2300u, cafe->history.avg_time_to_ip_ms);
+  const KnownNetwork* home = decoded.find("home");
+  ASSERT_NE(nullptr, home);
+  EXPECT_EQ("", home->password);
+  EXPECT_EQ(60000, home->history.attempts);
+  EXPECT_EQ(100000u, home->history.avg_time_to_ip_ms);
+  EXPECT_EQ("secret", decoded.find("office")->password);
+
+  // Re-encoding is stable.
+  std::vector<uint8_t> again;
+  decoded.encode(&again);
+  EXPECT_EQ(data, again);
+}
+
+TEST(KnownNetworkTable, HundredsOfEntriesStayCompact) {
+  KnownNetworkTable table;
+  for (int i = 0; i < 500; ++i) {
+    char ssid[33];
+    snprintf(ssid, sizeof(ssid), "network-%03d", i);
+    KnownNetwork& network = table.insert(ssid);
+    network.flags = KNOWN_NETWORK_PASSWORD;
+    network.password = "passphrase";
+  }
+  std::vector<uint8_t> data;
+  table.encode(&data);
+  // Per entry: 2 length bytes, flags, SSID and passphrase.
+  EXPECT_EQ(12u + 500 * (3 + 11 + 10), data.size());
+  KnownNetworkTable decoded;
+  ASSERT_TRUE(decoded.decode(data.data(), data.size()));
+  EXPECT_EQ(500u, decoded.size());
+}
+
+TEST(KnownNetworkTable, RejectsCorruptedData) {
+  KnownNetworkTable table;
+  Fill(table);
+  std::vector<uint8_t> data;
+  table.encode(&data);
+  KnownNetworkTable decoded;
+  // Truncated.
+  EXPECT_FALSE(decoded.decode(data.data(), data.size() - 1));
+  EXPECT_FALSE(decoded.decode(data.data(), 5));
+  // Bit flip in the payload.
+  std::vector<uint8_t> flipped = data;
+  flipped[20] ^= 0x10;
+  EXPECT_FALSE(decoded.decode(flipped.data(), flipped.size()));
+  // Unsupported version.
+  std::vector<uint8_t> newer = data;
+  newer[2] = KnownNetworkTable::kVersion + 1;
+  EXPECT_FALSE(decoded.decode(newer.data(), newer.size()));
+  EXPECT_EQ(0u, decoded.size());
+  // An empty table is valid.
+  KnownNetworkTable().encode(&data);
+  EXPECT_TRUE(decoded.decode(data.data(), data.size()));
+  EXPECT_EQ(0u, decoded.size());
+}
+
+}  // namespace roo_wifi
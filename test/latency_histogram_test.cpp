@@ -0,0 +1,57 @@
+#include "roo_wifi/latency_histogram.h"
+
+#include "gtest/gtest.h"
+
+namespace roo_wifi {
+
+using roo_time::Millis;
+using roo_time::Seconds;
+
+TEST(LatencyHistogram, EmptyHistogramReportsZeros) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0u, histogram.count());
+  EXPECT_EQ(Millis(0), histogram.min());
+  EXPECT_EQ(Millis(0), histogram.max());
+  EXPECT_EQ(Millis(0), histogram.mean());
+  EXPECT_EQ(Millis(0), histogram.percentile(50));
+}
+
+TEST(LatencyHistogram, BucketsGrowExponentially) {
+  LatencyHistogram histogram;
+  histogram.add(Millis(0));
+  histogram.add(Millis(15));
+  histogram.add(Millis(16));
+  histogram.add(Millis(31));
+  histogram.add(Millis(32));
+  histogram.add(Seconds(3600));
+  histogram.add(Millis(-5));
+  EXPECT_EQ(3u, histogram.bucketCount(0));
+  EXPECT_EQ(2u, histogram.bucketCount(1));
+  EXPECT_EQ(1u, histogram.bucketCount(2));
+  EXPECT_EQ(1u, histogram.bucketCount(LatencyHistogram::kBuckets - 1));
+  EXPECT_EQ(Millis(16), LatencyHistogram::bucketLimit(0));
+  EXPECT_EQ(Millis(32), LatencyHistogram::bucketLimit(1));
+  EXPECT_EQ(Millis(16 << 10), LatencyHistogram::bucketLimit(10));
+  EXPECT_EQ(Millis(16 << 10),
+            LatencyHistogram::bucketLimit(LatencyHistogram::kBuckets - 1));
+}
+
+TEST(LatencyHistogram, SummarizesDistribution) {
+  LatencyHistogram histogram;
+  for (int i = 1; i <= 100; ++i) histogram.add(Millis(i * 10));
+  EXPECT_EQ(100u, histogram.count());
+  EXPECT_EQ(Millis(10), histogram.min());
+  EXPECT_EQ(Millis(1000), histogram.max());
+  EXPECT_EQ(Millis(505), histogram.mean());
+  // The median (500 ms) is in the [256, 512) bucket.
+  EXPECT_EQ(Millis(512), histogram.percentile(50));
+  // The top bucket is capped at the maximum.
+  EXPECT_EQ(Millis(1000), histogram.percentile(99));
+  EXPECT_EQ(Millis(16), histogram.percentile(0));
+
+  histogram.reset();
+  EXPECT_EQ(0u, histogram.count());
+  EXPECT_EQ(0u, histogram.bucketCount(5));
+}
+
+}  // namespace roo_wifi
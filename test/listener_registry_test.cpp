@@ -0,0 +1,115 @@
+#include "roo_wifi/listener_registry.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace roo_wifi {
+namespace internal {
+
+namespace {
+
+constexpr uint16_t kFoo = 1 << 0;
+constexpr uint16_t kBar = 1 << 1;
+
+struct TestListener;
+
+typedef ListenerRegistry<TestListener> Registry;
+
+// Records notifications, and optionally runs an action on the first one.
+struct TestListener {
+  void notify(Registry& registry) {
+    ++calls;
+    if (action) {
+      auto fn = action;
+      action = nullptr;
+      fn(registry);
+    }
+  }
+
+  int calls = 0;
+  void (*action)(Registry& registry) = nullptr;
+};
+
+int Dispatch(Registry& registry, uint16_t kind) {
+  int count = 0;
+  for (TestListener* l : registry.of(kind)) {
+    l->notify(registry);
+    ++count;
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST(ListenerRegistry, DispatchesOnlyToInterestedListeners) {
+  Registry registry;
+  TestListener foo, bar, both;
+  registry.add(&foo, kFoo);
+  registry.add(&bar, kBar);
+  registry.add(&both, kFoo | kBar);
+  EXPECT_EQ(2u, registry.count(kFoo));
+  EXPECT_EQ(2, Dispatch(registry, kFoo));
+  EXPECT_EQ(1, foo.calls);
+  EXPECT_EQ(0, bar.calls);
+  EXPECT_EQ(1, both.calls);
+
+  // Re-adding replaces the mask.
+  registry.add(&both, kBar);
+  EXPECT_EQ(1u, registry.count(kFoo));
+  EXPECT_EQ(2u, registry.count(kBar));
+  registry.remove(&bar);
+  EXPECT_EQ(1, Dispatch(registry, kBar));
+  EXPECT_EQ(0, bar.calls);
+  EXPECT_EQ(2, both.calls);
+}
+
+TEST(ListenerRegistry, RemovalDuringDispatchTakesEffectImmediately) {
+  static TestListener first, second, third;
+  Registry registry;
+  registry.add(&first, kFoo);
+  registry.add(&second, kFoo);
+  registry.add(&third, kFoo);
+  first.action = [](Registry& r) {
+    r.remove(&first);
+    r.remove(&third);
+  };
+  EXPECT_EQ(2, Dispatch(registry, kFoo));
+  EXPECT_EQ(1, first.calls);
+  EXPECT_EQ(1, second.calls);
+  EXPECT_EQ(0, third.calls);
+  EXPECT_EQ(1u, registry.count(kFoo));
+  EXPECT_EQ(1, Dispatch(registry, kFoo));
+  EXPECT_EQ(2, second.calls);
+}
+
+TEST(ListenerRegistry, AdditionDuringDispatchIsDeferred) {
+  static TestListener adder, added;
+  Registry registry;
+  registry.add(&adder, kFoo);
+  adder.action = [](Registry& r) {
+    r.add(&added, kFoo);
+    // Nested dispatch does not see it either.
+    EXPECT_EQ(1, Dispatch(r, kFoo));
+  };
+  EXPECT_EQ(1, Dispatch(registry, kFoo));
+  EXPECT_EQ(0, added.calls);
+  EXPECT_EQ(2u, registry.count(kFoo));
+  EXPECT_EQ(2, Dispatch(registry, kFoo));
+  EXPECT_EQ(1, added.calls);
+}
+
+TEST(ListenerRegistry, AddThenRemoveDuringDispatchCancelsOut) {
+  static TestListener adder, added;
+  Registry registry;
+  registry.add(&adder, kFoo);
+  adder.action = [](Registry& r) {
+    r.add(&added, kFoo);
+    r.remove(&added);
+  };
+  Dispatch(registry, kFoo);
+  EXPECT_EQ(1u, registry.count(kFoo));
+}
+
+}  // namespace internal
+}  // namespace roo_wifi
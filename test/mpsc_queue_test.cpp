@@ -0,0 +1,260 @@
+#include "roo_wifi/mpsc_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "roo_scheduler.h"
+#include "roo_wifi/controller.h"
+#include "roo_wifi/hal/simulated/in_memory_store.h"
+
+namespace roo_wifi {
+namespace internal {
+
+namespace {
+
+// Payload wide enough that a torn read would be detectable.
+struct Item {
+  uint32_t seq;
+  uint32_t check;
+  uint64_t pad;
+};
+
+Item MakeItem(uint32_t seq) {
+  return Item{seq, seq * 2654435761u, ~(uint64_t)seq};
+}
+
+}  // namespace
+
+TEST(MpscQueue, FifoOrderAndCapacity) {
+  MpscQueue<int, 4> queue;
+  int item;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.pop(item));
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_TRUE(queue.push(round * 10 + i));
+    }
+    EXPECT_FALSE(queue.push(99));
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(queue.pop(item));
+      EXPECT_EQ(round * 10 + i, item);
+    }
+    EXPECT_TRUE(queue.empty());
+  }
+}
+
+TEST(MpscQueue, ConcurrentTransferIsOrderedAndIntact) {
+  static const uint32_t kCount = 1000000;
+  MpscQueue<Item, 32> queue;
+  std::atomic<bool> start(false);
+  std::thread producer([&]() {
+    while (!start.load()) {
+    }
+    for (uint32_t seq = 0; seq < kCount; ++seq) {
+      Item item = MakeItem(seq);
+      while (!queue.push(item)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  auto begin = std::chrono::steady_clock::now();
+  start.store(true);
+  uint32_t expected = 0;
+  Item item;
+  while (expected < kCount) {
+    if (!queue.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(expected, item.seq);
+    ASSERT_EQ(MakeItem(expected).check, item.check);
+    ASSERT_EQ(MakeItem(expected).pad, item.pad);
+    ++expected;
+  }
+  producer.join();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+  RecordProperty("items_per_second", (int)(kCount / seconds));
+  // Very conservative; even slow CI machines do tens of millions.
+  EXPECT_GT(kCount / seconds, 100000.0);
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(MpscQueue, ConcurrentProducersTransferEveryItemIntact) {
+  static const uint32_t kCountPerProducer = 500000;
+  static const uint32_t kProducerBit = 0x80000000u;
+  MpscQueue<Item, 32> queue;
+  std::atomic<bool> start(false);
+  auto produce = [&](uint32_t producer_bit) {
+    while (!start.load()) {
+    }
+    for (uint32_t n = 0; n < kCountPerProducer; ++n) {
+      Item item = MakeItem(producer_bit | n);
+      while (!queue.push(item)) {
+        std::this_thread::yield();
+      }
+    }
+  };
+  std::thread first(produce, 0);
+  std::thread second(produce, kProducerBit);
+  start.store(true);
+  // Items of each producer arrive in order, without gaps.
+  uint32_t expected[2] = {0, 0};
+  Item item;
+  while (expected[0] + expected[1] < 2 * kCountPerProducer) {
+    if (!queue.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(MakeItem(item.seq).check, item.check);
+    ASSERT_EQ(MakeItem(item.seq).pad, item.pad);
+    int producer = (item.seq & kProducerBit) ? 1 : 0;
+    ASSERT_EQ(expected[producer], item.seq & ~kProducerBit);
+    ++expected[producer];
+  }
+  first.join();
+  second.join();
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace internal
+
+namespace {
+
+// Interface that fires events from a separate thread, like the ESP32 event
+// task does.
+class ThreadedInterface : public Interface {
+ public:
+  void fire(EventType type, uint16_t reason) {
+    listener_->handleEvent(Event{type, reason});
+  }
+
+  void addEventListener(EventListener* listener) override {
+    listener_ = listener;
+  }
+  void removeEventListener(EventListener* /*listener*/) override {
+    listener_ = nullptr;
+  }
+  bool getApInfo(NetworkDetails* /*info*/) const override { return false; }
+  bool startScan() override { return true; }
+  bool scanCompleted() const override { return false; }
+  void disconnect() override {}
+  bool connect(const std::string& /*ssid*/,
+               const std::string& /*passwd*/) override {
+    return true;
+  }
+  ConnectionStatus getStatus() override { return WL_DISCONNECTED; }
+  bool getScanResults(std::vector<NetworkDetails>* /*list*/,
+                      int /*max_count*/) const override {
+    return false;
+  }
+
+ private:
+  EventListener* listener_ = nullptr;
+};
+
+class CountingListener : public Controller::Listener {
+ public:
+  void onConnectionStateChanged(Interface::EventType /*type*/) override {
+    ++events;
+  }
+
+  uint32_t events = 0;
+};
+
+// Runs the scheduler for a while, so that the controller polls the queued
+// events (as the interface delivers them on other threads).
+void RunFor(roo_scheduler::Scheduler& scheduler, int ms) {
+  auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+  while (std::chrono::steady_clock::now() < end) {
+    scheduler.executeEligibleTasks();
+    std::this_thread::yield();
+  }
+}
+
+}  // namespace
+
+TEST(ControllerEvents, StormFromAnotherThreadIsProcessedOnSchedulerThread) {
+  static const uint32_t kCount = 200000;
+  roo_scheduler::Scheduler scheduler;
+  ThreadedInterface interface;
+  InMemoryStore store;
+  Controller controller(store, interface, scheduler);
+  controller.begin();
+  CountingListener listener;
+  controller.addListener(&listener);
+
+  std::atomic<bool> done(false);
+  std::thread event_task([&]() {
+    static const Interface::EventType kCycle[] = {
+        Interface::EV_CONNECTED, Interface::EV_GOT_IP,
+        Interface::EV_DISCONNECTED};
+    for (uint32_t i = 0; i < kCount; ++i) {
+      interface.fire(kCycle[i % 3], 8);
+    }
+    done.store(true);
+  });
+  // The scheduler loop; the only thread that touches controller state.
+  while (!done.load()) {
+    scheduler.executeEligibleTasks();
+    ConnectionStatus status = controller.currentNetworkStatus();
+    EXPECT_TRUE(status == WL_IDLE_STATUS || status == WL_CONNECTED ||
+                status == WL_DISCONNECTED || status == WL_NO_SSID_AVAIL);
+  }
+  event_task.join();
+  RunFor(scheduler, 100);
+  // Every event has been either delivered or accounted for as dropped.
+  EXPECT_EQ(kCount, listener.events + controller.droppedEventCount());
+  EXPECT_EQ(8, controller.lastDisconnectReason());
+
+  // Once the storm is over, state follows the events again.
+  interface.fire(Interface::EV_CONNECTED, 0);
+  interface.fire(Interface::EV_GOT_IP, 0);
+  RunFor(scheduler, 100);
+  EXPECT_EQ(WL_CONNECTED, controller.currentNetworkStatus());
+  controller.removeListener(&listener);
+}
+
+TEST(ControllerEvents, StormsFromTwoThreadsAreAllAccountedFor) {
+  // Like on ESP32, where most events come from the Arduino event task, but
+  // RSSI notifications from the system event task.
+  static const uint32_t kCountPerThread = 100000;
+  roo_scheduler::Scheduler scheduler;
+  ThreadedInterface interface;
+  InMemoryStore store;
+  Controller controller(store, interface, scheduler);
+  controller.begin();
+  CountingListener listener;
+  controller.addListener(&listener);
+
+  std::atomic<int> running(2);
+  auto fire = [&](Interface::EventType first, Interface::EventType second) {
+    for (uint32_t i = 0; i < kCountPerThread; ++i) {
+      interface.fire((i % 2 == 0) ? first : second, 8);
+    }
+    running.fetch_sub(1);
+  };
+  std::thread event_task(fire, Interface::EV_CONNECTED,
+                         Interface::EV_DISCONNECTED);
+  std::thread sys_event_task(fire, Interface::EV_CONNECTED,
+                             Interface::EV_GOT_IP);
+  while (running.load() > 0) {
+    scheduler.executeEligibleTasks();
+  }
+  event_task.join();
+  sys_event_task.join();
+  RunFor(scheduler, 100);
+  EXPECT_EQ(2 * kCountPerThread,
+            listener.events + controller.droppedEventCount());
+
+  interface.fire(Interface::EV_CONNECTED, 0);
+  interface.fire(Interface::EV_GOT_IP, 0);
+  RunFor(scheduler, 100);
+  EXPECT_EQ(WL_CONNECTED, controller.currentNetworkStatus());
+  controller.removeListener(&listener);
+}
+
+}  // namespace roo_wifi
@@ -0,0 +1,135 @@
+#include "roo_wifi/reconnect_policy.h"
+
+#include "gtest/gtest.h"
+
+namespace roo_wifi {
+
+namespace {
+
+ReconnectPolicy::Inputs MakeInputs(DisconnectKind kind, uint16_t failures,
+                                   uint32_t random = 0) {
+  ReconnectPolicy::Inputs inputs;
+  inputs.kind = kind;
+  inputs.reason = 0;
+  inputs.failures = failures;
+  inputs.scans_expected = true;
+  inputs.random = random;
+  return inputs;
+}
+
+}  // namespace
+
+TEST(ReconnectPolicy, ClassifiesDisconnects) {
+  EXPECT_EQ(DISCONNECT_AUTH_FAILED,
+            ClassifyDisconnect(Interface::EV_CONNECTION_FAILED,
+                               Interface::REASON_AUTH_FAIL, false, 0));
+  EXPECT_EQ(DISCONNECT_LINK_LOST,
+            ClassifyDisconnect(Interface::EV_CONNECTION_LOST,
+                               Interface::REASON_BEACON_TIMEOUT, true, 0));
+  EXPECT_EQ(DISCONNECT_NOT_FOUND,
+            ClassifyDisconnect(Interface::EV_DISCONNECTED,
+                               Interface::REASON_NO_AP_FOUND, false, 0));
+  EXPECT_EQ(DISCONNECT_OTHER,
+            ClassifyDisconnect(Interface::EV_DISCONNECTED,
+                               Interface::REASON_ASSOC_FAIL, false, 0));
+  // Handshake timeouts depend on whether the link was up.
+  EXPECT_EQ(DISCONNECT_LINK_LOST,
+            ClassifyDisconnect(Interface::EV_CONNECTION_LOST,
+                               Interface::REASON_4WAY_HANDSHAKE_TIMEOUT, true,
+                               internal::kHandshakeTimeoutsBeforeAuthFailure));
+  // Without a reason, the event type decides.
+  EXPECT_EQ(DISCONNECT_AUTH_FAILED,
+            ClassifyDisconnect(Interface::EV_CONNECTION_FAILED, 0, false, 0));
+  EXPECT_EQ(DISCONNECT_LINK_LOST,
+            ClassifyDisconnect(Interface::EV_CONNECTION_LOST, 0, true, 0));
+  EXPECT_EQ(DISCONNECT_OTHER,
+            ClassifyDisconnect(Interface::EV_DISCONNECTED, 0, true, 0));
+}
+
+TEST(ReconnectPolicy, RetriesHandshakeTimeoutsBeforeGivingUp) {
+  // During connection setup, a timeout may as well be interference.
+  for (uint16_t timeouts = 1;
+       timeouts < internal::kHandshakeTimeoutsBeforeAuthFailure; ++timeouts) {
+    EXPECT_EQ(DISCONNECT_OTHER,
+              ClassifyDisconnect(Interface::EV_DISCONNECTED,
+                                 Interface::REASON_4WAY_HANDSHAKE_TIMEOUT,
+                                 false, timeouts));
+    EXPECT_EQ(DISCONNECT_OTHER,
+              ClassifyDisconnect(Interface::EV_DISCONNECTED,
+                                 Interface::REASON_HANDSHAKE_TIMEOUT, false,
+                                 timeouts));
+  }
+  // Repeated ones, though, most likely mean a wrong password.
+  EXPECT_EQ(DISCONNECT_AUTH_FAILED,
+            ClassifyDisconnect(Interface::EV_DISCONNECTED,
+                               Interface::REASON_4WAY_HANDSHAKE_TIMEOUT, false,
+                               internal::kHandshakeTimeoutsBeforeAuthFailure));
+  EXPECT_FALSE(IsHandshakeTimeout(Interface::REASON_AUTH_FAIL));
+}
+
+TEST(ReconnectPolicy, BacksOffExponentiallyUpToCap) {
+  BackoffReconnectPolicy policy(roo_time::Seconds(1), roo_time::Seconds(10),
+                                roo_time::Millis(100), 2, 0);
+  roo_time::Duration delay;
+  const int64_t expected[] = {1, 2, 4, 8, 10, 10};
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_EQ(ReconnectPolicy::RECONNECT_AFTER_DELAY,
+              policy.nextAction(MakeInputs(DISCONNECT_OTHER, i + 1), delay));
+    EXPECT_EQ(roo_time::Seconds(expected[i]), delay);
+  }
+}
+
+TEST(ReconnectPolicy, RetriesLostLinkFastFirst) {
+  BackoffReconnectPolicy policy(roo_time::Seconds(1), roo_time::Seconds(10),
+                                roo_time::Millis(100), 2, 0);
+  roo_time::Duration delay;
+  policy.nextAction(MakeInputs(DISCONNECT_LINK_LOST, 1), delay);
+  EXPECT_EQ(roo_time::Millis(100), delay);
+  policy.nextAction(MakeInputs(DISCONNECT_LINK_LOST, 2), delay);
+  EXPECT_EQ(roo_time::Millis(100), delay);
+  policy.nextAction(MakeInputs(DISCONNECT_LINK_LOST, 3), delay);
+  EXPECT_EQ(roo_time::Seconds(1), delay);
+  policy.nextAction(MakeInputs(DISCONNECT_LINK_LOST, 4), delay);
+  EXPECT_EQ(roo_time::Seconds(2), delay);
+}
+
+TEST(ReconnectPolicy, GivesUpOnAuthFailureAndWaitsForScanIfNotFound) {
+  BackoffReconnectPolicy policy;
+  roo_time::Duration delay;
+  EXPECT_EQ(ReconnectPolicy::RECONNECT_NEVER,
+            policy.nextAction(MakeInputs(DISCONNECT_AUTH_FAILED, 1), delay));
+  EXPECT_EQ(ReconnectPolicy::RECONNECT_AFTER_SCAN,
+            policy.nextAction(MakeInputs(DISCONNECT_NOT_FOUND, 1), delay));
+}
+
+TEST(ReconnectPolicy, RetriesMissingNetworkWhenNotScanning) {
+  BackoffReconnectPolicy policy(roo_time::Seconds(1), roo_time::Seconds(10),
+                                roo_time::Millis(100), 2, 0);
+  roo_time::Duration delay;
+  ReconnectPolicy::Inputs inputs = MakeInputs(DISCONNECT_NOT_FOUND, 3);
+  inputs.scans_expected = false;
+  EXPECT_EQ(ReconnectPolicy::RECONNECT_AFTER_DELAY,
+            policy.nextAction(inputs, delay));
+  EXPECT_EQ(roo_time::Seconds(4), delay);
+}
+
+TEST(ReconnectPolicy, JitterSpreadsDelaysWithinBounds) {
+  BackoffReconnectPolicy policy(roo_time::Seconds(8), roo_time::Seconds(8),
+                                roo_time::Millis(100), 0, 0.5);
+  roo_time::Duration delay;
+  roo_time::Duration min = roo_time::Seconds(8);
+  roo_time::Duration max = roo_time::Seconds(0);
+  uint32_t random = 12345;
+  for (int i = 0; i < 1000; ++i) {
+    random = random * 1664525 + 1013904223;
+    policy.nextAction(MakeInputs(DISCONNECT_OTHER, 1, random), delay);
+    ASSERT_GE(delay, roo_time::Seconds(4));
+    ASSERT_LE(delay, roo_time::Seconds(8));
+    min = std::min(min, delay);
+    max = std::max(max, delay);
+  }
+  EXPECT_LT(min, roo_time::Millis(4500));
+  EXPECT_GT(max, roo_time::Millis(7500));
+}
+
+}  // namespace roo_wifi
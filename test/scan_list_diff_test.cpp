@@ -0,0 +1,115 @@
+#include "roo_wifi/scan_list_diff.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace roo_wifi {
+namespace internal {
+
+namespace {
+
+// Applies the edits to a copy of the old list; elements are identified by
+// their new positions (or negative values for removed ones).
+class ApplyingSink : public ScanListDiff::Sink {
+ public:
+  ApplyingSink(std::vector<int> list) : list(std::move(list)) {}
+
+  void removed(int idx) override {
+    ASSERT_LT(idx, (int)list.size());
+    list.erase(list.begin() + idx);
+    ++removals;
+  }
+
+  void added(int idx, int new_pos) override {
+    ASSERT_LE(idx, (int)list.size());
+    list.insert(list.begin() + idx, new_pos);
+    ++additions;
+  }
+
+  void moved(int from_idx, int to_idx) override {
+    ASSERT_LT(from_idx, (int)list.size());
+    ASSERT_LT(to_idx, (int)list.size());
+    int e = list[from_idx];
+    list.erase(list.begin() + from_idx);
+    list.insert(list.begin() + to_idx, e);
+    ++moves;
+  }
+
+  std::vector<int> list;
+  int removals = 0;
+  int additions = 0;
+  int moves = 0;
+};
+
+std::vector<int> Apply(const std::vector<int16_t>& new_positions,
+                       int new_count, ApplyingSink* sink) {
+  ScanListDiff diff;
+  diff.compute(new_positions.data(), new_positions.size(), new_count, *sink);
+  return sink->list;
+}
+
+std::vector<int> Identity(int n) {
+  std::vector<int> result(n);
+  for (int i = 0; i < n; ++i) result[i] = i;
+  return result;
+}
+
+TEST(ScanListDiff, NoChanges) {
+  std::vector<int16_t> pos = {0, 1, 2, 3};
+  ApplyingSink sink({0, 1, 2, 3});
+  EXPECT_EQ(Identity(4), Apply(pos, 4, &sink));
+  EXPECT_EQ(0, sink.removals + sink.additions + sink.moves);
+}
+
+TEST(ScanListDiff, SingleElementSinks) {
+  // A at the top drops to the bottom: one move, not three.
+  std::vector<int16_t> pos = {3, 0, 1, 2};
+  ApplyingSink sink({3, 0, 1, 2});
+  EXPECT_EQ(Identity(4), Apply(pos, 4, &sink));
+  EXPECT_EQ(1, sink.moves);
+  EXPECT_EQ(0, sink.removals + sink.additions);
+}
+
+TEST(ScanListDiff, AddRemoveAndSwap) {
+  // Old: [A, B, C, D]; new: [C, E, B, D]; A removed, E added.
+  std::vector<int16_t> pos = {-1, 2, 0, 3};
+  ApplyingSink sink({-1, 2, 0, 3});
+  EXPECT_EQ(Identity(4), Apply(pos, 4, &sink));
+  EXPECT_EQ(1, sink.removals);
+  EXPECT_EQ(1, sink.additions);
+  EXPECT_EQ(1, sink.moves);
+}
+
+TEST(ScanListDiff, Randomized) {
+  std::mt19937 rng(1234);
+  for (int iteration = 0; iteration < 1000; ++iteration) {
+    int old_count = rng() % 20;
+    int new_count = rng() % 20;
+    // Choose survivors and their new positions at random.
+    std::vector<int> slots = Identity(new_count);
+    std::shuffle(slots.begin(), slots.end(), rng);
+    std::vector<int16_t> pos(old_count);
+    std::vector<int> old_list(old_count);
+    int next = 0;
+    for (int j = 0; j < old_count; ++j) {
+      if (next < new_count && rng() % 4 != 0) {
+        pos[j] = slots[next++];
+      } else {
+        pos[j] = -1;
+      }
+      old_list[j] = pos[j];
+    }
+    ApplyingSink sink(old_list);
+    EXPECT_EQ(Identity(new_count), Apply(pos, new_count, &sink));
+    EXPECT_EQ(new_count - next, sink.additions);
+    EXPECT_EQ(old_count - next, sink.removals);
+  }
+}
+
+}  // namespace
+
+}  // namespace internal
+}  // namespace roo_wifi
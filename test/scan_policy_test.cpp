@@ -0,0 +1,75 @@
+#include "roo_wifi/scan_policy.h"
+
+#include "gtest/gtest.h"
+
+namespace roo_wifi {
+
+namespace {
+
+ScanPolicy::Inputs Connected(uint16_t quiet_scans) {
+  ScanPolicy::Inputs inputs;
+  inputs.status = WL_CONNECTED;
+  inputs.scan_results_needed = false;
+  inputs.rssi = -60;
+  inputs.rssi_trend = 0;
+  inputs.list_churn = 0;
+  inputs.quiet_scans = quiet_scans;
+  return inputs;
+}
+
+int64_t ScanDelayMillis(const ScanPolicy& policy,
+                        const ScanPolicy::Inputs& inputs) {
+  roo_time::Duration delay;
+  if (!policy.nextScanDelay(inputs, delay)) return -1;
+  return delay.inMillis();
+}
+
+int64_t RefreshDelayMillis(const ScanPolicy& policy,
+                           const ScanPolicy::Inputs& inputs) {
+  roo_time::Duration delay;
+  if (!policy.nextRefreshDelay(inputs, delay)) return -1;
+  return delay.inMillis();
+}
+
+TEST(ScanPolicy, DefaultIsFixed) {
+  DefaultScanPolicy policy;
+  EXPECT_EQ(15000, ScanDelayMillis(policy, Connected(0)));
+  EXPECT_EQ(15000, ScanDelayMillis(policy, Connected(10)));
+  EXPECT_EQ(2000, RefreshDelayMillis(policy, Connected(10)));
+}
+
+TEST(ScanPolicy, NeverScans) {
+  NeverScanPolicy policy;
+  EXPECT_EQ(-1, ScanDelayMillis(policy, Connected(0)));
+  EXPECT_EQ(2000, RefreshDelayMillis(policy, Connected(0)));
+}
+
+TEST(ScanPolicy, BackoffWhileQuiet) {
+  BackoffScanPolicy policy;
+  EXPECT_EQ(15000, ScanDelayMillis(policy, Connected(0)));
+  EXPECT_EQ(30000, ScanDelayMillis(policy, Connected(1)));
+  EXPECT_EQ(120000, ScanDelayMillis(policy, Connected(3)));
+  EXPECT_EQ(600000, ScanDelayMillis(policy, Connected(100)));
+  EXPECT_EQ(2000, RefreshDelayMillis(policy, Connected(0)));
+  EXPECT_EQ(30000, RefreshDelayMillis(policy, Connected(100)));
+}
+
+TEST(ScanPolicy, BackoffResetsWhenActive) {
+  BackoffScanPolicy policy;
+  ScanPolicy::Inputs inputs = Connected(10);
+  inputs.scan_results_needed = true;
+  EXPECT_EQ(15000, ScanDelayMillis(policy, inputs));
+  EXPECT_EQ(2000, RefreshDelayMillis(policy, inputs));
+
+  inputs = Connected(10);
+  inputs.status = WL_DISCONNECTED;
+  EXPECT_EQ(15000, ScanDelayMillis(policy, inputs));
+
+  inputs = Connected(10);
+  inputs.rssi_trend = -5;
+  EXPECT_EQ(2000, RefreshDelayMillis(policy, inputs));
+}
+
+}  // namespace
+
+}  // namespace roo_wifi
@@ -0,0 +1,330 @@
+#include "roo_wifi/hal/simulated/simulation.h"
+
+#include <chrono>
+
+#include "gtest/gtest.h"
+#include "roo_wifi/scan_policy.h"
+
+namespace roo_wifi {
+
+namespace {
+
+RfEnvironment::Site FlakySite() {
+  RfEnvironment::Site site("home", "secret", -65);
+  site.rssi_drift = 2;
+  site.rssi_spread = 10;
+  site.mean_uptime = roo_time::Hours(2);
+  site.mean_downtime = roo_time::Minutes(3);
+  return site;
+}
+
+}  // namespace
+
+TEST(Simulation, StableNetworkStaysConnected) {
+  Simulation sim;
+  sim.environment().addSite(RfEnvironment::Site("home", "secret", -60));
+  sim.controller().setPassword("home", "secret");
+  sim.begin();
+  sim.runFor(roo_time::Hours(24));
+  Simulation::Report report = sim.report();
+  EXPECT_EQ(roo_time::Hours(24), report.elapsed);
+  EXPECT_EQ(1u, report.connections);
+  EXPECT_EQ(0u, report.disconnections);
+  EXPECT_EQ(1u, report.connect_attempts);
+  // Connected right after the first scan.
+  EXPECT_LT(report.max_time_to_connect, roo_time::Seconds(5));
+  EXPECT_EQ(report.max_time_to_connect, report.downtime);
+  EXPECT_EQ(roo_time::Millis(0), report.time_without_coverage);
+}
+
+TEST(Simulation, ReconnectsAfterOutages) {
+  Simulation sim(7);
+  sim.environment().addSite(FlakySite());
+  sim.controller().setPassword("home", "secret");
+  sim.begin();
+  sim.runFor(roo_time::Hours(24 * 30));
+  Simulation::Report report = sim.report();
+  EXPECT_GT(sim.environment().outageCount(), 100u);
+  EXPECT_EQ(sim.environment().outageCount(), report.disconnections);
+  EXPECT_EQ(report.disconnections + 1, report.connections);
+  EXPECT_GE(report.downtime, report.time_without_coverage);
+  EXPECT_GT(report.availability(), 0.9);
+  EXPECT_LT(report.availability(), 1.0);
+  EXPECT_GT(report.scans, 0u);
+}
+
+TEST(Simulation, SameSeedGivesSameReport) {
+  Simulation::Report reports[2];
+  for (Simulation::Report& report : reports) {
+    Simulation sim(42);
+    RfEnvironment::Site site = FlakySite();
+    site.association_failure_rate = 0.3;
+    sim.environment().addSite(site);
+    sim.environment().addSite(RfEnvironment::Site("other", "", -80));
+    sim.controller().setPassword("home", "secret");
+    sim.begin();
+    sim.runFor(roo_time::Hours(24 * 7));
+    report = sim.report();
+  }
+  EXPECT_EQ(reports[0].downtime, reports[1].downtime);
+  EXPECT_EQ(reports[0].connections, reports[1].connections);
+  EXPECT_EQ(reports[0].total_time_to_connect,
+            reports[1].total_time_to_connect);
+  EXPECT_EQ(reports[0].scans, reports[1].scans);
+  EXPECT_EQ(reports[0].connect_attempts, reports[1].connect_attempts);
+  // Some association attempts failed.
+  EXPECT_GT(reports[0].connect_attempts, reports[0].connections);
+}
+
+TEST(Simulation, RetriesQuicklyAfterBriefLinkLoss) {
+  Simulation sim;
+  NeverScanPolicy never_scan;
+  sim.controller().setScanPolicy(&never_scan);
+  sim.environment().addSite(RfEnvironment::Site("home", "secret", -60));
+  sim.store().setDefaultSSID("home");
+  sim.controller().setPassword("home", "secret");
+  sim.begin();
+  sim.runFor(roo_time::Minutes(1));
+  ASSERT_EQ(WL_CONNECTED, sim.controller().currentNetworkStatus());
+  sim.resetReport();
+  // The AP blips.
+  sim.environment().setUp(0, false);
+  sim.runFor(roo_time::Millis(100));
+  sim.environment().setUp(0, true);
+  sim.runFor(roo_time::Minutes(1));
+  Simulation::Report report = sim.report();
+  EXPECT_EQ(1u, report.connections);
+  EXPECT_EQ(1u, report.connect_attempts);
+  EXPECT_LE(report.max_time_to_connect, roo_time::Millis(500));
+  EXPECT_EQ(0u, report.scans);
+}
+
+TEST(Simulation, ClassifiesDisconnectByStateBeforeTheBatch) {
+  for (bool coalescing : {false, true}) {
+    Simulation sim;
+    NeverScanPolicy never_scan;
+    sim.controller().setScanPolicy(&never_scan);
+    sim.controller().setEventCoalescing(coalescing);
+    sim.environment().addSite(RfEnvironment::Site("home", "secret", -60));
+    sim.store().setDefaultSSID("home");
+    sim.controller().setPassword("home", "secret");
+    sim.begin();
+    sim.runFor(roo_time::Minutes(1));
+    ASSERT_EQ(WL_CONNECTED, sim.controller().currentNetworkStatus());
+    sim.resetReport();
+    // A re-association that fails, drained together. The link was up, so it
+    // is a lost link, retried right away; not rejected credentials.
+    sim.interface().emitEvent(Interface::EV_CONNECTED);
+    sim.interface().emitEvent(Interface::EV_DISCONNECTED,
+                              Interface::REASON_4WAY_HANDSHAKE_TIMEOUT);
+    sim.runFor(roo_time::Minutes(1));
+    Simulation::Report report = sim.report();
+    EXPECT_EQ(1u, report.connections) << coalescing;
+    EXPECT_LE(report.max_time_to_connect, roo_time::Millis(500)) << coalescing;
+    EXPECT_EQ(WL_CONNECTED, sim.controller().currentNetworkStatus());
+  }
+}
+
+TEST(Simulation, WaitsForScanWhenNetworkIsGone) {
+  Simulation sim;
+  sim.environment().addSite(RfEnvironment::Site("home", "secret", -60));
+  sim.store().setDefaultSSID("home");
+  sim.controller().setPassword("home", "secret");
+  sim.begin();
+  sim.runFor(roo_time::Minutes(1));
+  ASSERT_EQ(WL_CONNECTED, sim.controller().currentNetworkStatus());
+  sim.resetReport();
+  sim.environment().setUp(0, false);
+  sim.runFor(roo_time::Minutes(10));
+  // Just the fast retry (with the hint, then without); then waiting for
+  // scans to find the network.
+  EXPECT_EQ(2u, sim.report().connect_attempts);
+  EXPECT_GT(sim.report().scans, 10u);
+  sim.environment().setUp(0, true);
+  sim.runFor(roo_time::Minutes(1));
+  Simulation::Report report = sim.report();
+  EXPECT_EQ(1u, report.connections);
+  EXPECT_EQ(3u, report.connect_attempts);
+}
+
+TEST(Simulation, RetriesMissingNetworkWhenNotScanning) {
+  Simulation sim;
+  NeverScanPolicy never_scan;
+  sim.controller().setScanPolicy(&never_scan);
+  sim.environment().addSite(RfEnvironment::Site("home", "secret", -60));
+  sim.store().setDefaultSSID("home");
+  sim.controller().setPassword("home", "secret");
+  sim.begin();
+  sim.runFor(roo_time::Minutes(1));
+  ASSERT_EQ(WL_CONNECTED, sim.controller().currentNetworkStatus());
+  sim.environment().setUp(0, false);
+  sim.runFor(roo_time::Minutes(10));
+  sim.resetReport();
+  // No scan is going to find the network; retries with backoff do.
+  sim.environment().setUp(0, true);
+  sim.runFor(roo_time::Minutes(10));
+  EXPECT_EQ(1u, sim.report().connections);
+  EXPECT_EQ(0u, sim.report().scans);
+  EXPECT_EQ(WL_CONNECTED, sim.controller().currentNetworkStatus());
+}
+
+TEST(Simulation, StopsRetryingWhenCredentialsAreRejected) {
+  Simulation sim;
+  sim.environment().addSite(RfEnvironment::Site("home", "secret", -60));
+  sim.store().setDefaultSSID("home");
+  sim.controller().setPassword("home", "wrong");
+  sim.begin();
+  sim.runFor(roo_time::Hours(1));
+  Simulation::Report report = sim.report();
+  EXPECT_EQ(0u, report.connections);
+  EXPECT_EQ(1u, report.connect_attempts);
+  // Until the password changes.
+  sim.controller().setPassword("home", "secret");
+  sim.runFor(roo_time::Minutes(1));
+  EXPECT_EQ(1u, sim.report().connections);
+}
+
+TEST(Simulation, RetriesHandshakeTimeoutsBeforeGivingUp) {
+  Simulation sim;
+  NeverScanPolicy never_scan;
+  sim.controller().setScanPolicy(&never_scan);
+  RfEnvironment::Site site("home", "secret", -60);
+  site.association_failure_rate = 1.0;
+  site.association_failure_reason = Interface::REASON_4WAY_HANDSHAKE_TIMEOUT;
+  sim.environment().addSite(site);
+  sim.store().setDefaultSSID("home");
+  sim.controller().setPassword("home", "secret");
+  sim.begin();
+  sim.runFor(roo_time::Hours(1));
+  // Timeouts may be transient; only repeated ones reject the credentials.
+  EXPECT_EQ(internal::kHandshakeTimeoutsBeforeAuthFailure,
+            sim.report().connect_attempts);
+  EXPECT_EQ(0u, sim.report().connections);
+}
+
+TEST(Simulation, RetryingDoesNotWriteHistoryEveryTime) {
+  Simulation sim;
+  RfEnvironment::Site site("home", "secret", -60);
+  site.association_failure_rate = 1.0;
+  sim.environment().addSite(site);
+  sim.store().setDefaultSSID("home");
+  sim.controller().setPassword("home", "secret");
+  int writes = sim.store().writeCount();
+  sim.begin();
+  sim.runFor(roo_time::Hours(10));
+  Simulation::Report report = sim.report();
+  EXPECT_EQ(0u, report.connections);
+  EXPECT_GT(report.connect_attempts, 100u);
+  // Once the attempts are found failing, then at most hourly.
+  EXPECT_LE(sim.store().writeCount() - writes, 11);
+  ConnectionHistory history;
+  ASSERT_TRUE(sim.store().getConnectionHistory("home", history));
+  EXPECT_GT(history.attempts, 0);
+  EXPECT_EQ(0, history.successes);
+}
+
+TEST(Simulation, RoamsToStrongerAccessPoint) {
+  Simulation sim;
+  SimulatedInterface& radio = sim.interface();
+  int near = radio.addAccessPoint("home", -50, WIFI_AUTH_WPA2_PSK, "secret", 1);
+  sim.controller().setPassword("home", "secret");
+  sim.controller().setRoaming(true);
+  sim.begin();
+  sim.runFor(roo_time::Minutes(1));
+  ASSERT_EQ(WL_CONNECTED, sim.controller().currentNetworkStatus());
+  sim.resetReport();
+  int far = radio.addAccessPoint("home", -60, WIFI_AUTH_WPA2_PSK, "secret", 6);
+  // Walking away from the first AP; the signal must stay weak for the
+  // dwell time before the controller looks around.
+  radio.setAccessPointRssi(near, -80);
+  sim.runFor(roo_time::Seconds(5));
+  EXPECT_EQ(0u, sim.controller().stats().roams);
+  sim.runFor(roo_time::Seconds(30));
+  EXPECT_EQ(1u, sim.controller().stats().roams);
+  EXPECT_EQ(WL_CONNECTED, sim.controller().currentNetworkStatus());
+  EXPECT_EQ(6, sim.controller().currentNetwork().channel);
+  EXPECT_EQ(0, memcmp(radio.accessPoint(far).details.bssid,
+                      sim.controller().currentNetwork().bssid, 6));
+  // Seamless: the connection never dropped.
+  EXPECT_EQ(0u, sim.report().disconnections);
+}
+
+TEST(Simulation, DoesNotRoamWithinHysteresis) {
+  Simulation sim;
+  SimulatedInterface& radio = sim.interface();
+  int near = radio.addAccessPoint("home", -50, WIFI_AUTH_WPA2_PSK, "secret", 1);
+  sim.controller().setPassword("home", "secret");
+  sim.controller().setRoaming(true, -75, roo_time::Seconds(10), 8);
+  sim.begin();
+  sim.runFor(roo_time::Minutes(1));
+  ASSERT_EQ(WL_CONNECTED, sim.controller().currentNetworkStatus());
+  radio.addAccessPoint("home", -76, WIFI_AUTH_WPA2_PSK, "secret", 6);
+  radio.setAccessPointRssi(near, -80);
+  sim.runFor(roo_time::Minutes(10));
+  EXPECT_EQ(0u, sim.controller().stats().roams);
+  EXPECT_EQ(1, sim.controller().currentNetwork().channel);
+}
+
+TEST(Simulation, BackgroundScansStickToLearnedChannels) {
+  Simulation sim;
+  RfEnvironment::Site home("home", "secret", -60);
+  home.channel = 6;
+  sim.environment().addSite(home);
+  RfEnvironment::Site neighbor("neighbor", "unknown", -70);
+  neighbor.channel = 11;
+  sim.environment().addSite(neighbor);
+  sim.controller().setPassword("home", "secret");
+  sim.begin();
+  sim.runFor(roo_time::Hours(1));
+  ASSERT_EQ(WL_CONNECTED, sim.controller().currentNetworkStatus());
+  // All but every 8th scan is partial.
+  int scans = sim.interface().scanCount();
+  int partial = sim.interface().partialScanCount();
+  EXPECT_GT(scans, 100);
+  EXPECT_GE(partial, scans * 7 / 8 - 1);
+  EXPECT_LE(partial, scans * 7 / 8 + 1);
+  // Networks on other channels stay in the list in between full scans.
+  const Controller::Network* other =
+      sim.controller().lookupNetwork("neighbor");
+  ASSERT_NE(nullptr, other);
+  EXPECT_EQ(11, other->channel);
+}
+
+TEST(Simulation, FullScansWhenPartialScansAreDisabled) {
+  Simulation sim;
+  sim.environment().addSite(RfEnvironment::Site("home", "secret", -60));
+  sim.controller().setPassword("home", "secret");
+  sim.controller().setPartialScans(false);
+  sim.begin();
+  sim.runFor(roo_time::Hours(1));
+  EXPECT_GT(sim.interface().scanCount(), 100);
+  EXPECT_EQ(0, sim.interface().partialScanCount());
+}
+
+TEST(Simulation, ReportsScanDuration) {
+  Simulation sim;
+  sim.environment().addSite(RfEnvironment::Site("home", "secret", -60));
+  sim.begin();
+  sim.runFor(roo_time::Seconds(5));
+  EXPECT_EQ(roo_time::Seconds(2), sim.controller().lastScanDuration());
+  // Shorter dwell times make for faster scans.
+  ScanOptions options;
+  options.max_dwell_ms = 150;
+  sim.controller().setScanOptions(options);
+  ASSERT_TRUE(sim.controller().startScan());
+  sim.runFor(roo_time::Seconds(5));
+  EXPECT_EQ(roo_time::Seconds(1), sim.controller().lastScanDuration());
+}
+
+TEST(Simulation, RunsMuchFasterThanRealTime) {
+  Simulation sim;
+  sim.environment().addSite(FlakySite());
+  sim.controller().setPassword("home", "secret");
+  sim.begin();
+  auto start = std::chrono::steady_clock::now();
+  sim.runFor(roo_time::Hours(1000));
+  auto spent = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(spent, std::chrono::seconds(30));
+}
+
+}  // namespace roo_wifi
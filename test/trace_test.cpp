@@ -0,0 +1,170 @@
+#include "roo_wifi/trace.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "roo_scheduler.h"
+#include "roo_wifi/controller.h"
+#include "roo_wifi/hal/simulated/in_memory_store.h"
+#include "roo_wifi/hal/simulated/simulated_interface.h"
+#include "roo_wifi/hal/simulated/trace_replayer.h"
+
+namespace roo_wifi {
+
+namespace {
+
+// Collects the dump, like a serial port would.
+struct StringPrinter {
+  void print(const char* s) { text += s; }
+
+  std::string text;
+};
+
+std::vector<TraceRecord> Records(const TraceRecorder& recorder) {
+  std::vector<TraceRecord> records;
+  for (size_t i = 0; i < recorder.size(); ++i) {
+    records.push_back(recorder.at(i));
+  }
+  return records;
+}
+
+// Whether the argument c carries an SSID hash, which differs in replay.
+bool HasSsidHash(const TraceRecord& record) {
+  return record.kind == TRACE_BEGIN || record.kind == TRACE_CONNECT ||
+         record.kind == TRACE_FORGET || record.kind == TRACE_SCAN;
+}
+
+std::string Describe(const TraceRecord& r) {
+  return std::to_string(r.kind) + "(" + std::to_string(r.a) + ", " +
+         std::to_string(r.b) + ", " +
+         (HasSsidHash(r) ? std::string(r.c != 0 ? "#" : "-")
+                         : std::to_string(r.c)) +
+         ", " + std::to_string(r.d) + ")";
+}
+
+}  // namespace
+
+TEST(TraceRecorder, KeepsMostRecentRecords) {
+  StaticTraceRecorder<4> recorder;
+  EXPECT_EQ(4u, recorder.capacity());
+  for (int i = 0; i < 6; ++i) {
+    recorder.record(TRACE_EVENT, i, 100 + i, 1000 + i, 10000 + i);
+  }
+  ASSERT_EQ(4u, recorder.size());
+  EXPECT_EQ(2u, recorder.overwritten());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(TRACE_EVENT, recorder.at(i).kind);
+    EXPECT_EQ(i + 2, recorder.at(i).a);
+    EXPECT_EQ(102 + i, recorder.at(i).b);
+    EXPECT_EQ(1002u + i, recorder.at(i).c);
+    EXPECT_EQ(10002u + i, recorder.at(i).d);
+  }
+  recorder.clear();
+  EXPECT_EQ(0u, recorder.size());
+}
+
+TEST(TraceRecorder, DumpParsesBack) {
+  StaticTraceRecorder<8> recorder;
+  recorder.record(TRACE_CONNECT, 1, 0, TraceSsidHash("home"));
+  recorder.record(TRACE_EVENT, Interface::EV_CONNECTION_LOST, 200);
+  recorder.record(TRACE_SCAN, 12, 300, 0xDEADBEEF, 0x1C4);
+  StringPrinter printer;
+  printer.text = "boot noise\r\n";
+  recorder.dump(printer);
+  printer.text += "more noise\n";
+  std::vector<TraceRecord> parsed;
+  ASSERT_TRUE(TraceRecorder::ParseDump(printer.text, &parsed));
+  ASSERT_EQ(3u, parsed.size());
+  for (size_t i = 0; i < parsed.size(); ++i) {
+    const TraceRecord& r = recorder.at(i);
+    EXPECT_EQ(r.time_ms, parsed[i].time_ms);
+    EXPECT_EQ(r.kind, parsed[i].kind);
+    EXPECT_EQ(r.a, parsed[i].a);
+    EXPECT_EQ(r.b, parsed[i].b);
+    EXPECT_EQ(r.c, parsed[i].c);
+    EXPECT_EQ(r.d, parsed[i].d);
+  }
+  // Truncated.
+  std::string truncated = printer.text.substr(0, printer.text.find("end"));
+  parsed.clear();
+  EXPECT_FALSE(TraceRecorder::ParseDump(truncated, &parsed));
+  EXPECT_EQ(0u, TraceSsidHash(""));
+}
+
+// Records a session on the simulated interface, and replays its dump
+// through the stand-in interface. The replayed controller must go through
+// the same sequence.
+TEST(TraceReplayer, ReproducesRecordedSession) {
+  StaticTraceRecorder<256> recorded;
+  Controller::Stats recorded_stats;
+  ConnectionStatus recorded_status;
+  StringPrinter dump;
+  {
+    roo_scheduler::Scheduler scheduler;
+    SimulatedInterface interface(scheduler);
+    InMemoryStore store;
+    Controller controller(store, interface, scheduler);
+    controller.setTraceRecorder(&recorded);
+    auto run = [&]() {
+      while (scheduler.executeEligibleTasks()) {
+      }
+    };
+    int home = interface.addAccessPoint("home", -50, WIFI_AUTH_WPA2_PSK,
+                                        "secret", 6);
+    interface.addAccessPoint("cafe", -70, WIFI_AUTH_OPEN);
+    interface.addAccessPoint("cafe", -80, WIFI_AUTH_OPEN);
+    controller.begin();
+    controller.toggleEnabled();
+    run();
+    interface.completeScan();
+    run();
+    ASSERT_TRUE(controller.connect("home", "secret"));
+    run();
+    interface.setAccessPointRssi(home, -65);
+    run();
+    interface.emitEvent(Interface::EV_RSSI_CHANGED);
+    run();
+    interface.emitEvent(Interface::EV_CONNECTION_LOST, 200);
+    run();
+    ASSERT_TRUE(controller.connect());
+    run();
+    controller.disconnect();
+    run();
+    controller.forget("home");
+    ASSERT_TRUE(controller.connect("cafe", ""));
+    run();
+    recorded_stats = controller.stats();
+    recorded_status = controller.currentNetworkStatus();
+    recorded.dump(dump);
+    controller.setTraceRecorder(nullptr);
+  }
+  std::vector<TraceRecord> trace;
+  ASSERT_TRUE(TraceRecorder::ParseDump(dump.text, &trace));
+  ASSERT_EQ(recorded.size(), trace.size());
+
+  roo_scheduler::Scheduler scheduler;
+  ReplayInterface interface;
+  InMemoryStore store;
+  Controller controller(store, interface, scheduler);
+  StaticTraceRecorder<256> replayed;
+  controller.setTraceRecorder(&replayed);
+  TraceReplayer replayer(scheduler, interface, store, controller, trace);
+  replayer.replay();
+  EXPECT_EQ(trace.size(), replayer.position());
+
+  std::vector<std::string> expected, actual;
+  for (const TraceRecord& r : trace) expected.push_back(Describe(r));
+  for (const TraceRecord& r : Records(replayed)) actual.push_back(Describe(r));
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(recorded_status, controller.currentNetworkStatus());
+  Controller::Stats stats = controller.stats();
+  EXPECT_EQ(recorded_stats.connect_attempts, stats.connect_attempts);
+  EXPECT_EQ(1u, recorded_stats.reconnect_attempts);
+  EXPECT_EQ(recorded_stats.reconnect_attempts, stats.reconnect_attempts);
+  EXPECT_EQ(recorded_stats.disconnects, stats.disconnects);
+  EXPECT_EQ(recorded_stats.scans, stats.scans);
+  controller.setTraceRecorder(nullptr);
+}
+
+}  // namespace roo_wifi
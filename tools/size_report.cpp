@@ -0,0 +1,74 @@
+// Minimal application that uses the controller the way firmware typically
+// does (begin(), auto-join, connect, a few scans), for comparing the code
+// size of the two ways to instantiate it:
+//
+// - Controller, i.e. BasicController<Interface, Store>, which calls the
+//   interface and the store virtually (the default), and
+// - BasicController<SimulatedInterface, InMemoryStore>, with the calls
+//   resolved at compile time (when built with
+//   ROO_WIFI_SIZE_REPORT_SPECIALIZED).
+//
+// Both variants are built by the `size_report` target, which lists their
+// section sizes side by side:
+//
+//   bazel build -c opt //:size_report && cat bazel-bin/size_report.txt
+//
+// These are host builds against the simulated HAL; they say nothing definite
+// about the ESP32. There, compare the firmware sizes of the equivalent
+// application built with Esp32Wifi and with Esp32WifiSpecialized.
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "roo_scheduler.h"
+#include "roo_wifi/basic_controller.h"
+#include "roo_wifi/hal/simulated/in_memory_store.h"
+#include "roo_wifi/hal/simulated/simulated_interface.h"
+#include "roo_wifi/hal/simulated/virtual_clock.h"
+
+#ifdef ROO_WIFI_SIZE_REPORT_SPECIALIZED
+#define ROO_WIFI_SIZE_REPORT_VARIANT "specialized"
+using TestedController =
+    roo_wifi::BasicController<roo_wifi::SimulatedInterface,
+                              roo_wifi::InMemoryStore>;
+#else
+#include "roo_wifi/controller.h"
+#define ROO_WIFI_SIZE_REPORT_VARIANT "virtual"
+using TestedController = roo_wifi::Controller;
+#endif
+
+int main() {
+  roo_wifi::VirtualClock clock;
+  roo_scheduler::Scheduler scheduler;
+  roo_wifi::SimulatedInterface interface(scheduler);
+  roo_wifi::InMemoryStore store;
+  TestedController controller(store, interface, scheduler);
+
+  interface.addAccessPoint("home", -60, roo_wifi::WIFI_AUTH_WPA2_PSK,
+                           "secret", 6);
+  interface.addAccessPoint("neighbor", -80, roo_wifi::WIFI_AUTH_WPA2_PSK,
+                           "unknown", 11);
+  store.setIsInterfaceEnabled(true);
+  controller.begin();
+  controller.setAutoJoin(true);
+  controller.setPassword("home", "secret");
+  controller.resume();
+  controller.connect();
+
+  roo_time::Uptime end = clock.now() + roo_time::Minutes(10);
+  while (true) {
+    while (scheduler.executeEligibleTasks()) {
+    }
+    roo_time::Uptime next = scheduler.getNearestExecutionTime();
+    if (next > end) break;
+    clock.advanceTo(next);
+  }
+
+  printf("%s: %s, %d networks, %" PRIu32 " scans\n",
+         ROO_WIFI_SIZE_REPORT_VARIANT,
+         controller.currentNetworkStatus() == roo_wifi::WL_CONNECTED
+             ? "connected"
+             : "not connected",
+         controller.scannedNetworksCount(), controller.stats().scans);
+  return 0;
+}
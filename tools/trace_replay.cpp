@@ -0,0 +1,169 @@
+// Replays a roo_wifi trace, as dumped by TraceRecorder::dump() (e.g. over
+// serial), through a controller on the host.
+//
+// Usage: trace_replay [dump file]   (reads stdin if no file is given)
+//
+// Prints the trace, the notifications that the replayed controller emits,
+// and its stats at the end.
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "roo_scheduler.h"
+#include "roo_wifi/controller.h"
+#include "roo_wifi/hal/simulated/in_memory_store.h"
+#include "roo_wifi/hal/simulated/trace_replayer.h"
+#include "roo_wifi/trace.h"
+
+namespace {
+
+using roo_wifi::Controller;
+using roo_wifi::Interface;
+using roo_wifi::TraceRecord;
+
+const char* EventName(int type) {
+  switch (type) {
+    case Interface::EV_SCAN_COMPLETED:
+      return "SCAN_COMPLETED";
+    case Interface::EV_CONNECTED:
+      return "CONNECTED";
+    case Interface::EV_GOT_IP:
+      return "GOT_IP";
+    case Interface::EV_DISCONNECTED:
+      return "DISCONNECTED";
+    case Interface::EV_CONNECTION_FAILED:
+      return "CONNECTION_FAILED";
+    case Interface::EV_CONNECTION_LOST:
+      return "CONNECTION_LOST";
+    case Interface::EV_RSSI_CHANGED:
+      return "RSSI_CHANGED";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+void PrintRecord(const TraceRecord& r) {
+  printf("%10" PRIu32 " ms  ", r.time_ms);
+  switch (r.kind) {
+    case roo_wifi::TRACE_EVENT:
+      printf("event %s (reason %d)\n", EventName(r.a), r.b);
+      break;
+    case roo_wifi::TRACE_EVENTS_DROPPED:
+      printf("%" PRIu32 " events dropped\n", r.c);
+      break;
+    case roo_wifi::TRACE_SCAN:
+      printf("scan: %d listed, %d raw, current: %08" PRIx32 " (%d dBm)\n",
+             r.a, r.b, r.c, (int8_t)(r.d & 0xFF));
+      break;
+    case roo_wifi::TRACE_RSSI:
+      printf("rssi %d dBm\n", (int8_t)r.a);
+      break;
+    case roo_wifi::TRACE_BEGIN:
+      printf("begin() enabled: %d, default: %08" PRIx32 "\n", r.a, r.c);
+      break;
+    case roo_wifi::TRACE_TOGGLE_ENABLED:
+      printf("toggleEnabled() -> %d\n", r.a);
+      break;
+    case roo_wifi::TRACE_START_SCAN:
+      printf("startScan() -> %d\n", r.a);
+      break;
+    case roo_wifi::TRACE_CONNECT:
+      printf("connect(%s%08" PRIx32 "%s)\n", (r.a & 2) ? "default: " : "",
+             r.c, (r.a & 1) ? ", open" : "");
+      break;
+    case roo_wifi::TRACE_DISCONNECT:
+      printf("disconnect()\n");
+      break;
+    case roo_wifi::TRACE_FORGET:
+      printf("forget(%08" PRIx32 ")\n", r.c);
+      break;
+    default:
+      printf("unknown record kind %d\n", r.kind);
+  }
+}
+
+class PrintingListener : public Controller::Listener {
+ public:
+  PrintingListener(const Controller& controller) : controller_(controller) {}
+
+  void onEnableChanged(bool enabled) override {
+    printf("                -> enabled: %d\n", enabled);
+  }
+  void onScanCompleted() override {
+    printf("                -> scan completed, %d other networks\n",
+           controller_.otherScannedNetworksCount());
+  }
+  void onConnectionStateChanged(Interface::EventType type) override {
+    printf("                -> connection state: %s\n", EventName(type));
+  }
+
+ private:
+  const Controller& controller_;
+};
+
+void PrintHistogram(const char* name, const roo_wifi::LatencyHistogram& h) {
+  printf("  %-16s n=%" PRIu32 " min=%" PRId64 " p50<=%" PRId64
+         " p90<=%" PRId64 " max=%" PRId64 " ms\n",
+         name, h.count(), h.min().inMillis(), h.percentile(50).inMillis(),
+         h.percentile(90).inMillis(), h.max().inMillis());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::stringstream text;
+  if (argc > 1) {
+    std::ifstream in(argv[1]);
+    if (!in) {
+      fprintf(stderr, "Cannot open %s\n", argv[1]);
+      return 1;
+    }
+    text << in.rdbuf();
+  } else {
+    text << std::cin.rdbuf();
+  }
+  std::vector<TraceRecord> trace;
+  if (!roo_wifi::TraceRecorder::ParseDump(text.str(), &trace)) {
+    fprintf(stderr, "Malformed or truncated trace dump.\n");
+    return 1;
+  }
+  printf("Trace: %zu records\n", trace.size());
+
+  roo_scheduler::Scheduler scheduler;
+  roo_wifi::ReplayInterface interface;
+  roo_wifi::InMemoryStore store;
+  Controller controller(store, interface, scheduler);
+  PrintingListener listener(controller);
+  controller.addListener(&listener);
+  roo_wifi::TraceReplayer replayer(scheduler, interface, store, controller,
+                                   trace);
+
+  // Replay record by record, to interleave the notifications.
+  auto start = std::chrono::steady_clock::now();
+  while (replayer.position() < trace.size()) {
+    PrintRecord(trace[replayer.position()]);
+    replayer.step();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  Controller::Stats stats = controller.stats();
+  printf("\nReplayed in %.3f ms. Final status: %d\n",
+         std::chrono::duration<double, std::milli>(elapsed).count(),
+         controller.currentNetworkStatus());
+  printf("Stats:\n");
+  PrintHistogram("connect", stats.connect_latency);
+  PrintHistogram("got IP", stats.got_ip_latency);
+  printf("  scans=%" PRIu32 " connect attempts=%" PRIu32
+         " reconnects=%" PRIu32 " disconnects=%" PRIu32 "\n",
+         stats.scans, stats.connect_attempts, stats.reconnect_attempts,
+         stats.disconnects);
+  controller.removeListener(&listener);
+  return 0;
+}